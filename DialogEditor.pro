@@ -22,15 +22,14 @@ CONFIG(release, debug|release) {
 include(3rdparty/qtxlsx/xlsx/qtxlsx.pri)
 INCLUDEPATH += 3rdparty/qtxlsx/xlsx
 
+include(core/core.pri)
+
 SOURCES += \
     listeditorwidget.cpp \
     logindialog.cpp \
     main.cpp \
     mainwindow.cpp \
     core/websocket.cpp \
-    core/dialogjsonreader.cpp \
-    core/dialogjsonwriter.cpp \
-    core/dialog.cpp \
     dialogeditor/arrowlinegraphicsitem.cpp \
     dialogeditor/clientreplicanodegraphicsitem.cpp \
     dialogeditor/dialogeditorwindow.cpp \
@@ -48,10 +47,6 @@ SOURCES += \
     dialogeditor/zoomablegraphicsview.cpp \
     dialogeditor/phasegraphicsitem.cpp \
     dialogeditor/phaseeditorwindow.cpp \
-    core/abstractdialognode.cpp \
-    core/clientreplicanode.cpp \
-    core/expectedwordsnode.cpp \
-	core/phasenode.cpp \
 	dialogeditor/dialoglisteditorwidget.cpp \
 	usereditor/userlisteditorwidget.cpp \
     core/backendconnection.cpp \
@@ -69,20 +64,23 @@ SOURCES += \
     clienteditor/groupstabwidget.cpp \
     clienteditor/groupeditordialog.cpp \
     dialogeditor/groupsdialog.cpp \
+    dialogeditor/histogramwidget.cpp \
+    dialogeditor/passratewindow.cpp \
+    dialogeditor/replacetextswindow.cpp \
+    dialogeditor/memoryreportwindow.cpp \
+    dialogeditor/phasetemplateswindow.cpp \
+    dialogeditor/dialoghistory.cpp \
+    dialogeditor/dialogjournal.cpp \
     groupslistwidget.cpp \
     usereditor/usersxlsxdocument.cpp
 
 HEADERS  += \
     listeditorwidget.h \
     logindialog.h \
-    logger.h \
     mainwindow.h \
-    core/dialog.h \
     core/ibackendconnection.h \
     core/user.h \
     core/websocket.h \
-    core/dialogjsonreader.h \
-    core/dialogjsonwriter.h \
     dialogeditor/arrowlinegraphicsitem.h \
     dialogeditor/clientreplicanodegraphicsitem.h \
     dialogeditor/dialogeditorwindow.h \
@@ -100,10 +98,6 @@ HEADERS  += \
     dialogeditor/zoomablegraphicsview.h \
     dialogeditor/phasegraphicsitem.h \
     dialogeditor/phaseeditorwindow.h \
-	core/abstractdialognode.h \
-    core/clientreplicanode.h \
-    core/expectedwordsnode.h \
-    core/phasenode.h \
 	dialogeditor/dialoglisteditorwidget.h \
 	usereditor/userlisteditorwidget.h \
     core/backendconnection.h \
@@ -111,8 +105,6 @@ HEADERS  += \
 	dialogeditor/graphlayout.h \
 	settingsdialog.h \
 	applicationsettings.h \
-    core/errorreplica.h \
-    core/hashcombine.h \
 	clienteditor/clientlisteditorwidget.h \
 	core/client.h \
     clienteditor/clienteditordialog.h \
@@ -125,8 +117,14 @@ HEADERS  += \
     clienteditor/groupstabwidget.h \
     clienteditor/groupeditordialog.h \
     dialogeditor/groupsdialog.h \
+    dialogeditor/histogramwidget.h \
+    dialogeditor/passratewindow.h \
+    dialogeditor/replacetextswindow.h \
+    dialogeditor/memoryreportwindow.h \
+    dialogeditor/phasetemplateswindow.h \
+    dialogeditor/dialoghistory.h \
+    dialogeditor/dialogjournal.h \
     groupslistwidget.h \
-    optional.h \
     usereditor/usersxlsxdocument.h
 
 FORMS    += \
@@ -146,7 +144,11 @@ FORMS    += \
     dialogeditor/saveasdialog.ui \
     clienteditor/groupstabwidget.ui \
     clienteditor/groupeditordialog.ui \
-    dialogeditor/groupsdialog.ui
+    dialogeditor/groupsdialog.ui \
+    dialogeditor/passratewindow.ui \
+    dialogeditor/replacetextswindow.ui \
+    dialogeditor/memoryreportwindow.ui \
+    dialogeditor/phasetemplateswindow.ui
 
 RESOURCES += \
 	resources.qrc
@@ -1,5 +1,6 @@
 #include "abstractdialognode.h"
 #include "hashcombine.h"
+#include "memoryusage.h"
 #include <QDateTime>
 
 namespace Core
@@ -7,6 +8,31 @@ namespace Core
 
 AbstractDialogNode::AbstractDialogNode()
 	: m_id(QString::number(QDateTime::currentMSecsSinceEpoch()))
+	, m_hash(0)
+	, m_dataHash(0)
+	, m_hashValid(false)
+{
+}
+
+AbstractDialogNode::AbstractDialogNode(const AbstractDialogNode& other)
+	: QSharedData()
+	, m_parentNodes(other.m_parentNodes)
+	, m_childNodes(other.m_childNodes)
+	, m_id(other.m_id)
+	, m_hash(other.m_hash)
+	, m_dataHash(other.m_dataHash)
+	, m_hashValid(other.m_hashValid)
+{
+}
+
+AbstractDialogNode::AbstractDialogNode(AbstractDialogNode&& other)
+	: QSharedData()
+	, m_parentNodes(std::move(other.m_parentNodes))
+	, m_childNodes(std::move(other.m_childNodes))
+	, m_id(std::move(other.m_id))
+	, m_hash(other.m_hash)
+	, m_dataHash(other.m_dataHash)
+	, m_hashValid(other.m_hashValid)
 {
 }
 
@@ -14,6 +40,29 @@ AbstractDialogNode::~AbstractDialogNode()
 {
 }
 
+// Reference counter is never assigned, it belongs to the object itself
+AbstractDialogNode& AbstractDialogNode::operator=(const AbstractDialogNode& other)
+{
+	m_parentNodes = other.m_parentNodes;
+	m_childNodes = other.m_childNodes;
+	m_id = other.m_id;
+	m_hash = other.m_hash;
+	m_dataHash = other.m_dataHash;
+	m_hashValid = other.m_hashValid;
+	return *this;
+}
+
+AbstractDialogNode& AbstractDialogNode::operator=(AbstractDialogNode&& other)
+{
+	m_parentNodes = std::move(other.m_parentNodes);
+	m_childNodes = std::move(other.m_childNodes);
+	m_id = std::move(other.m_id);
+	m_hash = other.m_hash;
+	m_dataHash = other.m_dataHash;
+	m_hashValid = other.m_hashValid;
+	return *this;
+}
+
 AbstractDialogNode::Id AbstractDialogNode::id() const
 {
 	return m_id;
@@ -22,6 +71,7 @@ AbstractDialogNode::Id AbstractDialogNode::id() const
 void AbstractDialogNode::setId(Id id)
 {
 	m_id = id;
+	invalidateHash();
 }
 
 QSet<AbstractDialogNode::Id> AbstractDialogNode::parentNodes() const
@@ -32,12 +82,14 @@ QSet<AbstractDialogNode::Id> AbstractDialogNode::parentNodes() const
 void AbstractDialogNode::appendParent(const Id& id)
 {
 	m_parentNodes.insert(id);
+	invalidateHash();
 }
 
 void AbstractDialogNode::removeParent(const Id& id)
 {
 	Q_ASSERT(m_parentNodes.contains(id));
 	m_parentNodes.remove(id);
+	invalidateHash();
 }
 
 QSet<AbstractDialogNode::Id> AbstractDialogNode::childNodes() const
@@ -48,12 +100,14 @@ QSet<AbstractDialogNode::Id> AbstractDialogNode::childNodes() const
 void AbstractDialogNode::appendChild(const Id& id)
 {
 	m_childNodes.insert(id);
+	invalidateHash();
 }
 
 void AbstractDialogNode::removeChild(const Id& id)
 {
 	Q_ASSERT(m_childNodes.contains(id));
 	m_childNodes.remove(id);
+	invalidateHash();
 }
 
 AbstractDialogNode* AbstractDialogNode::clone(bool uniqueId) const
@@ -67,6 +121,7 @@ AbstractDialogNode* AbstractDialogNode::clone(bool uniqueId) const
 
 	result->m_parentNodes = m_parentNodes;
 	result->m_childNodes = m_childNodes;
+	result->invalidateHash();
 
 	return result;
 }
@@ -79,6 +134,11 @@ bool AbstractDialogNode::validate() const
 
 bool AbstractDialogNode::compare(AbstractDialogNode* other) const
 {
+	if (this == other)
+	{
+		return true;
+	}
+
 	const auto rank = [](const AbstractDialogNode* node)
 	{
 		return std::make_tuple(node->id(), node->type(), node->childNodes(), node->parentNodes());
@@ -87,25 +147,64 @@ bool AbstractDialogNode::compare(AbstractDialogNode* other) const
 	return rank(this) == rank(other) && compareData(other);
 }
 
-size_t AbstractDialogNode::hash() const
+bool AbstractDialogNode::compareContent(AbstractDialogNode* other) const
 {
-	size_t seed = 0;
+	return this == other || (type() == other->type() && compareData(other));
+}
 
-	for (Id id : m_parentNodes)
+size_t AbstractDialogNode::hash() const
+{
+	if (m_hashValid)
 	{
-		hashCombine(seed, id);
+		return m_hash;
 	}
 
-	for (Id id : m_childNodes)
+	// sets are hashed independently of their iteration order
+	const auto setHash = [](const QSet<Id>& ids)
 	{
-		hashCombine(seed, id);
-	}
+		size_t result = 0;
+		for (const Id& id : ids)
+		{
+			result += qHash(id);
+		}
+		return result;
+	};
 
+	size_t seed = 0;
+	hashCombine(seed, setHash(m_parentNodes));
+	hashCombine(seed, setHash(m_childNodes));
 	hashCombine(seed, m_id);
 
-	seed ^= calculateHash();
+	m_dataHash = calculateHash();
+	seed ^= m_dataHash;
+
+	m_hash = seed;
+	m_hashValid = true;
+	return m_hash;
+}
+
+void AbstractDialogNode::invalidateHash()
+{
+	m_hashValid = false;
+}
+
+size_t AbstractDialogNode::dataHash() const
+{
+	hash();
+	return m_dataHash;
+}
+
+void AbstractDialogNode::accountMemory(MemoryCounter& counter) const
+{
+	if (!counter.addObject(this, objectSize()))
+	{
+		return;
+	}
 
-	return seed;
+	counter.addString(m_id);
+	counter.addStrings(m_parentNodes);
+	counter.addStrings(m_childNodes);
+	accountData(counter);
 }
 
 }
@@ -1,19 +1,30 @@
 #pragma once
 
 #include <QSet>
+#include <QSharedData>
 #include <memory>
 
 namespace Core
 {
 
+class MemoryCounter;
+
+// Nodes are reference counted (QSharedData), so phases can share them between copies.
+// A shared node must not be modified in place, see PhaseNode::mutableNode()
 class AbstractDialogNode
+	: public QSharedData
 {
 public:
 	typedef QString Id;
 
 	AbstractDialogNode();
+	AbstractDialogNode(const AbstractDialogNode& other);
+	AbstractDialogNode(AbstractDialogNode&& other);
 	virtual ~AbstractDialogNode();
 
+	AbstractDialogNode& operator=(const AbstractDialogNode& other);
+	AbstractDialogNode& operator=(AbstractDialogNode&& other);
+
 	enum Type
 	{
 		Type = 0
@@ -37,6 +48,8 @@ public:
 	virtual int type() const = 0;
 
 	bool compare(AbstractDialogNode* other) const;
+	// Compares the type and the data only, without ids and links
+	bool compareContent(AbstractDialogNode* other) const;
 
 	template <typename T>
 	T* as()
@@ -50,9 +63,19 @@ public:
 		return type() == T::Type ? static_cast<const T*>(this) : nullptr;
 	}
 
+	// Cached until the node is modified, calculateHash() is called only for modified nodes.
+	// Filling the cache is a write, nodes read from several threads must have it filled, see DialogSnapshot
 	size_t hash() const;
+	// Hash of the node data only, without id and links
+	size_t dataHash() const;
+
+	// Adds the node object, its id, links and data, a node shared between phases is counted once
+	void accountMemory(MemoryCounter& counter) const;
+
+protected:
+	// Must be called by every method that modifies data covered by calculateHash()
+	void invalidateHash();
 
-protected:	
 	QSet<Id> m_parentNodes;
 	QSet<Id> m_childNodes;
 
@@ -60,9 +83,15 @@ private:
 	virtual AbstractDialogNode* shallowCopy() const = 0;
 	virtual bool compareData(AbstractDialogNode* other) const = 0;
 	virtual size_t calculateHash() const = 0;
+	virtual size_t objectSize() const = 0;
+	virtual void accountData(MemoryCounter& counter) const = 0;
 
 private:
 	Id m_id;
+
+	mutable size_t m_hash;
+	mutable size_t m_dataHash;
+	mutable bool m_hashValid;
 };
 
 bool operator==(const AbstractDialogNode& left, const AbstractDialogNode& right);
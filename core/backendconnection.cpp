@@ -1,8 +1,11 @@
 #include "backendconnection.h"
 #include "dialogjsonreader.h"
 #include "dialogjsonwriter.h"
+#include "jsonpullparser.h"
 #include "logger.h"
 
+#include <QAtomicInt>
+
 namespace Core
 {
 
@@ -11,18 +14,72 @@ namespace
 
 int generateQueryId()
 {
-	static int s_queryId = 0;
-	return ++s_queryId;
+	static QAtomicInt s_queryId;
+	return s_queryId.fetchAndAddOrdered(1) + 1;
 }
 
-QJsonObject toJson(const Dialog& dialog)
+// Reads the fields needed to route the message, the payload is skipped without building a document
+bool readHeader(const QByteArray& message, QString& type, IBackendConnection::QueryId& queryId, bool& hasError, QString& error)
 {
-	return DialogJsonWriter().writeToObject(dialog);
+	JsonPullParser parser(message);
+
+	double id = 0.0;
+	if (parser.beginObject())
+	{
+		while (parser.nextKey())
+		{
+			if (parser.keyIs("type") && parser.peek() == JsonPullParser::Type::String)
+			{
+				parser.readString(type);
+			}
+			else if (parser.keyIs("queryId") && parser.peek() == JsonPullParser::Type::Number)
+			{
+				parser.readNumber(id);
+			}
+			else if (parser.keyIs("payload") && parser.peek() == JsonPullParser::Type::Object)
+			{
+				parser.beginObject();
+				while (parser.nextKey())
+				{
+					hasError = hasError || parser.keyIs("error");
+					parser.skipValue();
+				}
+			}
+			else
+			{
+				parser.skipValue();
+			}
+		}
+	}
+
+	if (parser.hasError() || !parser.atEnd())
+	{
+		error = parser.hasError() ? parser.errorString() : "лишние данные после сообщения";
+		return false;
+	}
+
+	queryId = static_cast<IBackendConnection::QueryId>(id);
+	return true;
 }
 
-QByteArray toString(const QJsonObject& object)
+// Moves the parser to the value of the member, the other members before it are skipped
+bool findMember(JsonPullParser& parser, const char* name)
 {
-	return QJsonDocument(object).toJson(QJsonDocument::Compact);
+	if (parser.peek() != JsonPullParser::Type::Object || !parser.beginObject())
+	{
+		return false;
+	}
+
+	while (parser.nextKey())
+	{
+		if (parser.keyIs(name))
+		{
+			return true;
+		}
+		parser.skipValue();
+	}
+
+	return false;
 }
 
 QJsonObject toJson(const User& user)
@@ -80,6 +137,9 @@ BackendConnection::BackendConnection(const QUrl& url)
 	connect(&m_webSocket, &WebSocket::disconnected, this, &BackendConnection::onWebSocketDisconnected);
 	connect(&m_webSocket, &WebSocket::messageReceived, this, &BackendConnection::onWebSocketMessage);
 	connect(&m_webSocket, &WebSocket::error, this, &BackendConnection::onWebSocketError);
+
+	// reserved capacity survives resize(0), so the buffer is allocated once for all messages
+	m_messageBuffer.reserve(64 * 1024);
 }
 
 BackendConnection::~BackendConnection()
@@ -237,54 +297,65 @@ IBackendConnection::QueryId BackendConnection::loadDialogs()
 
 IBackendConnection::QueryId BackendConnection::updateDialogs(const QString& cliendId, const Update<Dialog>& update)
 {
-	QJsonArray updatedDialogs;
-	for (const auto& originalDialog : update.updated.keys())
-	{
-		const QJsonObject dialogObject = {
-			{ "name", originalDialog.name },
-			{ "difficulty", static_cast<int>(originalDialog.difficulty) },
-			{ "value", toJson(update.updated.value(originalDialog)) }
-		};
-		updatedDialogs << dialogObject;
-	}
+	const QueryId queryId = generateQueryId();
+	const QString type = "dialogs_update";
 
-	QJsonArray deletedDialogs;
-	for (const auto& dialog : update.deleted)
-	{
-		deletedDialogs << QJsonObject{
-			{ "name", dialog.name },
-			{ "difficulty", static_cast<int>(dialog.difficulty) }
-		};
-	}
+	// dialogs are streamed straight into the message instead of building and serializing JSON objects
+	m_messageBuffer.resize(0);
+	JsonStreamWriter writer(m_messageBuffer);
+	DialogJsonWriter dialogWriter;
 
-	QJsonArray addedDialogs;
-	for (const auto& dialog : update.added)
-	{
-		addedDialogs << QJsonObject{ { "value", toJson(dialog) } };
-	}
+	writer.beginObject();
+	writer.write("queryId", queryId);
+	writer.write("type", type);
+	writer.write("clientId", cliendId);
+	writer.beginObject("update");
 
-	QJsonObject updateObject;
-	if (!updatedDialogs.empty())
+	if (!update.updated.isEmpty())
 	{
-		updateObject["updated"] = updatedDialogs;
+		writer.beginArray("updated");
+		for (auto it = update.updated.begin(); it != update.updated.end(); ++it)
+		{
+			writer.beginObject();
+			writer.write("name", it.key().name);
+			writer.write("difficulty", static_cast<int>(it.key().difficulty));
+			writer.writeKey("value");
+			dialogWriter.write(it.value(), writer);
+			writer.endObject();
+		}
+		writer.endArray();
 	}
-	if (!addedDialogs.empty())
+
+	if (!update.added.isEmpty())
 	{
-		updateObject["added"] = addedDialogs;
+		writer.beginArray("added");
+		for (const Dialog& dialog : update.added)
+		{
+			writer.beginObject();
+			writer.writeKey("value");
+			dialogWriter.write(dialog, writer);
+			writer.endObject();
+		}
+		writer.endArray();
 	}
-	if (!deletedDialogs.empty())
+
+	if (!update.deleted.isEmpty())
 	{
-		updateObject["deleted"] = deletedDialogs;
+		writer.beginArray("deleted");
+		for (const Dialog& dialog : update.deleted)
+		{
+			writer.beginObject();
+			writer.write("name", dialog.name);
+			writer.write("difficulty", static_cast<int>(dialog.difficulty));
+			writer.endObject();
+		}
+		writer.endArray();
 	}
 
-	QJsonObject message = {
-		{ "queryId", generateQueryId() },
-		{ "type", "dialogs_update" },
-		{ "clientId", cliendId },
-		{ "update", updateObject }
-	};
+	writer.endObject();
+	writer.endObject();
 
-	return sendMessage(message);
+	return sendMessage(queryId, type, m_messageBuffer);
 }
 
 IBackendConnection::QueryId BackendConnection::cleanupClientStatistics(const QString& clientId)
@@ -329,12 +400,19 @@ void BackendConnection::onWebSocketDisconnected()
 	}
 }
 
-void BackendConnection::onWebSocketMessage(const QJsonObject& message)
+void BackendConnection::onWebSocketMessage(const QByteArray& message)
 {
-	const QString type = message["type"].toString();
-	LOG << "Received message" << ARG(type);
+	QString type;
+	IBackendConnection::QueryId queryId = 0;
+	bool hasError = false;
+	QString parseError;
+	if (!readHeader(message, type, queryId, hasError, parseError))
+	{
+		LOG << "Failed to parse message: " << parseError;
+		return;
+	}
 
-	const IBackendConnection::QueryId queryId = message["queryId"].toInt();
+	LOG << "Received message" << ARG(type);
 
 	auto activeQueryIt = m_activeQueries.find(queryId);
 	if (activeQueryIt == m_activeQueries.end())
@@ -345,14 +423,21 @@ void BackendConnection::onWebSocketMessage(const QJsonObject& message)
 
 	const auto processor = m_activeQueries.take(queryId);
 
-	const QJsonObject payload = message["payload"].toObject();
-	if (!payload.contains("error"))
+	if (!hasError && processor.processRawData)
 	{
-		processor.processData(queryId, payload["data"].toObject());
+		processor.processRawData(queryId, message);
 	}
 	else
 	{
-		processor.processError(queryId, payload["error"].toObject());
+		const QJsonObject payload = QJsonDocument::fromJson(message).object().value("payload").toObject();
+		if (!hasError)
+		{
+			processor.processData(queryId, payload["data"].toObject());
+		}
+		else
+		{
+			processor.processError(queryId, payload["error"].toObject());
+		}
 	}
 
 	LOG << ARG(queryId) << " pop from active, " << m_activeQueries.size() << " active queries left";
@@ -379,6 +464,15 @@ IBackendConnection::QueryId BackendConnection::sendMessage(const QJsonObject& me
 	return m_webSocket.sendMessage(message);
 }
 
+IBackendConnection::QueryId BackendConnection::sendMessage(QueryId queryId, const QString& type, const QByteArray& message)
+{
+	m_activeQueries.insert(queryId, makeProcessor(type));
+
+	LOG << ARG(queryId) << " pushed to active";
+
+	return m_webSocket.sendMessage(queryId, message);
+}
+
 void BackendConnection::onLogInSuccess(IBackendConnection::QueryId queryId)
 {
 	emit loggedIn(queryId);
@@ -637,71 +731,92 @@ void BackendConnection::onUsersUpdateFailure(IBackendConnection::QueryId queryId
 	emit usersUpdateFailed(queryId, error);
 }
 
-void BackendConnection::onDialogsLoadSuccess(IBackendConnection::QueryId queryId, const QJsonObject& message)
+// Dialogs are the largest message, so their JSON is passed to DialogJsonReader as it is, without a document
+void BackendConnection::onDialogsLoadSuccess(IBackendConnection::QueryId queryId, const QByteArray& message)
 {
-	if (!message.contains("dialogs") || message["dialogs"].type() != QJsonValue::Array)
+	JsonPullParser parser(message);
+	if (!findMember(parser, "payload") || !findMember(parser, "data") || !findMember(parser, "dialogs") ||
+		parser.peek() != JsonPullParser::Type::Array)
 	{
-		LOG << "Message" << ARG2(message["type"], "type") << " must have \"dialogs\" array property";
+		LOG << "Message dialogs_load must have \"dialogs\" array property";
 		return;
 	}
 
-	const QJsonArray clientDialogsArray = message["dialogs"].toArray();
 	QMap<QString, QList<Dialog>> result;
-	for (int i = 0; i < clientDialogsArray.size(); ++i)
+	parser.beginArray();
+	for (int i = 0; parser.nextElement(); ++i)
 	{
-		const QJsonValue& clientDialogsValue = clientDialogsArray[i];
-		if (!clientDialogsValue.isObject())
+		if (parser.peek() != JsonPullParser::Type::Object)
 		{
-			LOG << "Faled to parse client dialogs #" << i << " - value type must be an object (actual type is " << clientDialogsValue.type() << ")";
+			LOG << "Faled to parse client dialogs #" << i << " - value type must be an object";
+			parser.skipValue();
 			continue;
 		}
 
-		const QJsonObject clientDialogsObject = clientDialogsValue.toObject();
-		if (!clientDialogsObject.contains("clientId"))
+		QString clientId;
+		bool hasClientId = false;
+		bool hasDialogs = false;
+		// the dialogs are read after the object ends, clientId may follow them
+		QList<QPair<int, QByteArray>> dialogsJson;
+
+		parser.beginObject();
+		while (parser.nextKey())
 		{
-			LOG << "Faled to parse client dialogs #" << i << " - clientId field not found";
-			continue;
+			if (parser.keyIs("clientId") && parser.peek() == JsonPullParser::Type::String)
+			{
+				hasClientId = parser.readString(clientId);
+			}
+			else if (parser.keyIs("dialogs") && parser.peek() == JsonPullParser::Type::Array)
+			{
+				hasDialogs = true;
+				parser.beginArray();
+				for (int j = 0; parser.nextElement(); ++j)
+				{
+					if (parser.peek() != JsonPullParser::Type::Object)
+					{
+						LOG << "Faled to parse client dialogs #" << i << " - dialog #" << j << " value type must be an object";
+						parser.skipValue();
+						continue;
+					}
+
+					QByteArray dialogJson;
+					parser.readRaw(dialogJson);
+					dialogsJson.append({ j, dialogJson });
+				}
+			}
+			else
+			{
+				parser.skipValue();
+			}
 		}
 
-		if (clientDialogsObject["clientId"].type() != QJsonValue::String)
+		if (parser.hasError())
 		{
-			LOG << "Faled to parse client dialogs #" << i << " - clientId field must be string (actual type is " << clientDialogsObject["clientId"].type() << ")";
-			continue;
+			break;
 		}
 
-		if (!clientDialogsObject.contains("dialogs"))
+		if (!hasClientId)
 		{
-			LOG << "Faled to parse client dialogs #" << i << " - dialogs field not found";
+			LOG << "Faled to parse client dialogs #" << i << " - clientId string field not found";
 			continue;
 		}
 
-		if (clientDialogsObject["dialogs"].type() != QJsonValue::Array)
+		if (!hasDialogs)
 		{
-			LOG << "Faled to parse client dialogs #" << i << " - dialogs field must be an array (actual type is " << clientDialogsObject["dialogs"].type() << ")";
+			LOG << "Faled to parse client dialogs #" << i << " - dialogs array field not found";
 			continue;
 		}
 
-		const QString clientId = clientDialogsObject["clientId"].toString();
-		const QJsonArray dialogsArray = clientDialogsObject["dialogs"].toArray();
-
 		QList<Core::Dialog> dialogsList;
-
-		for (int j = 0; j < dialogsArray.size(); ++j)
+		for (const auto& dialogJson : dialogsJson)
 		{
-			const QJsonValue& dialogValue = dialogsArray[j];
-			if (!dialogValue.isObject())
-			{
-				LOG << "Faled to parse client dialogs #" << i << " - dialog #" << j << " value type must be an object (actual type is " << dialogValue.type() << ")";
-				continue;
-			}
-
-			const QJsonObject dialogObject = dialogValue.toObject();
-
+			// each dialog has its own reader, so a broken dialog doesn't stop reading the others
 			bool ok = false;
-			Dialog dialog = DialogJsonReader().read(toString(dialogObject), ok);
+			DialogJsonReader reader;
+			Dialog dialog = reader.read(dialogJson.second, ok);
 			if (!ok)
 			{
-				LOG << "Faled to parse client dialogs #" << i << " - failed to parse dialog #" << j;
+				LOG << "Faled to parse client dialogs #" << i << " - failed to parse dialog #" << dialogJson.first << ": " << reader.errorString();
 				continue;
 			}
 
@@ -711,6 +826,11 @@ void BackendConnection::onDialogsLoadSuccess(IBackendConnection::QueryId queryId
 		result.insert(clientId, dialogsList);
 	}
 
+	if (parser.hasError())
+	{
+		LOG << "Failed to parse dialogs: " << parser.errorString();
+	}
+
 	emit dialogsLoaded(queryId, result);
 }
 
@@ -818,7 +938,7 @@ BackendConnection::Processor BackendConnection::makeProcessor(const QString& que
 	if (queryType == "dialogs_load")
 	{
 		return Processor(
-			[this](IBackendConnection::QueryId queryId, const QJsonObject& data) { onDialogsLoadSuccess(queryId, data); },
+			[this](IBackendConnection::QueryId queryId, const QByteArray& message) { onDialogsLoadSuccess(queryId, message); },
 			[this](IBackendConnection::QueryId queryId, const QJsonObject& error) { onDialogsLoadFailure(queryId, error); },
 			[this](IBackendConnection::QueryId queryId, const QString& errorMessage) { emit dialogsLoadFailed(queryId, errorMessage); },
 			[this](IBackendConnection::QueryId queryId, const QString& errorMessage) { emit dialogsLoadFailed(queryId, errorMessage); }
@@ -35,9 +35,10 @@ private:
 private:
 	void onWebSocketDisconnected();
 	void onWebSocketError(const QString& errorMessage);
-	void onWebSocketMessage(const QJsonObject& message);
+	void onWebSocketMessage(const QByteArray& message);
 
 	QueryId sendMessage(const QJsonObject& message);
+	QueryId sendMessage(QueryId queryId, const QString& type, const QByteArray& message);
 
 	void onLogInSuccess(IBackendConnection::QueryId queryId);
 	void onLogInFailure(IBackendConnection::QueryId queryId, const QJsonObject& message);
@@ -57,7 +58,7 @@ private:
 	void onUsersUpdateSuccess(IBackendConnection::QueryId queryId);
 	void onUsersUpdateFailure(IBackendConnection::QueryId queryId, const QJsonObject& message);
 
-	void onDialogsLoadSuccess(IBackendConnection::QueryId queryId, const QJsonObject& message);
+	void onDialogsLoadSuccess(IBackendConnection::QueryId queryId, const QByteArray& message);
 	void onDialogsLoadFailure(IBackendConnection::QueryId queryId, const QJsonObject& message);
 
 	void onDialogsUpdateSuccess(IBackendConnection::QueryId queryId);
@@ -73,6 +74,8 @@ private:
 	struct Processor
 	{
 		typedef std::function<void(IBackendConnection::QueryId queryId, const QJsonObject& message)> ProcessMessage;
+		// Reads the data from the whole message JSON instead of a parsed document
+		typedef std::function<void(IBackendConnection::QueryId queryId, const QByteArray& message)> ProcessRawMessage;
 		typedef std::function<void(IBackendConnection::QueryId queryId, const QString&)> ProcessWebSocketDisconnect;
 		typedef std::function<void(IBackendConnection::QueryId queryId, const QString& errorMessage)> ProcessWebSocketError;
 
@@ -92,7 +95,16 @@ private:
 		{
 		}
 
+		Processor(ProcessRawMessage processRawData, ProcessMessage processError, ProcessWebSocketDisconnect processWebSocketDisconnect, ProcessWebSocketError processWebSocketError)
+			: processRawData(processRawData)
+			, processError(processError)
+			, processWebSocketDisconnect(processWebSocketDisconnect)
+			, processWebSocketError(processWebSocketError)
+		{
+		}
+
 		ProcessMessage processData;
+		ProcessRawMessage processRawData;
 		ProcessMessage processError;
 		ProcessWebSocketDisconnect processWebSocketDisconnect;
 		ProcessWebSocketError processWebSocketError;
@@ -101,6 +113,9 @@ private:
 	Processor makeProcessor(const QString& queryType);
 
 	QMap<IBackendConnection::QueryId, Processor> m_activeQueries;
+
+	// reused by the messages written with JsonStreamWriter
+	QByteArray m_messageBuffer;
 };
 
 }
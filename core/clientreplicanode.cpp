@@ -1,5 +1,6 @@
 #include "clientreplicanode.h"
 #include "hashcombine.h"
+#include "memoryusage.h"
 
 namespace Core
 {
@@ -17,6 +18,7 @@ QString ClientReplicaNode::replica() const
 void ClientReplicaNode::setReplica(const QString& replica)
 {
 	m_replica = replica;
+	invalidateHash();
 }
 
 int ClientReplicaNode::type() const
@@ -53,6 +55,16 @@ size_t ClientReplicaNode::calculateHash() const
 	return seed;
 }
 
+size_t ClientReplicaNode::objectSize() const
+{
+	return sizeof(*this);
+}
+
+void ClientReplicaNode::accountData(MemoryCounter& counter) const
+{
+	counter.addString(m_replica);
+}
+
 bool operator==(const ClientReplicaNode& left, const ClientReplicaNode& right)
 {
 	return left.replica() == right.replica();
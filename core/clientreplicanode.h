@@ -27,6 +27,8 @@ private:
 	virtual AbstractDialogNode* shallowCopy() const override;
 	virtual bool compareData(AbstractDialogNode* other) const override;
 	virtual size_t calculateHash() const override;
+	virtual size_t objectSize() const override;
+	virtual void accountData(MemoryCounter& counter) const override;
 
 private:
 	QString m_replica;
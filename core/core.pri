@@ -0,0 +1,70 @@
+# Dialog model shared by the editor and the command line tools
+
+QT += concurrent
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+	$$PWD/abstractdialognode.cpp \
+	$$PWD/clientreplicanode.cpp \
+	$$PWD/expectedwordsnode.cpp \
+	$$PWD/phasenode.cpp \
+	$$PWD/dialog.cpp \
+	$$PWD/dialogjsonreader.cpp \
+	$$PWD/jsonpullparser.cpp \
+	$$PWD/dialogjsonwriter.cpp \
+	$$PWD/jsonstreamwriter.cpp \
+	$$PWD/dialogbinaryreader.cpp \
+	$$PWD/dialogbinarywriter.cpp \
+	$$PWD/dialogvalidator.cpp \
+	$$PWD/topologicalorder.cpp \
+	$$PWD/dialogdiff.cpp \
+	$$PWD/dialogsimulator.cpp \
+	$$PWD/expectedwordsmatcher.cpp \
+	$$PWD/textnormalizer.cpp \
+	$$PWD/fuzzymatcher.cpp \
+	$$PWD/dialoganalysis.cpp \
+	$$PWD/expectedwordsindex.cpp \
+	$$PWD/dialogsearchindex.cpp \
+	$$PWD/dialogrewriter.cpp \
+	$$PWD/stringpool.cpp \
+	$$PWD/memoryusage.cpp \
+	$$PWD/modelmemoryreport.cpp \
+	$$PWD/phasetemplatelibrary.cpp \
+	$$PWD/dialogcontentstore.cpp \
+	$$PWD/dialogsnapshot.cpp
+
+HEADERS += \
+	$$PWD/abstractdialognode.h \
+	$$PWD/clientreplicanode.h \
+	$$PWD/expectedwordsnode.h \
+	$$PWD/phasenode.h \
+	$$PWD/dialog.h \
+	$$PWD/dialogjsonreader.h \
+	$$PWD/jsonpullparser.h \
+	$$PWD/dialogjsonwriter.h \
+	$$PWD/jsonstreamwriter.h \
+	$$PWD/dialogbinaryformat.h \
+	$$PWD/dialogbinaryreader.h \
+	$$PWD/dialogbinarywriter.h \
+	$$PWD/dialogvalidator.h \
+	$$PWD/topologicalorder.h \
+	$$PWD/dialogdiff.h \
+	$$PWD/dialogsimulator.h \
+	$$PWD/expectedwordsmatcher.h \
+	$$PWD/textnormalizer.h \
+	$$PWD/fuzzymatcher.h \
+	$$PWD/dialoganalysis.h \
+	$$PWD/expectedwordsindex.h \
+	$$PWD/dialogsearchindex.h \
+	$$PWD/dialogrewriter.h \
+	$$PWD/stringpool.h \
+	$$PWD/memoryusage.h \
+	$$PWD/modelmemoryreport.h \
+	$$PWD/phasetemplatelibrary.h \
+	$$PWD/dialogcontentstore.h \
+	$$PWD/dialogsnapshot.h \
+	$$PWD/errorreplica.h \
+	$$PWD/hashcombine.h \
+	$$PWD/../optional.h \
+	$$PWD/../logger.h
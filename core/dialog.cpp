@@ -1,4 +1,6 @@
 #include "dialog.h"
+#include "hashcombine.h"
+#include "memoryusage.h"
 #include "logger.h"
 
 namespace Core
@@ -19,25 +21,20 @@ Dialog::Dialog(const QString& name, Difficulty difficulty, const QString& note,
 {
 }
 
-Dialog::Dialog(const Dialog& other)
-	: name(other.name)
-	, difficulty(other.difficulty)
-	, note(other.note)
-	, errorReplica(other.errorReplica)
-	, phaseRepeatReplica(other.phaseRepeatReplica)
-	, successRatio(other.successRatio)
-	, groups(other.groups)
-{
-	for (const PhaseNode& phase : other.phases)
-	{
-		phases.append(PhaseNode(phase));
-	}
-}
+// All fields are implicitly shared, phases share their nodes until modified,
+// so copying a dialog doesn't depend on its size
+Dialog::Dialog(const Dialog& other) = default;
+
+Dialog::Dialog(Dialog&& other) = default;
 
 Dialog::~Dialog()
 {
 }
 
+Dialog& Dialog::operator=(const Dialog& other) = default;
+
+Dialog& Dialog::operator=(Dialog&& other) = default;
+
 QString Dialog::printableName() const
 {
 	return printableName(name, difficulty);
@@ -84,6 +81,52 @@ QStringList Dialog::availableDifficulties()
 	return { difficultyToString(Difficulty::Easy), difficultyToString(Difficulty::Hard) };
 }
 
+size_t Dialog::hash() const
+{
+	size_t seed = 0;
+
+	hashCombine(seed, name);
+	hashCombine(seed, static_cast<int>(difficulty));
+	hashCombine(seed, note);
+	hashCombine(seed, errorReplica);
+	hashCombine(seed, phaseRepeatReplica);
+	hashCombine(seed, successRatio);
+	hashCombine(seed, groups);
+
+	for (const PhaseNode& phase : phases)
+	{
+		hashCombine(seed, phase.contentHash());
+	}
+
+	return seed;
+}
+
+void Dialog::accountMemory(MemoryCounter& counter) const
+{
+	if (!counter.addObject(this, sizeof(*this)))
+	{
+		return;
+	}
+
+	counter.addString(name);
+	counter.addString(note);
+	counter.addErrorReplica(errorReplica);
+	if (phaseRepeatReplica)
+	{
+		counter.addString(*phaseRepeatReplica);
+	}
+	counter.addStrings(groups);
+
+	// PhaseNode is a large type, QList keeps every phase in its own allocation
+	if (!phases.isEmpty() && counter.addContainer(&phases.first(), phases.size(), sizeof(void*)))
+	{
+		for (const PhaseNode& phase : phases)
+		{
+			phase.accountMemory(counter);
+		}
+	}
+}
+
 bool operator<(const Dialog& left, const Dialog& right)
 {
 	return left.printableName() < right.printableName();
@@ -91,9 +134,21 @@ bool operator<(const Dialog& left, const Dialog& right)
 
 bool operator==(const Dialog& left, const Dialog& right)
 {
+	const auto samePhases = [&left, &right]()
+	{
+		return left.phases.isSharedWith(right.phases) ||
+			(left.phases.size() == right.phases.size() &&
+				std::equal(left.phases.begin(), left.phases.end(), right.phases.begin()));
+	};
+
+	// phases are hashed only if they aren't shared, otherwise comparing them is already cheap
+	if (!left.phases.isSharedWith(right.phases) && left.hash() != right.hash())
+	{
+		return false;
+	}
+
 	return left.name == right.name && left.difficulty == right.difficulty &&
-		left.note == right.note && left.phases.size() == right.phases.size() &&
-		std::equal(left.phases.begin(), left.phases.end(), right.phases.begin()) &&
+		left.note == right.note && samePhases() &&
 		left.errorReplica == right.errorReplica &&
 		left.phaseRepeatReplica == right.phaseRepeatReplica &&
 		left.successRatio == right.successRatio &&
@@ -10,6 +10,8 @@
 namespace Core
 {
 
+class MemoryCounter;
+
 class Dialog
 {
 public:
@@ -22,8 +24,12 @@ public:
 	Dialog();
 	Dialog(const QString& name, Difficulty difficulty, const QString& note, const QList<PhaseNode>& phases, const ErrorReplica& errorReplica, double successRatio, QList<QString> groups);
 	Dialog(const Dialog& other);
+	Dialog(Dialog&& other);
 	~Dialog();
 
+	Dialog& operator=(const Dialog& other);
+	Dialog& operator=(Dialog&& other);
+
 	QString printableName() const;
 	static QString printableName(const QString& name, Difficulty difficulty);
 
@@ -32,6 +38,13 @@ public:
 	static Difficulty difficultyFromString(const QString& string);
 	static QStringList availableDifficulties();
 
+	// Combines the dialog fields with the cached hashes of the phases, see PhaseNode::contentHash().
+	// Equal dialogs have equal hashes
+	size_t hash() const;
+
+	// Adds the dialog with its phases and nodes, see MemoryCounter
+	void accountMemory(MemoryCounter& counter) const;
+
 	QString name;
 	Difficulty difficulty;
 	QString note;
@@ -47,4 +60,9 @@ bool operator<(const Dialog& left, const Dialog& right);
 bool operator==(const Dialog& left, const Dialog& right);
 bool operator!=(const Dialog& left, const Dialog& right);
 
+inline uint qHash(const Dialog& dialog, uint seed = 0)
+{
+	return ::qHash(dialog.hash(), seed);
+}
+
 }
@@ -0,0 +1,312 @@
+#include "dialoganalysis.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+// Adds the range of some paths to the range of the paths counted before
+void mergeRange(DialogAnalysis::ScoreRange& range, double paths, const DialogAnalysis::ScoreRange& other)
+{
+	if (paths == 0.0)
+	{
+		range = other;
+		return;
+	}
+
+	range.min = std::min(range.min, other.min);
+	range.max = std::max(range.max, other.max);
+}
+
+QString formatNumber(double value)
+{
+	return QString::number(value, 'g', 15);
+}
+
+}
+
+DialogAnalysis::DialogAnalysis(const Dialog& dialog)
+	: m_successRatio(dialog.successRatio)
+	, m_paths(0.0)
+	, m_score({ 0.0, 0.0 })
+	, m_maxPossibleScore(0.0)
+{
+	QHash<AbstractDialogNode::Id, int> indexes;
+
+	for (int phaseIndex = 0; phaseIndex < dialog.phases.size(); ++phaseIndex)
+	{
+		const PhaseNode& phase = dialog.phases.at(phaseIndex);
+		m_phases.append({ phase.id(), phase.name(), 0.0, { 0.0, 0.0 }, phase.score() });
+
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			Node entry { node, phaseIndex, {}, {}, { 0.0, 0.0 }, 0.0 };
+
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (expectedWordsNode)
+			{
+				entry.bestPossibleScore = expectedWordsNode->bestPossibleScore();
+				if (!expectedWordsNode->forbidden())
+				{
+					entry.score = { static_cast<double>(expectedWordsNode->minScore()), entry.bestPossibleScore };
+				}
+			}
+
+			indexes.insert(node->id(), m_nodes.size());
+			m_nodes.append(entry);
+		}
+	}
+
+	for (int i = 0; i < m_nodes.size(); ++i)
+	{
+		for (const AbstractDialogNode::Id& id : m_nodes[i].node->childNodes())
+		{
+			const int child = indexes.value(id, -1);
+			if (child >= 0)
+			{
+				m_nodes[i].children.append(child);
+				m_nodes[child].parents.append(i);
+			}
+		}
+	}
+
+	const QVector<int> order = topologicalOrder();
+
+	const int nodesCount = m_nodes.size();
+	const int lastPhase = m_phases.size() - 1;
+
+	// paths inside of the phase ending at the node
+	QVector<double> phasePaths(nodesCount, 0.0);
+	QVector<ScoreRange> phaseScores(nodesCount);
+	QVector<double> phaseBestScores(nodesCount, 0.0);
+	QVector<double> maxPossiblePhaseScores(m_phases.size(), 0.0);
+
+	// learner paths from the start of the dialog ending at the node
+	QVector<double> paths(nodesCount, 0.0);
+	QVector<ScoreRange> scores(nodesCount);
+
+	// parents are always processed before their children, nodes on cycles are not processed at all
+	for (int index : order)
+	{
+		const Node& node = m_nodes[index];
+
+		const bool phaseEntry = node.parents.isEmpty() ||
+			std::any_of(node.parents.begin(), node.parents.end(), [this, &node](int parent) { return m_nodes[parent].phase != node.phase; });
+		if (phaseEntry)
+		{
+			phasePaths[index] = 1.0;
+			phaseScores[index] = { 0.0, 0.0 };
+		}
+		else
+		{
+			for (int parent : node.parents)
+			{
+				if (phasePaths[parent] > 0.0)
+				{
+					mergeRange(phaseScores[index], phasePaths[index], phaseScores[parent]);
+					phasePaths[index] += phasePaths[parent];
+					phaseBestScores[index] = std::max(phaseBestScores[index], phaseBestScores[parent]);
+				}
+			}
+		}
+
+		phaseScores[index].min += node.score.min;
+		phaseScores[index].max += node.score.max;
+		phaseBestScores[index] += node.bestPossibleScore;
+
+		const bool phaseExit = node.children.isEmpty() ||
+			std::any_of(node.children.begin(), node.children.end(), [this, &node](int child) { return m_nodes[child].phase != node.phase; });
+		if (phaseExit && phasePaths[index] > 0.0)
+		{
+			Phase& phase = m_phases[node.phase];
+			mergeRange(phase.score, phase.paths, phaseScores[index]);
+			phase.paths += phasePaths[index];
+			maxPossiblePhaseScores[node.phase] = std::max(maxPossiblePhaseScores[node.phase], phaseBestScores[index]);
+		}
+
+		if (node.parents.isEmpty())
+		{
+			// nodes without parents in other phases can't be reached
+			if (node.phase == 0)
+			{
+				paths[index] = 1.0;
+				scores[index] = { 0.0, 0.0 };
+			}
+		}
+		else
+		{
+			for (int parent : node.parents)
+			{
+				if (paths[parent] > 0.0)
+				{
+					mergeRange(scores[index], paths[index], scores[parent]);
+					paths[index] += paths[parent];
+				}
+			}
+		}
+
+		if (paths[index] == 0.0)
+		{
+			m_unreachableNodes.append(node.node->id());
+			continue;
+		}
+
+		scores[index].min += node.score.min;
+		scores[index].max += node.score.max;
+
+		if (node.children.isEmpty())
+		{
+			mergeRange(m_score, m_paths, scores[index]);
+			m_paths += paths[index];
+
+			if (node.phase != lastPhase)
+			{
+				m_deadEnds.append(node.node->id());
+			}
+		}
+	}
+
+	for (double score : maxPossiblePhaseScores)
+	{
+		m_maxPossibleScore += score;
+	}
+}
+
+const QList<DialogAnalysis::Phase>& DialogAnalysis::phases() const
+{
+	return m_phases;
+}
+
+double DialogAnalysis::paths() const
+{
+	return m_paths;
+}
+
+DialogAnalysis::ScoreRange DialogAnalysis::score() const
+{
+	return m_score;
+}
+
+double DialogAnalysis::maxPossibleScore() const
+{
+	return m_maxPossibleScore;
+}
+
+bool DialogAnalysis::successRatioAchievable() const
+{
+	if (m_paths == 0.0)
+	{
+		return false;
+	}
+
+	// the same as the simulator does, a dialog without scores is passed by finishing it
+	if (m_maxPossibleScore <= 0.0)
+	{
+		return true;
+	}
+
+	return m_score.max / m_maxPossibleScore * 100.0 >= m_successRatio;
+}
+
+const QList<AbstractDialogNode::Id>& DialogAnalysis::unreachableNodes() const
+{
+	return m_unreachableNodes;
+}
+
+const QList<AbstractDialogNode::Id>& DialogAnalysis::deadEnds() const
+{
+	return m_deadEnds;
+}
+
+const QList<AbstractDialogNode::Id>& DialogAnalysis::cyclicNodes() const
+{
+	return m_cyclicNodes;
+}
+
+QStringList DialogAnalysis::summary() const
+{
+	QStringList result;
+
+	result.append("Путей прохождения: " + formatNumber(m_paths));
+	if (m_paths > 0.0)
+	{
+		result.append("Баллы: от " + formatNumber(m_score.min) + " до " + formatNumber(m_score.max) + " из " + formatNumber(m_maxPossibleScore));
+	}
+
+	result.append(QString(successRatioAchievable() ? "Проходной процент (%1%) достижим" : "Проходной процент (%1%) недостижим")
+		.arg(formatNumber(m_successRatio)));
+
+	for (const Phase& phase : m_phases)
+	{
+		QString line = "Фаза \"" + phase.name + "\": путей " + formatNumber(phase.paths);
+		if (phase.paths > 0.0)
+		{
+			line += ", баллы от " + formatNumber(phase.score.min) + " до " + formatNumber(phase.score.max);
+		}
+		line += ", проходной балл " + formatNumber(phase.requiredScore);
+		if (phase.paths == 0.0 || phase.score.max < phase.requiredScore)
+		{
+			line += " (недостижим)";
+		}
+		result.append(line);
+	}
+
+	if (!m_unreachableNodes.isEmpty())
+	{
+		result.append("Недостижимых блоков: " + QString::number(m_unreachableNodes.size()));
+	}
+
+	if (!m_deadEnds.isEmpty())
+	{
+		result.append("Тупиков: " + QString::number(m_deadEnds.size()));
+	}
+
+	if (!m_cyclicNodes.isEmpty())
+	{
+		result.append("Блоков в циклах: " + QString::number(m_cyclicNodes.size()));
+	}
+
+	return result;
+}
+
+QVector<int> DialogAnalysis::topologicalOrder()
+{
+	QVector<int> parentsLeft(m_nodes.size());
+	QVector<int> order;
+	order.reserve(m_nodes.size());
+
+	for (int i = 0; i < m_nodes.size(); ++i)
+	{
+		parentsLeft[i] = m_nodes[i].parents.size();
+		if (parentsLeft[i] == 0)
+		{
+			order.append(i);
+		}
+	}
+
+	for (int i = 0; i < order.size(); ++i)
+	{
+		for (int child : m_nodes[order[i]].children)
+		{
+			if (--parentsLeft[child] == 0)
+			{
+				order.append(child);
+			}
+		}
+	}
+
+	for (int i = 0; i < m_nodes.size(); ++i)
+	{
+		if (parentsLeft[i] > 0)
+		{
+			m_cyclicNodes.append(m_nodes[i].node->id());
+		}
+	}
+
+	return order;
+}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QVector>
+
+namespace Core
+{
+
+// Paths and score ranges of a dialog, calculated by dynamic programming over the nodes
+// in topological order, so it is linear in the number of links however many paths there are.
+//
+// A learner path starts at a node without parents of the first phase and ends at a node without children.
+// A phase path starts at a node without parents in the phase and ends at a node without children in the phase,
+// the same way PhaseNode::bestPossibleScore() sees it.
+// Passing an expected words node gives from its minScore to the sum of its positive expected words,
+// forbidden nodes give nothing. Nodes on cycles are reported and excluded from the calculation.
+class DialogAnalysis
+{
+public:
+	struct ScoreRange
+	{
+		double min;
+		double max;
+	};
+
+	struct Phase
+	{
+		AbstractDialogNode::Id id;
+		QString name;
+		// counts are doubles because they grow exponentially with the size of the dialog
+		double paths;
+		ScoreRange score;
+		// score required to pass the phase
+		double requiredScore;
+	};
+
+	explicit DialogAnalysis(const Dialog& dialog);
+
+	const QList<Phase>& phases() const;
+
+	double paths() const;
+	ScoreRange score() const;
+	// the score the success ratio is calculated from, the sum of the best possible scores of the phases
+	double maxPossibleScore() const;
+	bool successRatioAchievable() const;
+
+	const QList<AbstractDialogNode::Id>& unreachableNodes() const;
+	// nodes without children outside of the last phase
+	const QList<AbstractDialogNode::Id>& deadEnds() const;
+	// nodes on cycles and the nodes following them
+	const QList<AbstractDialogNode::Id>& cyclicNodes() const;
+
+	QStringList summary() const;
+
+private:
+	struct Node
+	{
+		const AbstractDialogNode* node;
+		int phase;
+		QVector<int> parents;
+		QVector<int> children;
+		ScoreRange score;
+		double bestPossibleScore;
+	};
+
+	QVector<int> topologicalOrder();
+
+private:
+	double m_successRatio;
+
+	QVector<Node> m_nodes;
+	QList<Phase> m_phases;
+
+	double m_paths;
+	ScoreRange m_score;
+	double m_maxPossibleScore;
+
+	QList<AbstractDialogNode::Id> m_unreachableNodes;
+	QList<AbstractDialogNode::Id> m_deadEnds;
+	QList<AbstractDialogNode::Id> m_cyclicNodes;
+};
+
+}
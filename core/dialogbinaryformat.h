@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace Core
+{
+
+// Binary encoding of a dialog used by DialogBinaryWriter and DialogBinaryReader.
+//
+// header:     magic "VCDB", version (varint)
+// strings:    count, then byte length and UTF-8 bytes of every distinct text of the dialog
+// dialog:     name, difficulty, note, successRatio, errorReplica, flags, [phaseRepeatReplica], groups, phases
+// phase:      id, name, score, flags, [repeatReplica], errorReplica, nodes
+// node:       type, id, parentNodes, childNodes, then replica or expected words data
+// expected:   flags, minScore, hint, count, (words, score) pairs
+// error:      flags, [errorReplica], [errorPenalty], [finishingExpectedWords], [finishingReplica]
+//
+// Counts and enums are unsigned varints, texts and ids are varint indexes in the string table, so repeated
+// texts like default error replicas and node ids used as links are stored once. Numbers are zigzag varints
+// shifted left by one when they are integers, otherwise 1 followed by the 8 bytes of the double.
+// Fields added later go to the end of their records with a new version, older versions stay readable.
+namespace DialogBinaryFormat
+{
+
+const char Magic[] = "VCDB";
+const int MagicSize = 4;
+const quint32 Version = 1;
+
+enum class NodeType : quint8
+{
+	ClientReplica = 0,
+	ExpectedWords = 1
+};
+
+enum DialogFlag : quint8
+{
+	HasPhaseRepeatReplica = 1
+};
+
+enum PhaseFlag : quint8
+{
+	RepeatOnInsufficientScore = 1,
+	HasRepeatReplica = 2
+};
+
+enum ExpectedWordsFlag : quint8
+{
+	Forbidden = 1,
+	CustomHint = 2
+};
+
+enum ErrorReplicaFlag : quint8
+{
+	HasErrorReplica = 1,
+	HasErrorPenalty = 2,
+	HasFinishingExpectedWords = 4,
+	HasFinishingReplica = 8
+};
+
+}
+
+}
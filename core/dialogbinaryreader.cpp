@@ -0,0 +1,471 @@
+#include "dialogbinaryreader.h"
+#include "dialogbinaryformat.h"
+#include "stringpool.h"
+#include "logger.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace Core
+{
+
+namespace
+{
+
+using namespace DialogBinaryFormat;
+
+qint64 unzigzag(quint64 value)
+{
+	return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+// Every read checks the bounds, the first failure stops the decoding
+class Decoder
+{
+public:
+	Decoder(const QByteArray& data)
+		: m_position(data.constData())
+		, m_end(data.constData() + data.size())
+	{
+	}
+
+	bool readHeader()
+	{
+		if (m_end - m_position < MagicSize || std::memcmp(m_position, Magic, MagicSize) != 0)
+		{
+			return fail("это не двоичный формат диалога");
+		}
+		m_position += MagicSize;
+
+		quint64 version = 0;
+		if (!readVarint(version))
+		{
+			return false;
+		}
+
+		if (version == 0 || version > Version)
+		{
+			return fail(QString("неподдерживаемая версия формата %1").arg(version));
+		}
+
+		quint64 count = 0;
+		if (!readCount(count))
+		{
+			return false;
+		}
+
+		// every distinct text is decoded once and shared by all its uses
+		m_strings.reserve(static_cast<int>(count));
+		for (quint64 i = 0; i < count; ++i)
+		{
+			quint64 size = 0;
+			if (!readVarint(size))
+			{
+				return false;
+			}
+
+			if (size > static_cast<quint64>(m_end - m_position))
+			{
+				return fail("данные обрезаны");
+			}
+
+			m_strings.append(QString::fromUtf8(m_position, static_cast<int>(size)));
+			m_position += size;
+		}
+
+		return true;
+	}
+
+	bool readDialog(Dialog& dialog)
+	{
+		quint64 difficulty = 0;
+		quint8 flags = 0;
+		QString phaseRepeatReplica;
+		quint64 phases = 0;
+
+		const bool ok = readString(dialog.name) &&
+			readVarint(difficulty) &&
+			readString(dialog.note) &&
+			readNumber(dialog.successRatio) &&
+			readErrorReplica(dialog.errorReplica) &&
+			readByte(flags) &&
+			(!(flags & HasPhaseRepeatReplica) || readString(phaseRepeatReplica)) &&
+			readStrings(dialog.groups) &&
+			readCount(phases);
+		if (!ok)
+		{
+			return false;
+		}
+
+		if (difficulty > static_cast<quint64>(Dialog::Difficulty::Hard))
+		{
+			return fail("неверная сложность диалога");
+		}
+
+		dialog.difficulty = static_cast<Dialog::Difficulty>(difficulty);
+		dialog.groups = StringPool::intern(dialog.groups);
+		if (flags & HasPhaseRepeatReplica)
+		{
+			dialog.phaseRepeatReplica = StringPool::intern(phaseRepeatReplica);
+		}
+
+		for (quint64 i = 0; i < phases; ++i)
+		{
+			if (!readPhase(dialog.phases))
+			{
+				return false;
+			}
+		}
+
+		if (m_position != m_end)
+		{
+			return fail("лишние данные после диалога");
+		}
+
+		return true;
+	}
+
+	const QString& errorString() const
+	{
+		return m_error;
+	}
+
+private:
+	bool fail(const QString& message)
+	{
+		if (m_error.isEmpty())
+		{
+			m_error = message;
+		}
+		return false;
+	}
+
+	bool readByte(quint8& value)
+	{
+		if (m_position == m_end)
+		{
+			return fail("данные обрезаны");
+		}
+
+		value = static_cast<quint8>(*m_position++);
+		return true;
+	}
+
+	bool readVarint(quint64& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			quint8 byte = 0;
+			if (!readByte(byte))
+			{
+				return false;
+			}
+
+			value |= static_cast<quint64>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+
+		return fail("неверное число");
+	}
+
+	// Counts can't exceed the number of remaining bytes, so broken data doesn't cause huge allocations
+	bool readCount(quint64& value)
+	{
+		if (!readVarint(value))
+		{
+			return false;
+		}
+
+		if (value > static_cast<quint64>(m_end - m_position))
+		{
+			return fail("неверное количество элементов");
+		}
+
+		return true;
+	}
+
+	bool readNumber(double& value)
+	{
+		quint64 header = 0;
+		if (!readVarint(header))
+		{
+			return false;
+		}
+
+		if (!(header & 1))
+		{
+			value = static_cast<double>(unzigzag(header >> 1));
+			return true;
+		}
+
+		if (header != 1 || m_end - m_position < static_cast<int>(sizeof(quint64)))
+		{
+			return fail("неверное число");
+		}
+
+		quint64 bits = 0;
+		std::memcpy(&bits, m_position, sizeof(bits));
+		bits = qFromLittleEndian(bits);
+		std::memcpy(&value, &bits, sizeof(value));
+		m_position += sizeof(bits);
+		return true;
+	}
+
+	bool readString(QString& value)
+	{
+		quint64 index = 0;
+		if (!readVarint(index))
+		{
+			return false;
+		}
+
+		if (index >= static_cast<quint64>(m_strings.size()))
+		{
+			return fail("неверный номер строки");
+		}
+
+		value = m_strings[static_cast<int>(index)];
+		return true;
+	}
+
+	template <typename Container>
+	bool readStrings(Container& values)
+	{
+		quint64 count = 0;
+		if (!readCount(count))
+		{
+			return false;
+		}
+
+		for (quint64 i = 0; i < count; ++i)
+		{
+			QString value;
+			if (!readString(value))
+			{
+				return false;
+			}
+			values << value;
+		}
+
+		return true;
+	}
+
+	bool readErrorReplica(ErrorReplica& error)
+	{
+		quint8 flags = 0;
+		if (!readByte(flags))
+		{
+			return false;
+		}
+
+		if (flags & HasErrorReplica)
+		{
+			QString text;
+			if (!readString(text))
+			{
+				return false;
+			}
+			error.errorReplica = text;
+		}
+
+		if (flags & HasErrorPenalty)
+		{
+			double penalty = 0.0;
+			if (!readNumber(penalty))
+			{
+				return false;
+			}
+			error.errorPenalty = penalty;
+		}
+
+		if (flags & HasFinishingExpectedWords)
+		{
+			QList<QString> words;
+			if (!readStrings(words))
+			{
+				return false;
+			}
+			error.finishingExpectedWords = words;
+		}
+
+		if (flags & HasFinishingReplica)
+		{
+			QString text;
+			if (!readString(text))
+			{
+				return false;
+			}
+			error.finishingReplica = text;
+		}
+
+		StringPool::intern(error);
+		return true;
+	}
+
+	bool readPhase(QList<PhaseNode>& phases)
+	{
+		QString id;
+		QString name;
+		double score = 0.0;
+		quint8 flags = 0;
+		QString repeatReplica;
+		ErrorReplica errorReplica;
+		quint64 count = 0;
+
+		const bool ok = readString(id) &&
+			readString(name) &&
+			readNumber(score) &&
+			readByte(flags) &&
+			(!(flags & HasRepeatReplica) || readString(repeatReplica)) &&
+			readErrorReplica(errorReplica) &&
+			readCount(count);
+		if (!ok)
+		{
+			return false;
+		}
+
+		QList<AbstractDialogNode*> nodes;
+		for (quint64 i = 0; i < count; ++i)
+		{
+			AbstractDialogNode* node = readNode();
+			if (!node)
+			{
+				// the nodes aren't owned by a phase yet
+				qDeleteAll(nodes);
+				return false;
+			}
+			nodes.append(node);
+		}
+
+		PhaseNode phase(name, score, flags & RepeatOnInsufficientScore, nodes, errorReplica);
+		phase.setId(id);
+		if (flags & HasRepeatReplica)
+		{
+			phase.repeatReplica() = StringPool::intern(repeatReplica);
+		}
+
+		phases.append(phase);
+		return true;
+	}
+
+	AbstractDialogNode* readNode()
+	{
+		quint8 type = 0;
+		AbstractDialogNode::Id id;
+		QList<AbstractDialogNode::Id> parents;
+		QList<AbstractDialogNode::Id> children;
+
+		if (!readByte(type) || !readString(id) || !readStrings(parents) || !readStrings(children))
+		{
+			return nullptr;
+		}
+
+		AbstractDialogNode* node = nullptr;
+		if (type == static_cast<quint8>(NodeType::ClientReplica))
+		{
+			node = readClientReplicaNode();
+		}
+		else if (type == static_cast<quint8>(NodeType::ExpectedWords))
+		{
+			node = readExpectedWordsNode();
+		}
+		else
+		{
+			fail("неизвестный тип узла");
+		}
+
+		if (!node)
+		{
+			return nullptr;
+		}
+
+		node->setId(id);
+		for (const AbstractDialogNode::Id& parent : parents)
+		{
+			node->appendParent(parent);
+		}
+		for (const AbstractDialogNode::Id& child : children)
+		{
+			node->appendChild(child);
+		}
+
+		return node;
+	}
+
+	AbstractDialogNode* readClientReplicaNode()
+	{
+		QString replica;
+		if (!readString(replica))
+		{
+			return nullptr;
+		}
+
+		return new ClientReplicaNode(replica);
+	}
+
+	AbstractDialogNode* readExpectedWordsNode()
+	{
+		quint8 flags = 0;
+		quint64 minScore = 0;
+		QString hint;
+		quint64 count = 0;
+
+		if (!readByte(flags) || !readVarint(minScore) || !readString(hint) || !readCount(count))
+		{
+			return nullptr;
+		}
+
+		QList<ExpectedWords> expectedWords;
+		for (quint64 i = 0; i < count; ++i)
+		{
+			QString words;
+			double score = 0.0;
+			if (!readString(words) || !readNumber(score))
+			{
+				return nullptr;
+			}
+			expectedWords.append(ExpectedWords(words, score));
+		}
+
+		ExpectedWordsNode* node = new ExpectedWordsNode(expectedWords, static_cast<int>(unzigzag(minScore)), hint, flags & Forbidden);
+		node->setCustomHint(flags & CustomHint);
+		return node;
+	}
+
+private:
+	const char* m_position;
+	const char* m_end;
+	QVector<QString> m_strings;
+	QString m_error;
+};
+
+}
+
+Dialog DialogBinaryReader::read(const QByteArray& data, bool& ok)
+{
+	Decoder decoder(data);
+
+	Dialog dialog;
+	ok = decoder.readHeader() && decoder.readDialog(dialog);
+	if (!ok)
+	{
+		m_error = decoder.errorString();
+		LOG << "Failed to read the dialog: " << m_error;
+		return Dialog();
+	}
+
+	m_error.clear();
+	return dialog;
+}
+
+const QString& DialogBinaryReader::errorString() const
+{
+	return m_error;
+}
+
+}
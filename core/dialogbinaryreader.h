@@ -0,0 +1,23 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QByteArray>
+
+namespace Core
+{
+
+// Reads dialogs written by DialogBinaryWriter of this or an older version
+class DialogBinaryReader
+{
+public:
+	Dialog read(const QByteArray& data, bool& ok);
+
+	// Reason of the last failed read, empty after a successful one
+	const QString& errorString() const;
+
+private:
+	QString m_error;
+};
+
+}
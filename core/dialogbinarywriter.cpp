@@ -0,0 +1,223 @@
+#include "dialogbinarywriter.h"
+#include "dialogbinaryformat.h"
+
+#include <QHash>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+namespace Core
+{
+
+namespace
+{
+
+using namespace DialogBinaryFormat;
+
+void writeVarint(QByteArray& buffer, quint64 value)
+{
+	while (value >= 0x80)
+	{
+		buffer.append(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	buffer.append(static_cast<char>(value));
+}
+
+quint64 zigzag(qint64 value)
+{
+	return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+void writeNumber(QByteArray& buffer, double value)
+{
+	// scores and penalties are mostly integers, -0.0 keeps its sign in the 8 byte form
+	static const double s_maxInteger = 4503599627370496.0; // 2^52
+	if (std::isfinite(value) && std::floor(value) == value && std::fabs(value) < s_maxInteger && !(value == 0.0 && std::signbit(value)))
+	{
+		writeVarint(buffer, zigzag(static_cast<qint64>(value)) << 1);
+		return;
+	}
+
+	writeVarint(buffer, 1);
+
+	quint64 bits = 0;
+	std::memcpy(&bits, &value, sizeof(bits));
+	bits = qToLittleEndian(bits);
+	buffer.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+}
+
+class Encoder
+{
+public:
+	// Body goes first, the string table is known only after it
+	void writeDialog(const Dialog& dialog)
+	{
+		writeString(dialog.name);
+		writeVarint(m_body, static_cast<quint64>(dialog.difficulty));
+		writeString(dialog.note);
+		writeNumber(m_body, dialog.successRatio);
+		writeErrorReplica(dialog.errorReplica);
+
+		m_body.append(static_cast<char>(dialog.phaseRepeatReplica ? HasPhaseRepeatReplica : 0));
+		if (dialog.phaseRepeatReplica)
+		{
+			writeString(*dialog.phaseRepeatReplica);
+		}
+
+		writeStrings(dialog.groups);
+
+		writeVarint(m_body, dialog.phases.size());
+		for (const PhaseNode& phase : dialog.phases)
+		{
+			writePhase(phase);
+		}
+	}
+
+	void finish(QByteArray& buffer)
+	{
+		buffer.append(Magic, MagicSize);
+		writeVarint(buffer, Version);
+
+		writeVarint(buffer, m_strings.size());
+		for (const QString& string : m_strings)
+		{
+			const QByteArray utf8 = string.toUtf8();
+			writeVarint(buffer, utf8.size());
+			buffer.append(utf8);
+		}
+
+		buffer.append(m_body);
+	}
+
+private:
+	void writeString(const QString& string)
+	{
+		auto it = m_indexes.find(string);
+		if (it == m_indexes.end())
+		{
+			it = m_indexes.insert(string, m_strings.size());
+			m_strings.append(string);
+		}
+
+		writeVarint(m_body, *it);
+	}
+
+	template <typename Container>
+	void writeStrings(const Container& strings)
+	{
+		writeVarint(m_body, strings.size());
+		for (const QString& string : strings)
+		{
+			writeString(string);
+		}
+	}
+
+	void writeErrorReplica(const ErrorReplica& error)
+	{
+		const quint8 flags = (error.errorReplica ? HasErrorReplica : 0) |
+			(error.errorPenalty ? HasErrorPenalty : 0) |
+			(error.finishingExpectedWords ? HasFinishingExpectedWords : 0) |
+			(error.finishingReplica ? HasFinishingReplica : 0);
+		m_body.append(static_cast<char>(flags));
+
+		if (error.errorReplica)
+		{
+			writeString(*error.errorReplica);
+		}
+
+		if (error.errorPenalty)
+		{
+			writeNumber(m_body, *error.errorPenalty);
+		}
+
+		if (error.finishingExpectedWords)
+		{
+			writeStrings(*error.finishingExpectedWords);
+		}
+
+		if (error.finishingReplica)
+		{
+			writeString(*error.finishingReplica);
+		}
+	}
+
+	void writePhase(const PhaseNode& phase)
+	{
+		writeString(phase.id());
+		writeString(phase.name());
+		writeNumber(m_body, phase.score());
+
+		const quint8 flags = (phase.repeatOnInsufficientScore() ? RepeatOnInsufficientScore : 0) |
+			(phase.repeatReplica() ? HasRepeatReplica : 0);
+		m_body.append(static_cast<char>(flags));
+		if (phase.repeatReplica())
+		{
+			writeString(*phase.repeatReplica());
+		}
+
+		writeErrorReplica(phase.errorReplica());
+
+		writeVarint(m_body, phase.nodes().size());
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			writeNode(node);
+		}
+	}
+
+	void writeNode(const AbstractDialogNode* node)
+	{
+		const ClientReplicaNode* clientReplicaNode = node->as<ClientReplicaNode>();
+		const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+		Q_ASSERT(clientReplicaNode || expectedWordsNode);
+
+		m_body.append(static_cast<char>(clientReplicaNode ? NodeType::ClientReplica : NodeType::ExpectedWords));
+		writeString(node->id());
+		writeStrings(node->parentNodes());
+		writeStrings(node->childNodes());
+
+		if (clientReplicaNode)
+		{
+			writeString(clientReplicaNode->replica());
+			return;
+		}
+
+		const quint8 flags = (expectedWordsNode->forbidden() ? Forbidden : 0) |
+			(expectedWordsNode->customHint() ? CustomHint : 0);
+		m_body.append(static_cast<char>(flags));
+		writeVarint(m_body, zigzag(expectedWordsNode->minScore()));
+		// the generated hint is kept too, it isn't regenerated when the words change
+		writeString(expectedWordsNode->hint());
+
+		writeVarint(m_body, expectedWordsNode->expectedWords().size());
+		for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+		{
+			writeString(words.words);
+			writeNumber(m_body, words.score);
+		}
+	}
+
+private:
+	QByteArray m_body;
+	QHash<QString, int> m_indexes;
+	QVector<QString> m_strings;
+};
+
+}
+
+void DialogBinaryWriter::write(const Dialog& dialog, QByteArray& buffer)
+{
+	Encoder encoder;
+	encoder.writeDialog(dialog);
+	encoder.finish(buffer);
+}
+
+QByteArray DialogBinaryWriter::write(const Dialog& dialog)
+{
+	QByteArray result;
+	write(dialog, result);
+	return result;
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QByteArray>
+
+namespace Core
+{
+
+// Compact binary encoding of a dialog for caches, the clipboard and autosaves, see DialogBinaryFormat
+class DialogBinaryWriter
+{
+public:
+	// Appends the encoded dialog to the buffer
+	void write(const Dialog& dialog, QByteArray& buffer);
+	QByteArray write(const Dialog& dialog);
+};
+
+}
@@ -0,0 +1,108 @@
+#include "dialogcontentstore.h"
+#include "hashcombine.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+PhaseNode DialogContentStore::intern(const PhaseNode& phase)
+{
+	++m_statistics.phaseRequests;
+
+	const size_t hash = phase.contentHash();
+	for (auto it = m_phases.constFind(hash); it != m_phases.constEnd() && it.key() == hash; ++it)
+	{
+		if (*it == phase)
+		{
+			++m_statistics.sharedPhases;
+
+			// the id belongs to the node, not to the shared data
+			PhaseNode result = *it;
+			result.setId(phase.id());
+			return result;
+		}
+	}
+
+	m_phases.insert(hash, phase);
+	++m_statistics.phases;
+	return phase;
+}
+
+Dialog DialogContentStore::intern(const Dialog& dialog)
+{
+	++m_statistics.dialogRequests;
+
+	Dialog result = dialog;
+
+	const size_t hash = phasesHash(dialog.phases);
+	for (auto it = m_phaseLists.constFind(hash); it != m_phaseLists.constEnd() && it.key() == hash; ++it)
+	{
+		if (samePhases(*it, dialog.phases))
+		{
+			++m_statistics.sharedDialogs;
+			result.phases = *it;
+			return result;
+		}
+	}
+
+	for (PhaseNode& phase : result.phases)
+	{
+		phase = intern(phase);
+	}
+
+	m_phaseLists.insert(hash, result.phases);
+	++m_statistics.dialogs;
+	return result;
+}
+
+QMap<QString, QList<Dialog>> DialogContentStore::intern(const QMap<QString, QList<Dialog>>& dialogs)
+{
+	QMap<QString, QList<Dialog>> result;
+
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		QList<Dialog>& clientDialogs = result[it.key()];
+		for (const Dialog& dialog : it.value())
+		{
+			clientDialogs.append(intern(dialog));
+		}
+	}
+
+	return result;
+}
+
+void DialogContentStore::clear()
+{
+	m_phases.clear();
+	m_phaseLists.clear();
+	m_statistics = {};
+}
+
+const DialogContentStore::Statistics& DialogContentStore::statistics() const
+{
+	return m_statistics;
+}
+
+bool DialogContentStore::samePhases(const QList<PhaseNode>& left, const QList<PhaseNode>& right)
+{
+	return left.isSharedWith(right) ||
+		(left.size() == right.size() &&
+			std::equal(left.begin(), left.end(), right.begin(),
+				[](const PhaseNode& left, const PhaseNode& right) { return left.id() == right.id() && left == right; }));
+}
+
+size_t DialogContentStore::phasesHash(const QList<PhaseNode>& phases)
+{
+	size_t seed = 0;
+
+	for (const PhaseNode& phase : phases)
+	{
+		hashCombine(seed, phase.id());
+		hashCombine(seed, phase.contentHash());
+	}
+
+	return seed;
+}
+
+}
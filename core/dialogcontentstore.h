@@ -0,0 +1,48 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QMap>
+#include <QMultiHash>
+
+namespace Core
+{
+
+// Content-addressed store of the loaded dialogs. Dialogs with the same phases, like the copies
+// made by "Save As" for other clients, share one phase list, and equal phases of different dialogs
+// share their data and nodes. Shared phases are copied on write like any implicitly shared data,
+// code editing the nodes in place, like the dialog editor, must take them by PhaseNode::detachNodes().
+// Phases are addressed by PhaseNode::contentHash(), so phase ids may differ, phase lists by their ids as well
+class DialogContentStore
+{
+public:
+	struct Statistics
+	{
+		int phases;
+		int phaseRequests;
+		int sharedPhases;
+		int dialogs;
+		int dialogRequests;
+		int sharedDialogs;
+	};
+
+	PhaseNode intern(const PhaseNode& phase);
+	Dialog intern(const Dialog& dialog);
+	QMap<QString, QList<Dialog>> intern(const QMap<QString, QList<Dialog>>& dialogs);
+
+	// Forgets the stored content, the dialogs keep using it
+	void clear();
+
+	const Statistics& statistics() const;
+
+private:
+	static bool samePhases(const QList<PhaseNode>& left, const QList<PhaseNode>& right);
+	static size_t phasesHash(const QList<PhaseNode>& phases);
+
+private:
+	QMultiHash<size_t, PhaseNode> m_phases;
+	QMultiHash<size_t, QList<PhaseNode>> m_phaseLists;
+	Statistics m_statistics {};
+};
+
+}
@@ -0,0 +1,426 @@
+#include "dialogdiff.h"
+#include "hashcombine.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+struct NodeEntry
+{
+	AbstractDialogNode* node;
+	AbstractDialogNode::Id phase;
+};
+
+typedef QHash<AbstractDialogNode::Id, NodeEntry> NodesById;
+typedef QPair<AbstractDialogNode::Id, AbstractDialogNode::Id> Link;
+
+NodesById collectNodes(const Dialog& dialog)
+{
+	NodesById result;
+
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		for (AbstractDialogNode* node : phase.nodes())
+		{
+			result.insert(node->id(), { node, phase.id() });
+		}
+	}
+
+	return result;
+}
+
+size_t nodeContentKey(const AbstractDialogNode* node)
+{
+	size_t seed = node->dataHash();
+	hashCombine(seed, node->type());
+	return seed;
+}
+
+AbstractDialogNode::Id mapId(const QHash<AbstractDialogNode::Id, AbstractDialogNode::Id>& ids, const AbstractDialogNode::Id& id)
+{
+	return ids.value(id, id);
+}
+
+}
+
+DialogDiff::DialogDiff(const Dialog& from, const Dialog& to)
+{
+	compareDialogs(from, to);
+	comparePhases(from, to);
+	compareNodes(from, to);
+}
+
+bool DialogDiff::isEmpty() const
+{
+	return m_changes.isEmpty();
+}
+
+const QList<DialogDiff::Change>& DialogDiff::changes() const
+{
+	return m_changes;
+}
+
+QStringList DialogDiff::summary() const
+{
+	QStringList result;
+
+	for (const Change& change : m_changes)
+	{
+		const QString phaseName = m_phaseNames.value(change.phase);
+
+		switch (change.type)
+		{
+		case Change::Type::DialogChanged:
+			result.append("Изменен диалог (" + change.field + ")");
+			break;
+		case Change::Type::PhasesReordered:
+			result.append("Изменен порядок фаз");
+			break;
+		case Change::Type::PhaseAdded:
+			result.append("Добавлена фаза \"" + phaseName + "\"");
+			break;
+		case Change::Type::PhaseRemoved:
+			result.append("Удалена фаза \"" + phaseName + "\"");
+			break;
+		case Change::Type::PhaseChanged:
+			result.append("Изменена фаза \"" + phaseName + "\" (" + change.field + ")");
+			break;
+		case Change::Type::NodeAdded:
+			result.append("Добавлен узел в фазе \"" + phaseName + "\"");
+			break;
+		case Change::Type::NodeRemoved:
+			result.append("Удален узел из фазы \"" + phaseName + "\"");
+			break;
+		case Change::Type::NodeChanged:
+			result.append("Изменен узел в фазе \"" + phaseName + "\"");
+			break;
+		case Change::Type::NodeMoved:
+			result.append("Узел перемещен в фазу \"" + phaseName + "\"");
+			break;
+		case Change::Type::LinkAdded:
+			result.append("Добавлена стрелка (" + change.node + " -> " + change.childNode + ")");
+			break;
+		case Change::Type::LinkRemoved:
+			result.append("Удалена стрелка (" + change.node + " -> " + change.childNode + ")");
+			break;
+		}
+	}
+
+	return result;
+}
+
+bool DialogDiff::conflicts(const DialogDiff& left, const DialogDiff& right)
+{
+	const QSet<QString> leftEntities = left.touchedEntities();
+	const QSet<QString> rightEntities = right.touchedEntities();
+
+	const QSet<QString>& smaller = leftEntities.size() < rightEntities.size() ? leftEntities : rightEntities;
+	const QSet<QString>& bigger = leftEntities.size() < rightEntities.size() ? rightEntities : leftEntities;
+
+	return std::any_of(smaller.begin(), smaller.end(),
+		[&bigger](const QString& entity) { return bigger.contains(entity); });
+}
+
+void DialogDiff::compareDialogs(const Dialog& from, const Dialog& to)
+{
+	if (from.name != to.name)
+	{
+		append(Change::Type::DialogChanged, "name");
+	}
+
+	if (from.difficulty != to.difficulty)
+	{
+		append(Change::Type::DialogChanged, "difficulty");
+	}
+
+	if (from.note != to.note)
+	{
+		append(Change::Type::DialogChanged, "note");
+	}
+
+	if (from.errorReplica != to.errorReplica)
+	{
+		append(Change::Type::DialogChanged, "errorReplica");
+	}
+
+	if (from.phaseRepeatReplica != to.phaseRepeatReplica)
+	{
+		append(Change::Type::DialogChanged, "phaseRepeatReplica");
+	}
+
+	if (from.successRatio != to.successRatio)
+	{
+		append(Change::Type::DialogChanged, "successRatio");
+	}
+
+	if (from.groups != to.groups)
+	{
+		append(Change::Type::DialogChanged, "groups");
+	}
+}
+
+void DialogDiff::comparePhases(const Dialog& from, const Dialog& to)
+{
+	QHash<AbstractDialogNode::Id, const PhaseNode*> fromPhases;
+	for (const PhaseNode& phase : from.phases)
+	{
+		fromPhases.insert(phase.id(), &phase);
+		m_phaseNames.insert(phase.id(), phase.name());
+	}
+
+	QSet<AbstractDialogNode::Id> toPhaseIds;
+	for (const PhaseNode& phase : to.phases)
+	{
+		toPhaseIds.insert(phase.id());
+	}
+
+	// phases without the same id in the source dialog are matched by content
+	QMultiHash<size_t, const PhaseNode*> unmatchedFromPhases;
+	for (const PhaseNode& phase : from.phases)
+	{
+		if (!toPhaseIds.contains(phase.id()))
+		{
+			unmatchedFromPhases.insert(phase.contentHash(), &phase);
+		}
+	}
+
+	QList<AbstractDialogNode::Id> matchedOrder;
+
+	for (const PhaseNode& phase : to.phases)
+	{
+		const PhaseNode* fromPhase = fromPhases.value(phase.id());
+		if (!fromPhase)
+		{
+			const size_t hash = phase.contentHash();
+			for (auto it = unmatchedFromPhases.find(hash); it != unmatchedFromPhases.end() && it.key() == hash; ++it)
+			{
+				if (**it == phase)
+				{
+					fromPhase = *it;
+					unmatchedFromPhases.erase(it);
+					m_phaseIds.insert(phase.id(), fromPhase->id());
+					break;
+				}
+			}
+		}
+
+		if (!fromPhase)
+		{
+			m_phaseNames.insert(phase.id(), phase.name());
+			append(Change::Type::PhaseAdded, {}, phase.id());
+			continue;
+		}
+
+		matchedOrder.append(fromPhase->id());
+		fromPhases.remove(fromPhase->id());
+
+		if (phase.isSharedWith(*fromPhase))
+		{
+			continue;
+		}
+
+		m_phaseNames.insert(fromPhase->id(), phase.name());
+
+		if (phase.name() != fromPhase->name())
+		{
+			append(Change::Type::PhaseChanged, "name", fromPhase->id());
+		}
+
+		if (phase.score() != fromPhase->score())
+		{
+			append(Change::Type::PhaseChanged, "score", fromPhase->id());
+		}
+
+		if (phase.repeatOnInsufficientScore() != fromPhase->repeatOnInsufficientScore())
+		{
+			append(Change::Type::PhaseChanged, "repeatOnInsufficientScore", fromPhase->id());
+		}
+
+		if (phase.errorReplica() != fromPhase->errorReplica())
+		{
+			append(Change::Type::PhaseChanged, "errorReplica", fromPhase->id());
+		}
+
+		if (phase.repeatReplica() != fromPhase->repeatReplica())
+		{
+			append(Change::Type::PhaseChanged, "repeatReplica", fromPhase->id());
+		}
+	}
+
+	QList<AbstractDialogNode::Id> remainingOrder;
+	for (const PhaseNode& phase : from.phases)
+	{
+		if (fromPhases.contains(phase.id()))
+		{
+			append(Change::Type::PhaseRemoved, {}, phase.id());
+		}
+		else
+		{
+			remainingOrder.append(phase.id());
+		}
+	}
+
+	if (remainingOrder != matchedOrder)
+	{
+		append(Change::Type::PhasesReordered, {});
+	}
+}
+
+void DialogDiff::compareNodes(const Dialog& from, const Dialog& to)
+{
+	const NodesById fromNodes = collectNodes(from);
+	const NodesById toNodes = collectNodes(to);
+
+	// nodes without the same id in the source dialog are matched by type and content
+	QMultiHash<size_t, AbstractDialogNode::Id> unmatchedFromNodes;
+	for (auto it = fromNodes.begin(); it != fromNodes.end(); ++it)
+	{
+		if (!toNodes.contains(it.key()))
+		{
+			unmatchedFromNodes.insert(nodeContentKey(it->node), it.key());
+		}
+	}
+
+	QHash<AbstractDialogNode::Id, AbstractDialogNode::Id> nodeIds;
+	for (auto it = toNodes.begin(); it != toNodes.end(); ++it)
+	{
+		if (fromNodes.contains(it.key()))
+		{
+			continue;
+		}
+
+		// the key only narrows the candidates, the content is compared to tell collisions apart
+		const size_t key = nodeContentKey(it->node);
+		for (auto fromIt = unmatchedFromNodes.find(key); fromIt != unmatchedFromNodes.end() && fromIt.key() == key; ++fromIt)
+		{
+			if (fromNodes.value(*fromIt).node->compareContent(it->node))
+			{
+				nodeIds.insert(it.key(), *fromIt);
+				unmatchedFromNodes.erase(fromIt);
+				break;
+			}
+		}
+	}
+
+	QSet<AbstractDialogNode::Id> matchedFromNodes;
+
+	for (auto it = toNodes.begin(); it != toNodes.end(); ++it)
+	{
+		const AbstractDialogNode::Id fromId = mapId(nodeIds, it.key());
+		const auto fromIt = fromNodes.find(fromId);
+		if (fromIt == fromNodes.end())
+		{
+			append(Change::Type::NodeAdded, {}, mapId(m_phaseIds, it->phase), it.key());
+			continue;
+		}
+
+		matchedFromNodes.insert(fromId);
+
+		if (fromIt->node == it->node)
+		{
+			continue;
+		}
+
+		if (fromIt->node->dataHash() != it->node->dataHash() || !fromIt->node->compareContent(it->node))
+		{
+			append(Change::Type::NodeChanged, {}, fromIt->phase, fromId);
+		}
+
+		const AbstractDialogNode::Id phase = mapId(m_phaseIds, it->phase);
+		if (phase != fromIt->phase)
+		{
+			append(Change::Type::NodeMoved, {}, phase, fromId);
+		}
+	}
+
+	for (auto it = fromNodes.begin(); it != fromNodes.end(); ++it)
+	{
+		if (!matchedFromNodes.contains(it.key()))
+		{
+			append(Change::Type::NodeRemoved, {}, it->phase, it.key());
+		}
+	}
+
+	QSet<Link> fromLinks;
+	for (auto it = fromNodes.begin(); it != fromNodes.end(); ++it)
+	{
+		for (const AbstractDialogNode::Id& child : it->node->childNodes())
+		{
+			fromLinks.insert({ it.key(), child });
+		}
+	}
+
+	QSet<Link> toLinks;
+	for (auto it = toNodes.begin(); it != toNodes.end(); ++it)
+	{
+		for (const AbstractDialogNode::Id& child : it->node->childNodes())
+		{
+			const Link link { mapId(nodeIds, it.key()), mapId(nodeIds, child) };
+			toLinks.insert(link);
+
+			if (!fromLinks.contains(link))
+			{
+				append(Change::Type::LinkAdded, {}, {}, link.first, link.second);
+			}
+		}
+	}
+
+	for (const Link& link : fromLinks)
+	{
+		if (!toLinks.contains(link))
+		{
+			append(Change::Type::LinkRemoved, {}, {}, link.first, link.second);
+		}
+	}
+}
+
+void DialogDiff::append(Change::Type type, const QString& field, const AbstractDialogNode::Id& phase,
+	const AbstractDialogNode::Id& node, const AbstractDialogNode::Id& childNode)
+{
+	m_changes.append({ type, field, phase, node, childNode });
+}
+
+QSet<QString> DialogDiff::touchedEntities() const
+{
+	QSet<QString> result;
+
+	for (const Change& change : m_changes)
+	{
+		switch (change.type)
+		{
+		case Change::Type::DialogChanged:
+			result.insert("dialog/" + change.field);
+			break;
+		case Change::Type::PhasesReordered:
+			result.insert("phases");
+			break;
+		case Change::Type::PhaseAdded:
+			break;
+		case Change::Type::PhaseRemoved:
+		case Change::Type::PhaseChanged:
+			result.insert("phase/" + change.phase);
+			break;
+		case Change::Type::NodeAdded:
+			break;
+		case Change::Type::NodeRemoved:
+		case Change::Type::NodeChanged:
+		case Change::Type::NodeMoved:
+			result.insert("node/" + change.node);
+			break;
+		case Change::Type::LinkAdded:
+		case Change::Type::LinkRemoved:
+			// a link conflicts with changes of both of its ends
+			result.insert("node/" + change.node);
+			result.insert("node/" + change.childNode);
+			break;
+		}
+	}
+
+	return result;
+}
+
+}
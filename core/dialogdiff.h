@@ -0,0 +1,67 @@
+#pragma once
+
+#include "dialog.h"
+
+namespace Core
+{
+
+// List of changes between two versions of a dialog.
+// Phases and nodes are matched by id, the ones without a match are matched by content,
+// so re-created nodes with new ids are not reported as changes.
+class DialogDiff
+{
+public:
+	struct Change
+	{
+		enum class Type
+		{
+			DialogChanged,
+			PhasesReordered,
+			PhaseAdded,
+			PhaseRemoved,
+			PhaseChanged,
+			NodeAdded,
+			NodeRemoved,
+			NodeChanged,
+			NodeMoved,
+			LinkAdded,
+			LinkRemoved
+		};
+
+		Type type;
+		// changed field of the dialog or of the phase
+		QString field;
+		// ids of the source dialog for existing phases and nodes, ids of the target dialog for added ones
+		AbstractDialogNode::Id phase;
+		AbstractDialogNode::Id node;
+		AbstractDialogNode::Id childNode;
+	};
+
+	DialogDiff(const Dialog& from, const Dialog& to);
+
+	bool isEmpty() const;
+	const QList<Change>& changes() const;
+
+	QStringList summary() const;
+
+	// Both diffs must be made from the same source dialog
+	static bool conflicts(const DialogDiff& left, const DialogDiff& right);
+
+private:
+	void compareDialogs(const Dialog& from, const Dialog& to);
+	void comparePhases(const Dialog& from, const Dialog& to);
+	void compareNodes(const Dialog& from, const Dialog& to);
+
+	void append(Change::Type type, const QString& field, const AbstractDialogNode::Id& phase = {},
+		const AbstractDialogNode::Id& node = {}, const AbstractDialogNode::Id& childNode = {});
+
+	QSet<QString> touchedEntities() const;
+
+private:
+	QList<Change> m_changes;
+	// maps ids of the target dialog to ids of the source dialog
+	QHash<AbstractDialogNode::Id, AbstractDialogNode::Id> m_phaseIds;
+	QHash<AbstractDialogNode::Id, QString> m_phaseNames;
+};
+
+}
@@ -1,10 +1,10 @@
 #include "dialogjsonreader.h"
+#include "jsonpullparser.h"
+#include "stringpool.h"
 #include "logger.h"
 
-#include <QVector>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
+#include <cmath>
+#include <limits>
 
 namespace Core
 {
@@ -12,304 +12,675 @@ namespace Core
 namespace
 {
 
-typedef QVector<QPair<QString, QJsonValue::Type>> PropertiesList;
+// Properties are read in a single pass in any order, so the required ones are checked after the object ends
+enum class Property
+{
+	Missing,
+	Valid,
+	// present with a wrong type, an error only where the property is used
+	Invalid
+};
+
+// Same as QJsonValue::toInt(): fractional numbers become 0
+int toInt(double value)
+{
+	return std::floor(value) == value && std::fabs(value) <= std::numeric_limits<int>::max() ? static_cast<int>(value) : 0;
+}
+
+QString missingProperty(const char* name)
+{
+	return QString("нет свойства %1 или у него неверный тип").arg(name);
+}
+
+template <typename T, typename ReadFunction>
+Property readOptional(JsonPullParser& parser, JsonPullParser::Type type, T& value, ReadFunction read)
+{
+	if (parser.peek() != type)
+	{
+		parser.skipValue();
+		return Property::Invalid;
+	}
+
+	return (parser.*read)(value) ? Property::Valid : Property::Invalid;
+}
+
+Property readString(JsonPullParser& parser, QString& value)
+{
+	return readOptional(parser, JsonPullParser::Type::String, value, &JsonPullParser::readString);
+}
+
+Property readNumber(JsonPullParser& parser, double& value)
+{
+	return readOptional(parser, JsonPullParser::Type::Number, value, &JsonPullParser::readNumber);
+}
 
-bool hasProperty(const QJsonObject& object, const QString& name, QJsonValue::Type type)
+Property readBool(JsonPullParser& parser, bool& value)
 {
-	return object.contains(name) && object[name].type() == type;
+	return readOptional(parser, JsonPullParser::Type::Bool, value, &JsonPullParser::readBool);
 }
 
-bool hasProperties(const QJsonObject& object, const PropertiesList& properties)
+// Like QJsonValue::toString(): values of other types become empty strings
+template <typename Container>
+bool readStrings(JsonPullParser& parser, Container& values, bool skipInvalid)
 {
-	for (const auto& property : properties)
+	if (!parser.beginArray())
+	{
+		return false;
+	}
+
+	while (parser.nextElement())
 	{
-		if (!hasProperty(object, property.first, property.second))
+		QString value;
+		if (readString(parser, value) == Property::Valid || !skipInvalid)
 		{
-			return false;
+			values << value;
 		}
 	}
 
-	return true;
+	return !parser.hasError();
 }
 
-void checkProperties(const QJsonObject& object, const PropertiesList& properties)
+ErrorReplica readError(JsonPullParser& parser)
 {
-	if (!hasProperties(object, properties))
+	ErrorReplica result;
+
+	// errors of the optional object are ignored, like in the DOM based reader
+	if (parser.peek() != JsonPullParser::Type::Object)
+	{
+		parser.skipValue();
+		return result;
+	}
+
+	parser.beginObject();
+	while (parser.nextKey())
 	{
-		QStringList propertiesList;
-		for (const auto& property : properties)
+		QString text;
+		double number = 0.0;
+
+		if (parser.keyIs("errorReplica"))
+		{
+			if (readString(parser, text) == Property::Valid)
+			{
+				result.errorReplica = text;
+			}
+		}
+		else if (parser.keyIs("errorPenalty"))
+		{
+			if (readNumber(parser, number) == Property::Valid)
+			{
+				result.errorPenalty = number;
+			}
+		}
+		else if (parser.keyIs("finishingExpectedWords") && parser.peek() == JsonPullParser::Type::Array)
+		{
+			QList<QString> list;
+			readStrings(parser, list, true);
+			result.finishingExpectedWords = list;
+		}
+		else if (parser.keyIs("finishingReplica"))
+		{
+			if (readString(parser, text) == Property::Valid)
+			{
+				result.finishingReplica = text;
+			}
+		}
+		else
+		{
+			parser.skipValue();
+		}
+	}
+
+	StringPool::intern(result);
+	return result;
+}
+
+bool readExpectedWords(JsonPullParser& parser, QList<ExpectedWords>& expectedWords)
+{
+	if (!parser.beginArray())
+	{
+		return false;
+	}
+
+	while (parser.nextElement())
+	{
+		if (!parser.beginObject())
+		{
+			return false;
+		}
+
+		QString words;
+		double score = 0.0;
+		Property hasWords = Property::Missing;
+		Property hasScore = Property::Missing;
+
+		while (parser.nextKey())
+		{
+			if (parser.keyIs("words"))
+			{
+				hasWords = readString(parser, words);
+			}
+			else if (parser.keyIs("score"))
+			{
+				hasScore = readNumber(parser, score);
+			}
+			else
+			{
+				parser.skipValue();
+			}
+		}
+
+		if (parser.hasError())
+		{
+			return false;
+		}
+
+		if (hasWords != Property::Valid)
 		{
-			propertiesList.append(property.first + " (" + QString::number(property.second) + ")");
+			return parser.fail(missingProperty("words"));
 		}
 
-		std::string message = "Properties not found (or types are incorrect): " + propertiesList.join("; ").toStdString();
+		if (hasScore != Property::Valid)
+		{
+			return parser.fail(missingProperty("score"));
+		}
 
-		throw std::logic_error(message);
+		expectedWords << ExpectedWords(words, score);
 	}
+
+	return !parser.hasError();
 }
 
-ClientReplicaNode* parseClientReplicaNode(const QJsonObject& object)
+// Data of both node types, the type may follow the data in the node object
+struct NodeData
 {
-	checkProperties(object, { { "replica", QJsonValue::String } });
-	const QString replica = object["replica"].toString();
+	QString replica;
+	Property hasReplica = Property::Missing;
 
-	return new ClientReplicaNode(replica);
-}
+	QList<ExpectedWords> expectedWords;
+	Property hasExpectedWords = Property::Missing;
+
+	bool forbidden = false;
+	Property hasForbidden = Property::Missing;
 
-ExpectedWordsNode* parseExpectedWordsNode(const QJsonObject& object)
+	double minScore = 0.0;
+	Property hasMinScore = Property::Missing;
+
+	QString hint;
+	Property hasHint = Property::Missing;
+};
+
+bool readNodeData(JsonPullParser& parser, NodeData& data)
 {
-	checkProperties(object, {
-		{ "expectedWords", QJsonValue::Array },
-		{ "forbidden", QJsonValue::Bool }
-	});
+	if (!parser.beginObject())
+	{
+		return false;
+	}
 
-	const QJsonArray expectedWordsArray = object["expectedWords"].toArray();
+	while (parser.nextKey())
+	{
+		if (parser.keyIs("replica"))
+		{
+			data.hasReplica = readString(parser, data.replica);
+		}
+		else if (parser.keyIs("expectedWords"))
+		{
+			if (parser.peek() != JsonPullParser::Type::Array)
+			{
+				parser.skipValue();
+				data.hasExpectedWords = Property::Invalid;
+			}
+			else if (readExpectedWords(parser, data.expectedWords))
+			{
+				data.hasExpectedWords = Property::Valid;
+			}
+		}
+		else if (parser.keyIs("forbidden"))
+		{
+			data.hasForbidden = readBool(parser, data.forbidden);
+		}
+		else if (parser.keyIs("minScore"))
+		{
+			data.hasMinScore = readNumber(parser, data.minScore);
+		}
+		else if (parser.keyIs("hint"))
+		{
+			data.hasHint = readString(parser, data.hint);
+		}
+		else
+		{
+			parser.skipValue();
+		}
+	}
 
-	QList<ExpectedWords> expectedWords;
-	for (const QJsonValue& expectedWord : expectedWordsArray)
+	return !parser.hasError();
+}
+
+AbstractDialogNode* createNode(JsonPullParser& parser, int type, const NodeData& data)
+{
+	if (type == 0)
 	{
-		const QJsonObject expectedWordObject = expectedWord.toObject();
-		checkProperties(expectedWordObject, { { "words", QJsonValue::String }, { "score", QJsonValue::Double } });
+		if (data.hasReplica != Property::Valid)
+		{
+			parser.fail(missingProperty("data.replica"));
+			return nullptr;
+		}
 
-		expectedWords << ExpectedWords(expectedWordObject["words"].toString(), expectedWordObject["score"].toDouble());
+		return new ClientReplicaNode(data.replica);
 	}
 
-	int minScore = 0;
-	if (object.contains("minScore"))
+	if (type != 1)
 	{
-		checkProperties(object, { { "minScore", QJsonValue::Double } });
-		minScore = object["minScore"].toDouble();
+		return nullptr;
 	}
 
-	bool forbidden = object["forbidden"].toBool();
+	if (data.hasExpectedWords != Property::Valid || data.hasForbidden != Property::Valid)
+	{
+		parser.fail(missingProperty(data.hasExpectedWords != Property::Valid ? "data.expectedWords" : "data.forbidden"));
+		return nullptr;
+	}
+
+	if (data.hasMinScore == Property::Invalid || data.hasHint == Property::Invalid)
+	{
+		parser.fail(missingProperty(data.hasMinScore == Property::Invalid ? "data.minScore" : "data.hint"));
+		return nullptr;
+	}
 
-	if (!object.contains("hint"))
+	const int minScore = static_cast<int>(data.minScore);
+	if (data.hasHint == Property::Missing)
 	{
-		return new ExpectedWordsNode(expectedWords, minScore, forbidden);
+		return new ExpectedWordsNode(data.expectedWords, minScore, data.forbidden);
 	}
 
-	checkProperties(object, { { "hint", QJsonValue::String } });
-	return new ExpectedWordsNode(expectedWords, minScore, object["hint"].toString(), forbidden);
+	return new ExpectedWordsNode(data.expectedWords, minScore, data.hint, data.forbidden);
 }
 
-AbstractDialogNode* parseNode(const QJsonObject& object)
+// Nodes of unknown types are skipped, node is null then
+bool readNode(JsonPullParser& parser, AbstractDialogNode*& node)
 {
-	static const PropertiesList s_requiredProperties = {
-		{ "type", QJsonValue::Double },
-		{ "data", QJsonValue::Object },
-		{ "id", QJsonValue::String },
-		{ "childNodes", QJsonValue::Array },
-		{ "parentNodes", QJsonValue::Array }
-	};
-	checkProperties(object, s_requiredProperties);
+	node = nullptr;
 
-	const int type = object["type"].toInt();
-	const QJsonObject data = object["data"].toObject();
-
-	AbstractDialogNode* result = nullptr;
-	if (type == 0)
+	if (!parser.beginObject())
 	{
-		result = parseClientReplicaNode(data);
+		return false;
 	}
-	else if (type == 1)
+
+	AbstractDialogNode::Id id;
+	double type = 0.0;
+	NodeData data;
+	QList<AbstractDialogNode::Id> childNodes;
+	QList<AbstractDialogNode::Id> parentNodes;
+
+	Property hasId = Property::Missing;
+	Property hasType = Property::Missing;
+	Property hasData = Property::Missing;
+	Property hasChildNodes = Property::Missing;
+	Property hasParentNodes = Property::Missing;
+
+	while (parser.nextKey())
 	{
-		result = parseExpectedWordsNode(data);
+		if (parser.keyIs("id"))
+		{
+			hasId = readString(parser, id);
+		}
+		else if (parser.keyIs("type"))
+		{
+			hasType = readNumber(parser, type);
+		}
+		else if (parser.keyIs("data"))
+		{
+			if (parser.peek() != JsonPullParser::Type::Object)
+			{
+				parser.skipValue();
+				hasData = Property::Invalid;
+			}
+			else if (readNodeData(parser, data))
+			{
+				hasData = Property::Valid;
+			}
+		}
+		else if (parser.keyIs("childNodes") || parser.keyIs("parentNodes"))
+		{
+			const bool children = parser.keyIs("childNodes");
+			Property& hasNodes = children ? hasChildNodes : hasParentNodes;
+			if (parser.peek() != JsonPullParser::Type::Array)
+			{
+				parser.skipValue();
+				hasNodes = Property::Invalid;
+			}
+			else if (readStrings(parser, children ? childNodes : parentNodes, false))
+			{
+				hasNodes = Property::Valid;
+			}
+		}
+		else
+		{
+			parser.skipValue();
+		}
 	}
 
-	if (!result)
+	if (parser.hasError())
 	{
-		return nullptr;
+		return false;
 	}
 
-	const AbstractDialogNode::Id id = object["id"].toString();
-	result->setId(id);
+	const std::initializer_list<std::pair<const char*, Property>> requiredProperties = {
+		{ "type", hasType },
+		{ "data", hasData },
+		{ "id", hasId },
+		{ "childNodes", hasChildNodes },
+		{ "parentNodes", hasParentNodes }
+	};
+	for (const auto& property : requiredProperties)
+	{
+		if (property.second != Property::Valid)
+		{
+			return parser.fail(missingProperty(property.first));
+		}
+	}
 
-	const QJsonArray childsArray = object["childNodes"].toArray();
-	for (const QJsonValue& child : childsArray)
+	node = createNode(parser, toInt(type), data);
+	if (!node)
 	{
-		result->appendChild(child.toString());
+		return !parser.hasError();
 	}
 
-	const QJsonArray parentsArray = object["parentNodes"].toArray();
-	for (const QJsonValue& parent : parentsArray)
+	node->setId(id);
+	for (const AbstractDialogNode::Id& child : childNodes)
 	{
-		result->appendParent(parent.toString());
+		node->appendChild(child);
+	}
+	for (const AbstractDialogNode::Id& parent : parentNodes)
+	{
+		node->appendParent(parent);
 	}
 
-	return result;
+	return true;
 }
 
-QList<AbstractDialogNode*> parseNodes(const QJsonArray& nodes)
+bool readNodes(JsonPullParser& parser, QList<AbstractDialogNode*>& nodes)
 {
-	QList<AbstractDialogNode*> result;
+	if (!parser.beginArray())
+	{
+		return false;
+	}
 
-	for (const auto& nodeValue : nodes)
+	while (parser.nextElement())
 	{
-		if (!nodeValue.isObject())
+		// elements other than objects are skipped
+		if (parser.peek() != JsonPullParser::Type::Object)
 		{
+			parser.skipValue();
 			continue;
 		}
 
-		const auto nodeObject = nodeValue.toObject();
+		AbstractDialogNode* node = nullptr;
+		if (!readNode(parser, node))
+		{
+			return false;
+		}
 
-		AbstractDialogNode* node = parseNode(nodeObject);
 		if (node)
 		{
-			result.append(node);
+			nodes.append(node);
 		}
 	}
 
-	return result;
+	return !parser.hasError();
 }
 
-ErrorReplica parseError(const QJsonObject& object)
+bool readPhase(JsonPullParser& parser, QList<PhaseNode>& phases)
 {
-	ErrorReplica result;
-
-	if (hasProperty(object, "errorReplica", QJsonValue::String))
+	if (!parser.beginObject())
 	{
-		result.errorReplica = object["errorReplica"].toString();
+		return false;
 	}
 
-	if (hasProperty(object, "errorPenalty", QJsonValue::Double))
+	QString id;
+	QString name;
+	double score = 0.0;
+	bool repeatOnInsufficientScore = false;
+	QList<AbstractDialogNode*> nodes;
+	ErrorReplica errorReplica;
+	QString repeatReplica;
+
+	Property hasId = Property::Missing;
+	Property hasName = Property::Missing;
+	Property hasScore = Property::Missing;
+	Property hasRepeatOnInsufficientScore = Property::Missing;
+	Property hasNodes = Property::Missing;
+	Property hasRepeatReplica = Property::Missing;
+
+	// the nodes aren't owned by a phase until it is created
+	const auto fail = [&nodes]()
 	{
-		result.errorPenalty = object["errorPenalty"].toDouble();
-	}
+		qDeleteAll(nodes);
+		return false;
+	};
 
-	if (hasProperty(object, "finishingExpectedWords", QJsonValue::Array))
+	while (parser.nextKey())
 	{
-		QList<QString> list;
-
-		for (const QJsonValue& expectedWords : object["finishingExpectedWords"].toArray())
+		if (parser.keyIs("id"))
+		{
+			hasId = readString(parser, id);
+		}
+		else if (parser.keyIs("name"))
+		{
+			hasName = readString(parser, name);
+		}
+		else if (parser.keyIs("score"))
+		{
+			hasScore = readNumber(parser, score);
+		}
+		else if (parser.keyIs("repeatOnInsufficientScore"))
+		{
+			hasRepeatOnInsufficientScore = readBool(parser, repeatOnInsufficientScore);
+		}
+		else if (parser.keyIs("nodes"))
 		{
-			if (expectedWords.isString())
+			if (parser.peek() != JsonPullParser::Type::Array)
+			{
+				parser.skipValue();
+				hasNodes = Property::Invalid;
+			}
+			else if (readNodes(parser, nodes))
 			{
-				list.append(expectedWords.toString());
+				hasNodes = Property::Valid;
 			}
 		}
-
-		result.finishingExpectedWords = list;
+		else if (parser.keyIs("errorReplica"))
+		{
+			errorReplica = readError(parser);
+		}
+		else if (parser.keyIs("repeatReplica"))
+		{
+			hasRepeatReplica = readString(parser, repeatReplica);
+		}
+		else
+		{
+			parser.skipValue();
+		}
 	}
 
-	if (hasProperty(object, "finishingReplica", QJsonValue::String))
+	if (parser.hasError())
 	{
-		result.finishingReplica = object["finishingReplica"].toString();
+		return fail();
 	}
 
-	return result;
-}
-
-PhaseNode parsePhase(const QJsonObject& object)
-{
-	static const PropertiesList s_requiredProperties = {
-		{ "id", QJsonValue::String },
-		{ "name", QJsonValue::String },
-		{ "score", QJsonValue::Double },
-		{ "repeatOnInsufficientScore", QJsonValue::Bool },
-		{ "nodes", QJsonValue::Array }
+	const std::initializer_list<std::pair<const char*, Property>> requiredProperties = {
+		{ "id", hasId },
+		{ "name", hasName },
+		{ "score", hasScore },
+		{ "repeatOnInsufficientScore", hasRepeatOnInsufficientScore },
+		{ "nodes", hasNodes }
 	};
-	checkProperties(object, s_requiredProperties);
-
-	const QString id = object["id"].toString();
-	const QString name = object["name"].toString();
-	const double score = object["score"].toDouble();
-	const bool repeatOnInsufficientScore = object["repeatOnInsufficientScore"].toBool();
-	const QList<AbstractDialogNode*> nodes = parseNodes(object["nodes"].toArray());
-
-	const ErrorReplica errorReplica = object.contains("errorReplica") ? parseError(object["errorReplica"].toObject()) : ErrorReplica();	
-	PhaseNode result = PhaseNode(name, score, repeatOnInsufficientScore, nodes, errorReplica);
-	result.setId(id);
-
-	if (hasProperty(object, "repeatReplica", QJsonValue::String))
+	for (const auto& property : requiredProperties)
 	{
-		result.repeatReplica() = object["repeatReplica"].toString();
+		if (property.second != Property::Valid)
+		{
+			parser.fail(missingProperty(property.first));
+			return fail();
+		}
 	}
 
-	return result;
-}
+	PhaseNode phase(name, score, repeatOnInsufficientScore, nodes, errorReplica);
+	phase.setId(id);
 
-}
+	if (hasRepeatReplica == Property::Valid)
+	{
+		phase.repeatReplica() = StringPool::intern(repeatReplica);
+	}
 
-DialogJsonReader::DialogJsonReader()
-{
+	phases.append(phase);
+	return true;
 }
 
-Dialog DialogJsonReader::read(const QByteArray& json, bool& ok)
+bool readDialog(JsonPullParser& parser, Dialog& dialog)
 {
-	QJsonParseError error;
-	QJsonDocument document = QJsonDocument::fromJson(json, &error);
-	if (document.isNull() || !document.isObject())
+	if (!parser.beginObject())
 	{
-		ok = false;
-		return Dialog();
+		return false;
 	}
 
-	const QJsonObject dialogObject = document.object();
+	double difficulty = 0.0;
+	double successRatio = 0.0;
+	QString phaseRepeatReplica;
 
-	try
+	Property hasName = Property::Missing;
+	Property hasDifficulty = Property::Missing;
+	Property hasNote = Property::Missing;
+	Property hasSuccessRatio = Property::Missing;
+	Property hasPhases = Property::Missing;
+	Property hasGroups = Property::Missing;
+	Property hasPhaseRepeatReplica = Property::Missing;
+
+	while (parser.nextKey())
 	{
-		static const PropertiesList s_requiredProperties = {
-			{ "name", QJsonValue::String },
-			{ "difficulty", QJsonValue::Double },
-			{ "note", QJsonValue::String },
-			{ "successRatio", QJsonValue::Double },
-			{ "phases", QJsonValue::Array },
-			{ "groups", QJsonValue::Array }
-		};
-		checkProperties(dialogObject, s_requiredProperties);
+		if (parser.keyIs("name"))
+		{
+			hasName = readString(parser, dialog.name);
+		}
+		else if (parser.keyIs("difficulty"))
+		{
+			hasDifficulty = readNumber(parser, difficulty);
+		}
+		else if (parser.keyIs("note"))
+		{
+			hasNote = readString(parser, dialog.note);
+		}
+		else if (parser.keyIs("successRatio"))
+		{
+			hasSuccessRatio = readNumber(parser, successRatio);
+		}
+		else if (parser.keyIs("phases"))
+		{
+			if (parser.peek() != JsonPullParser::Type::Array)
+			{
+				parser.skipValue();
+				hasPhases = Property::Invalid;
+				continue;
+			}
 
-		const QString name = dialogObject["name"].toString();
-		const Dialog::Difficulty difficulty = static_cast<Dialog::Difficulty>(dialogObject["difficulty"].toInt());
-		const QString note = dialogObject["note"].toString();
-		const double successRatio = dialogObject["successRatio"].toDouble() * 100;
-		const ErrorReplica errorReplica = parseError(dialogObject["errorReplica"].toObject());
+			parser.beginArray();
+			while (parser.nextElement() && readPhase(parser, dialog.phases))
+			{
+			}
 
-		const QJsonArray phasesArray = dialogObject["phases"].toArray();
-		QList<PhaseNode> phases;
-		for (const QJsonValue& phase : phasesArray)
+			if (!parser.hasError())
+			{
+				hasPhases = Property::Valid;
+			}
+		}
+		else if (parser.keyIs("groups"))
 		{
-			phases << parsePhase(phase.toObject());
+			if (parser.peek() != JsonPullParser::Type::Array)
+			{
+				parser.skipValue();
+				hasGroups = Property::Invalid;
+			}
+			else if (readStrings(parser, dialog.groups, false))
+			{
+				hasGroups = Property::Valid;
+			}
 		}
-
-		const QJsonArray groupesArray = dialogObject["groups"].toArray();
-		QList<QString> groups;
-		for (const QJsonValue& group : groupesArray)
+		else if (parser.keyIs("errorReplica"))
 		{
-			groups << group.toString();
+			dialog.errorReplica = readError(parser);
 		}
-
-		/*const auto hasField = [&errorReplica, &phases](ErrorReplica::Field field)
+		else if (parser.keyIs("phaseRepeatReplica"))
 		{
-			return errorReplica.has(field) ||
-				std::all_of(phases.begin(), phases.end(),
-					[&field](const PhaseNode& phase) { return phase.errorReplica().has(field); });
-		};
-
-		if (!(hasField(ErrorReplica::Field::ErrorReplica) &&
-			  hasField(ErrorReplica::Field::ErrorPenalty) &&
-			  hasField(ErrorReplica::Field::FinishingExpectedWords) &&
-			  hasField(ErrorReplica::Field::FinishingReplica)))
+			hasPhaseRepeatReplica = readString(parser, phaseRepeatReplica);
+		}
+		else
 		{
-			LOG << "Some error replica fields are missing";
-			ok = false;
-			return Dialog();
-		}*/
+			parser.skipValue();
+		}
+	}
+
+	if (parser.hasError())
+	{
+		return false;
+	}
 
-		Dialog dialog = Dialog(name, difficulty, note, phases, errorReplica, successRatio, groups);
-		if (hasProperty(dialogObject, "phaseRepeatReplica", QJsonValue::String))
+	const std::initializer_list<std::pair<const char*, Property>> requiredProperties = {
+		{ "name", hasName },
+		{ "difficulty", hasDifficulty },
+		{ "note", hasNote },
+		{ "successRatio", hasSuccessRatio },
+		{ "phases", hasPhases },
+		{ "groups", hasGroups }
+	};
+	for (const auto& property : requiredProperties)
+	{
+		if (property.second != Property::Valid)
 		{
-			dialog.phaseRepeatReplica = dialogObject["phaseRepeatReplica"].toString();
+			return parser.fail(missingProperty(property.first));
 		}
+	}
+
+	dialog.difficulty = static_cast<Dialog::Difficulty>(toInt(difficulty));
+	dialog.successRatio = successRatio * 100;
+	dialog.groups = StringPool::intern(dialog.groups);
 
-		ok = true;
-		return dialog;
+	if (hasPhaseRepeatReplica == Property::Valid)
+	{
+		dialog.phaseRepeatReplica = StringPool::intern(phaseRepeatReplica);
 	}
-	catch (const std::logic_error& exception)
+
+	return true;
+}
+
+}
+
+DialogJsonReader::DialogJsonReader()
+{
+}
+
+Dialog DialogJsonReader::read(const QByteArray& json, bool& ok)
+{
+	// the model is built straight from the bytes, without a QJsonDocument in between
+	JsonPullParser parser(json);
+
+	Dialog dialog;
+	ok = readDialog(parser, dialog);
+	if (ok && !parser.atEnd())
 	{
-		LOG << exception.what();
-		ok = false;
+		ok = parser.fail("лишние данные после диалога");
+	}
+
+	if (!ok)
+	{
+		m_error = parser.errorString();
+		LOG << "Failed to read the dialog: " << m_error;
 		return Dialog();
 	}
+
+	m_error.clear();
+	return dialog;
+}
+
+const QString& DialogJsonReader::errorString() const
+{
+	return m_error;
 }
 
 }
@@ -11,6 +11,12 @@ public:
 	DialogJsonReader();
 
 	Dialog read(const QByteArray& json, bool& ok);
+
+	// Path to the invalid value and the reason, empty after a successful read
+	const QString& errorString() const;
+
+private:
+	QString m_error;
 };
 
 }
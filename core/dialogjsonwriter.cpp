@@ -132,6 +132,113 @@ QJsonValue dumpGroup(const QString& group)
 	return group;
 }
 
+// Streaming counterparts of the functions above, keys and optional fields are the same
+
+void writeNode(JsonStreamWriter& writer, const AbstractDialogNode* node)
+{
+	writer.beginObject();
+	writer.write("id", node->id());
+
+	const ClientReplicaNode* clientReplicaNode = node->as<ClientReplicaNode>();
+	if (clientReplicaNode)
+	{
+		writer.write("type", 0);
+		writer.beginObject("data");
+		writer.write("replica", clientReplicaNode->replica());
+		writer.endObject();
+	}
+
+	const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+	if (expectedWordsNode)
+	{
+		writer.write("type", 1);
+		writer.beginObject("data");
+
+		writer.beginArray("expectedWords");
+		for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+		{
+			writer.beginObject();
+			writer.write("words", words.words);
+			writer.write("score", words.score);
+			writer.endObject();
+		}
+		writer.endArray();
+
+		writer.write("forbidden", expectedWordsNode->forbidden());
+
+		if (!expectedWordsNode->forbidden())
+		{
+			writer.write("minScore", expectedWordsNode->minScore());
+		}
+
+		if (expectedWordsNode->customHint())
+		{
+			writer.write("hint", expectedWordsNode->hint());
+		}
+
+		writer.endObject();
+	}
+
+	writer.writeArray("parentNodes", node->parentNodes());
+	writer.writeArray("childNodes", node->childNodes());
+	writer.endObject();
+}
+
+void writeError(JsonStreamWriter& writer, const char* key, const ErrorReplica& error)
+{
+	writer.beginObject(key);
+
+	if (error.errorReplica)
+	{
+		writer.write("errorReplica", *error.errorReplica);
+	}
+
+	if (error.errorPenalty)
+	{
+		writer.write("errorPenalty", *error.errorPenalty);
+	}
+
+	if (error.finishingExpectedWords)
+	{
+		writer.writeArray("finishingExpectedWords", *error.finishingExpectedWords);
+	}
+
+	if (error.finishingReplica)
+	{
+		writer.write("finishingReplica", *error.finishingReplica);
+	}
+
+	writer.endObject();
+}
+
+void writePhase(JsonStreamWriter& writer, const PhaseNode& phase)
+{
+	writer.beginObject();
+	writer.write("id", phase.id());
+	writer.write("name", phase.name());
+	writer.write("score", phase.score());
+	writer.write("repeatOnInsufficientScore", phase.repeatOnInsufficientScore());
+
+	writer.beginArray("nodes");
+	for (const AbstractDialogNode* node : phase.nodes())
+	{
+		writeNode(writer, node);
+	}
+	writer.endArray();
+
+	if (phase.errorReplica().hasAnyField())
+	{
+		writeError(writer, "errorReplica", phase.errorReplica());
+	}
+
+	if (phase.repeatReplica())
+	{
+		writer.write("repeatReplica", *phase.repeatReplica());
+	}
+
+	writer.endObject();
+}
+
 }
 
 DialogJsonWriter::DialogJsonWriter()
@@ -140,9 +247,16 @@ DialogJsonWriter::DialogJsonWriter()
 
 QString DialogJsonWriter::write(const Dialog& dialog, bool compact)
 {
+	if (compact)
+	{
+		QByteArray buffer;
+		write(dialog, buffer);
+		return QString::fromUtf8(buffer);
+	}
+
 	const QJsonObject object = writeToObject(dialog);
 	const QJsonDocument document = QJsonDocument(object);
-	return QString::fromLatin1(document.toJson((compact ? QJsonDocument::Compact : QJsonDocument::Indented)));
+	return QString::fromUtf8(document.toJson((compact ? QJsonDocument::Compact : QJsonDocument::Indented)));
 }
 
 QJsonObject DialogJsonWriter::writeToObject(const Dialog& dialog)
@@ -169,4 +283,40 @@ QJsonObject DialogJsonWriter::writeToObject(const Dialog& dialog)
 	return result;
 }
 
+void DialogJsonWriter::write(const Dialog& dialog, JsonStreamWriter& writer)
+{
+	writer.beginObject();
+	writer.write("name", dialog.name);
+	writer.write("difficulty", static_cast<int>(dialog.difficulty));
+	writer.write("note", dialog.note);
+	writer.write("successRatio", dialog.successRatio / 100);
+
+	writer.beginArray("phases");
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		writePhase(writer, phase);
+	}
+	writer.endArray();
+
+	writer.writeArray("groups", dialog.groups);
+
+	if (dialog.errorReplica.hasAnyField())
+	{
+		writeError(writer, "errorReplica", dialog.errorReplica);
+	}
+
+	if (dialog.phaseRepeatReplica)
+	{
+		writer.write("phaseRepeatReplica", *dialog.phaseRepeatReplica);
+	}
+
+	writer.endObject();
+}
+
+void DialogJsonWriter::write(const Dialog& dialog, QByteArray& buffer)
+{
+	JsonStreamWriter writer(buffer);
+	write(dialog, writer);
+}
+
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "dialog.h"
+#include "jsonstreamwriter.h"
 #include <QJsonObject>
 
 namespace Core
@@ -13,6 +14,11 @@ public:
 
 	QString write(const Dialog& dialog, bool compact = false);
 	QJsonObject writeToObject(const Dialog& dialog);
+
+	// Streams the dialog without building a QJsonObject, e.g. as a value of a message being written
+	void write(const Dialog& dialog, JsonStreamWriter& writer);
+	// Appends compact UTF-8 JSON of the dialog, the buffer can be reused for many dialogs
+	void write(const Dialog& dialog, QByteArray& buffer);
 };
 
 }
@@ -0,0 +1,229 @@
+#include "dialogrewriter.h"
+
+#include <QtConcurrent>
+
+#include <functional>
+
+namespace Core
+{
+
+DialogRewriter::DialogRewriter(const QString& pattern, const QString& replacement, bool regularExpression, bool caseSensitive)
+	: m_pattern(pattern)
+	, m_replacement(replacement)
+	, m_regularExpression(regularExpression)
+	, m_caseSensitivity(caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive)
+{
+	if (m_regularExpression)
+	{
+		m_expression.setPattern(pattern);
+		m_expression.setPatternOptions(caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+		// compiled once here, not in every worker thread
+		m_expression.optimize();
+	}
+}
+
+bool DialogRewriter::isValid() const
+{
+	return !m_pattern.isEmpty() && (!m_regularExpression || m_expression.isValid());
+}
+
+QString DialogRewriter::errorString() const
+{
+	if (m_pattern.isEmpty())
+	{
+		return "Не задан искомый текст";
+	}
+
+	if (m_regularExpression && !m_expression.isValid())
+	{
+		return "Ошибка в регулярном выражении: " + m_expression.errorString();
+	}
+
+	return QString();
+}
+
+DialogRewriter::Result DialogRewriter::rewrite(const QList<Dialog>& dialogs) const
+{
+	Result result;
+	if (!isValid())
+	{
+		return result;
+	}
+
+	const std::function<Result(const Dialog&)> rewriteOne = [this](const Dialog& dialog)
+	{
+		return rewrite(dialog);
+	};
+
+	for (const Result& dialogResult : QtConcurrent::blockingMapped<QList<Result>>(dialogs, rewriteOne))
+	{
+		for (auto it = dialogResult.updated.begin(); it != dialogResult.updated.end(); ++it)
+		{
+			result.updated.insert(it.key(), it.value());
+		}
+
+		result.matches += dialogResult.matches;
+	}
+
+	return result;
+}
+
+DialogRewriter::Result DialogRewriter::rewrite(const Dialog& source) const
+{
+	Result result;
+
+	// phases and nodes are shared with the source until they are modified
+	Dialog dialog = source;
+	const QString dialogName = source.printableName();
+	bool changed = false;
+
+	changed |= rewriteText(dialogName, {}, Field::Note, dialog.note, result.matches);
+	changed |= rewriteErrorReplica(dialogName, {}, dialog.errorReplica, result.matches);
+
+	for (PhaseNode& phase : dialog.phases)
+	{
+		// read through the const overload, the mutable one would detach the phase and drop its hash
+		ErrorReplica errorReplica = qAsConst(phase).errorReplica();
+		if (rewriteErrorReplica(dialogName, phase.id(), errorReplica, result.matches))
+		{
+			phase.setErrorReplica(errorReplica);
+			changed = true;
+		}
+
+		// the list is detached by mutableNode(), so the nodes are accessed by index
+		for (int i = 0; i < phase.nodes().size(); ++i)
+		{
+			const AbstractDialogNode* node = phase.nodes()[i];
+
+			const ClientReplicaNode* clientReplicaNode = node->as<ClientReplicaNode>();
+			if (clientReplicaNode)
+			{
+				QString replica = clientReplicaNode->replica();
+				if (rewriteText(dialogName, node->id(), Field::ClientReplica, replica, result.matches))
+				{
+					phase.mutableNode(node->id())->as<ClientReplicaNode>()->setReplica(replica);
+					changed = true;
+				}
+
+				continue;
+			}
+
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (!expectedWordsNode)
+			{
+				continue;
+			}
+
+			QList<ExpectedWords> expectedWords = expectedWordsNode->expectedWords();
+			bool expectedWordsChanged = false;
+			for (ExpectedWords& words : expectedWords)
+			{
+				expectedWordsChanged |= rewriteText(dialogName, node->id(), Field::ExpectedWords, words.words, result.matches);
+			}
+
+			QString hint = expectedWordsNode->hint();
+			const bool hintChanged = expectedWordsNode->customHint() &&
+				rewriteText(dialogName, node->id(), Field::Hint, hint, result.matches);
+
+			if (!expectedWordsChanged && !hintChanged)
+			{
+				continue;
+			}
+
+			ExpectedWordsNode* mutableNode = phase.mutableNode(node->id())->as<ExpectedWordsNode>();
+			if (expectedWordsChanged)
+			{
+				mutableNode->setExpectedWords(expectedWords);
+			}
+
+			if (hintChanged)
+			{
+				mutableNode->setHint(hint);
+			}
+
+			changed = true;
+		}
+	}
+
+	if (changed)
+	{
+		result.updated.insert(source, dialog);
+	}
+
+	return result;
+}
+
+bool DialogRewriter::rewriteErrorReplica(const QString& dialog, const AbstractDialogNode::Id& node, ErrorReplica& errorReplica,
+	QVector<Match>& matches) const
+{
+	bool changed = false;
+
+	if (errorReplica.errorReplica)
+	{
+		QString text = *errorReplica.errorReplica;
+		if (rewriteText(dialog, node, Field::ErrorReplica, text, matches))
+		{
+			errorReplica.errorReplica = text;
+			changed = true;
+		}
+	}
+
+	if (errorReplica.finishingExpectedWords)
+	{
+		QList<QString> words = *errorReplica.finishingExpectedWords;
+		bool wordsChanged = false;
+		for (QString& text : words)
+		{
+			wordsChanged |= rewriteText(dialog, node, Field::ErrorReplica, text, matches);
+		}
+
+		if (wordsChanged)
+		{
+			errorReplica.finishingExpectedWords = words;
+			changed = true;
+		}
+	}
+
+	if (errorReplica.finishingReplica)
+	{
+		QString text = *errorReplica.finishingReplica;
+		if (rewriteText(dialog, node, Field::ErrorReplica, text, matches))
+		{
+			errorReplica.finishingReplica = text;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+bool DialogRewriter::rewriteText(const QString& dialog, const AbstractDialogNode::Id& node, Field field, QString& text,
+	QVector<Match>& matches) const
+{
+	// most texts don't match, so they are checked before copying
+	const bool found = m_regularExpression ? text.contains(m_expression) : text.contains(m_pattern, m_caseSensitivity);
+	if (!found)
+	{
+		return false;
+	}
+
+	const QString before = text;
+	if (m_regularExpression)
+	{
+		text.replace(m_expression, m_replacement);
+	}
+	else
+	{
+		text.replace(m_pattern, m_replacement, m_caseSensitivity);
+	}
+
+	if (text == before)
+	{
+		return false;
+	}
+
+	matches.append({ dialog, node, field, before, text });
+	return true;
+}
+
+}
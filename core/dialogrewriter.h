@@ -0,0 +1,60 @@
+#pragma once
+
+#include "dialog.h"
+#include "dialogsearchindex.h"
+
+#include <QMap>
+#include <QRegularExpression>
+#include <QVector>
+
+namespace Core
+{
+
+// Replaces a literal text or a regular expression in the same texts that DialogSearchIndex indexes.
+// Custom hints only, generated ones follow the expected words.
+class DialogRewriter
+{
+public:
+	typedef DialogSearchIndex::Field Field;
+
+	struct Match
+	{
+		// printable name of the dialog
+		QString dialog;
+		// id of the node or of the phase, empty for the note and the error replica of the dialog
+		AbstractDialogNode::Id node;
+		Field field;
+		QString before;
+		QString after;
+	};
+
+	struct Result
+	{
+		// source dialogs to the rewritten ones, changed dialogs only
+		QMap<Dialog, Dialog> updated;
+		QVector<Match> matches;
+	};
+
+	// Captures of a regular expression can be referred as \1, \2 etc. in the replacement
+	DialogRewriter(const QString& pattern, const QString& replacement, bool regularExpression, bool caseSensitive = true);
+
+	bool isValid() const;
+	QString errorString() const;
+
+	// Dialogs are rewritten in parallel, the source dialogs are not modified
+	Result rewrite(const QList<Dialog>& dialogs) const;
+
+private:
+	Result rewrite(const Dialog& dialog) const;
+	bool rewriteErrorReplica(const QString& dialog, const AbstractDialogNode::Id& node, ErrorReplica& errorReplica, QVector<Match>& matches) const;
+	bool rewriteText(const QString& dialog, const AbstractDialogNode::Id& node, Field field, QString& text, QVector<Match>& matches) const;
+
+private:
+	QString m_pattern;
+	QString m_replacement;
+	bool m_regularExpression;
+	Qt::CaseSensitivity m_caseSensitivity;
+	QRegularExpression m_expression;
+};
+
+}
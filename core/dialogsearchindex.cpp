@@ -0,0 +1,316 @@
+#include "dialogsearchindex.h"
+#include "textnormalizer.h"
+
+#include <QSet>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <tuple>
+
+namespace Core
+{
+
+namespace
+{
+
+QStringList uniqueWords(const QString& text)
+{
+	return TextNormalizer::words(text).toSet().toList();
+}
+
+// Document lists of the words with the same prefix and the total number of their entries
+struct Postings
+{
+	QVector<const QVector<int>*> lists;
+	int size { 0 };
+};
+
+template <typename Words>
+Postings findPrefix(const Words& words, const QString& prefix)
+{
+	Postings result;
+	for (auto it = words.lowerBound(prefix); it != words.end() && it.key().startsWith(prefix); ++it)
+	{
+		result.lists.append(&it.value());
+		result.size += it.value().size();
+	}
+	return result;
+}
+
+// Visits the documents of the sorted lists in ascending order without duplicates, until the visitor returns false.
+// Only the heads of the lists are kept in the queue, so stopping early doesn't touch the rest of them
+template <typename Visitor>
+void forEachDocument(const Postings& postings, Visitor visitor)
+{
+	// document, list, position in the list
+	typedef std::tuple<int, int, int> Cursor;
+	std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heads;
+
+	for (int i = 0; i < postings.lists.size(); ++i)
+	{
+		heads.emplace(postings.lists[i]->first(), i, 0);
+	}
+
+	int previous = -1;
+	while (!heads.empty())
+	{
+		const Cursor cursor = heads.top();
+		heads.pop();
+
+		const int document = std::get<0>(cursor);
+		const QVector<int>& list = *postings.lists[std::get<1>(cursor)];
+		const int next = std::get<2>(cursor) + 1;
+		if (next < list.size())
+		{
+			heads.emplace(list[next], std::get<1>(cursor), next);
+		}
+
+		if (document != previous)
+		{
+			previous = document;
+			if (!visitor(document))
+			{
+				return;
+			}
+		}
+	}
+}
+
+}
+
+void DialogSearchIndex::setDialogs(const Dialogs& dialogs)
+{
+	QSet<DialogKey> keys;
+
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		for (const Dialog& dialog : it.value())
+		{
+			const DialogKey key(it.key(), dialog.printableName());
+			keys.insert(key);
+
+			const size_t hash = dialog.hash();
+			const auto hashIt = m_hashes.constFind(key);
+			if (hashIt != m_hashes.constEnd() && *hashIt == hash)
+			{
+				continue;
+			}
+
+			removeDialog(key);
+			addDialog(it.key(), dialog);
+			m_hashes.insert(key, hash);
+		}
+	}
+
+	for (const DialogKey& key : m_hashes.keys())
+	{
+		if (!keys.contains(key))
+		{
+			removeDialog(key);
+		}
+	}
+}
+
+QVector<DialogSearchIndex::Hit> DialogSearchIndex::search(const QString& query, const QString& client, int limit) const
+{
+	const QStringList words = TextNormalizer::words(query);
+	if (words.isEmpty())
+	{
+		return {};
+	}
+
+	QVector<Hit> result;
+	if (!client.isEmpty())
+	{
+		const auto it = m_words.constFind(client);
+		if (it != m_words.constEnd())
+		{
+			searchClient(*it, words, limit, result);
+		}
+		return result;
+	}
+
+	for (auto it = m_words.constBegin(); it != m_words.constEnd() && result.size() < limit; ++it)
+	{
+		searchClient(*it, words, limit, result);
+	}
+
+	return result;
+}
+
+void DialogSearchIndex::searchClient(const Words& words, const QStringList& query, int limit, QVector<Hit>& result) const
+{
+	// documents are read from the rarest word, the others are checked against the words of every document
+	int rarest = -1;
+	Postings postings;
+	for (int i = 0; i < query.size(); ++i)
+	{
+		Postings wordPostings = findPrefix(words, query[i]);
+		if (wordPostings.lists.isEmpty())
+		{
+			return;
+		}
+
+		if (rarest < 0 || wordPostings.size < postings.size)
+		{
+			rarest = i;
+			postings = wordPostings;
+		}
+	}
+
+	forEachDocument(postings, [this, &query, rarest, limit, &result](int id)
+	{
+		const Document& document = *m_documents.constFind(id);
+
+		for (int i = 0; i < query.size(); ++i)
+		{
+			const QString& prefix = query[i];
+			if (i != rarest && std::none_of(document.words.begin(), document.words.end(),
+				[&prefix](const QString& word) { return word.startsWith(prefix); }))
+			{
+				return true;
+			}
+		}
+
+		result.append(document.hit);
+		return result.size() < limit;
+	});
+}
+
+QString DialogSearchIndex::fieldName(Field field)
+{
+	switch (field)
+	{
+	case Field::Note:
+		return "Примечание";
+	case Field::ClientReplica:
+		return "Реплика клиента";
+	case Field::ExpectedWords:
+		return "Опорные слова";
+	case Field::Hint:
+		return "Подсказка";
+	case Field::ErrorReplica:
+		return "Реплика ошибки";
+	}
+
+	Q_ASSERT(false);
+	return QString();
+}
+
+void DialogSearchIndex::addDialog(const QString& client, const Dialog& dialog)
+{
+	const QString dialogName = dialog.printableName();
+	QVector<int>& documents = m_dialogDocuments[DialogKey(client, dialogName)];
+
+	const auto addErrorReplica = [&](const AbstractDialogNode::Id& node, const ErrorReplica& errorReplica)
+	{
+		if (errorReplica.errorReplica)
+		{
+			addDocument({ client, dialogName, node, Field::ErrorReplica, *errorReplica.errorReplica }, documents);
+		}
+
+		if (errorReplica.finishingExpectedWords)
+		{
+			for (const QString& words : *errorReplica.finishingExpectedWords)
+			{
+				addDocument({ client, dialogName, node, Field::ErrorReplica, words }, documents);
+			}
+		}
+
+		if (errorReplica.finishingReplica)
+		{
+			addDocument({ client, dialogName, node, Field::ErrorReplica, *errorReplica.finishingReplica }, documents);
+		}
+	};
+
+	addDocument({ client, dialogName, {}, Field::Note, dialog.note }, documents);
+	addErrorReplica({}, dialog.errorReplica);
+
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		addErrorReplica(phase.id(), phase.errorReplica());
+
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			const ClientReplicaNode* clientReplicaNode = node->as<ClientReplicaNode>();
+			if (clientReplicaNode)
+			{
+				addDocument({ client, dialogName, node->id(), Field::ClientReplica, clientReplicaNode->replica() }, documents);
+				continue;
+			}
+
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (expectedWordsNode)
+			{
+				for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+				{
+					addDocument({ client, dialogName, node->id(), Field::ExpectedWords, words.words }, documents);
+				}
+
+				if (expectedWordsNode->customHint())
+				{
+					addDocument({ client, dialogName, node->id(), Field::Hint, expectedWordsNode->hint() }, documents);
+				}
+			}
+		}
+	}
+}
+
+void DialogSearchIndex::removeDialog(const DialogKey& key)
+{
+	m_hashes.remove(key);
+
+	const auto clientIt = m_words.find(key.first);
+
+	for (int document : m_dialogDocuments.take(key))
+	{
+		Q_ASSERT(clientIt != m_words.end());
+		Words& clientWords = *clientIt;
+
+		for (const QString& word : m_documents.take(document).words)
+		{
+			const auto it = clientWords.find(word);
+			Q_ASSERT(it != clientWords.end());
+
+			QVector<int>& documents = *it;
+			const auto documentIt = std::lower_bound(documents.begin(), documents.end(), document);
+			if (documentIt != documents.end() && *documentIt == document)
+			{
+				documents.erase(documentIt);
+			}
+
+			if (documents.isEmpty())
+			{
+				clientWords.erase(it);
+			}
+		}
+	}
+
+	if (clientIt != m_words.end() && clientIt->isEmpty())
+	{
+		m_words.erase(clientIt);
+	}
+}
+
+void DialogSearchIndex::addDocument(const Hit& hit, QVector<int>& documents)
+{
+	const QStringList words = uniqueWords(hit.text);
+	if (words.isEmpty())
+	{
+		return;
+	}
+
+	// ids only grow, so appending keeps the lists sorted
+	const int document = m_nextDocument++;
+	m_documents.insert(document, { hit, words });
+	documents.append(document);
+
+	Words& clientWords = m_words[hit.client];
+	for (const QString& word : words)
+	{
+		clientWords[word].append(document);
+	}
+}
+
+}
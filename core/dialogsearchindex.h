@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+
+namespace Core
+{
+
+// Full text index of the dialog texts: notes, client replicas, expected words, hints and error replicas.
+// Every word of a query matches the words starting with it, so the results are updated as the query is typed.
+// Like ExpectedWordsIndex, setDialogs() reindexes only the changed dialogs.
+class DialogSearchIndex
+{
+public:
+	typedef QMap<QString, QList<Dialog>> Dialogs;
+
+	enum class Field
+	{
+		Note,
+		ClientReplica,
+		ExpectedWords,
+		Hint,
+		ErrorReplica
+	};
+
+	struct Hit
+	{
+		// database name of the client
+		QString client;
+		// printable name of the dialog
+		QString dialog;
+		// id of the phase for its error replica, empty for the note and the error replica of the dialog
+		AbstractDialogNode::Id node;
+		Field field;
+		QString text;
+	};
+
+	void setDialogs(const Dialogs& dialogs);
+
+	// Texts of the client (of all clients if it's empty) with words starting with every word of the query.
+	// Stops at the limit, so a short prefix costs as much as the hits returned, not as all its documents
+	QVector<Hit> search(const QString& query, const QString& client = QString(), int limit = 100) const;
+
+	static QString fieldName(Field field);
+
+private:
+	typedef QPair<QString, QString> DialogKey;
+	// sorted ids of the documents by word, the map keeps the words with the same prefix together
+	typedef QMap<QString, QVector<int>> Words;
+
+	struct Document
+	{
+		Hit hit;
+		// unique lower cased words of the text
+		QStringList words;
+	};
+
+	void addDialog(const QString& client, const Dialog& dialog);
+	void removeDialog(const DialogKey& key);
+	void addDocument(const Hit& hit, QVector<int>& documents);
+
+	// Appends the hits of one client in the order of the documents
+	void searchClient(const Words& words, const QStringList& query, int limit, QVector<Hit>& result) const;
+
+private:
+	QHash<DialogKey, size_t> m_hashes;
+	QHash<DialogKey, QVector<int>> m_dialogDocuments;
+	QHash<int, Document> m_documents;
+	int m_nextDocument { 0 };
+	// words are kept per client, so searching one client doesn't merge the documents of the others
+	QMap<QString, Words> m_words;
+};
+
+}
@@ -0,0 +1,459 @@
+#include "dialogsimulator.h"
+
+#include <QVarLengthArray>
+#include <QtConcurrent>
+
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+namespace Core
+{
+
+DialogSimulator::DialogSimulator(const Dialog& dialog, int maxTypos)
+	: m_dialog(dialog)
+	, m_maxTypos(maxTypos)
+	, m_root(-1)
+	, m_maxScore(0.0)
+{
+	QHash<AbstractDialogNode::Id, int> indexes;
+
+	for (int phaseIndex = 0; phaseIndex < m_dialog.phases.size(); ++phaseIndex)
+	{
+		const PhaseNode& phase = m_dialog.phases.at(phaseIndex);
+
+		const ErrorReplica& errorReplica = phase.errorReplica().errorPenalty ? phase.errorReplica() : m_dialog.errorReplica;
+		m_phases.append({ phase.score(), phase.repeatOnInsufficientScore(), errorReplica.errorPenalty ? *errorReplica.errorPenalty : 0.0 });
+
+		// calculated here once, the score cache of the phase isn't meant to be used by every simulation thread
+		m_maxScore += phase.bestPossibleScore();
+
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			Node entry { node, phaseIndex, {}, false, 0, false, {} };
+
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (expectedWordsNode)
+			{
+				entry.minScore = expectedWordsNode->minScore();
+				entry.forbidden = expectedWordsNode->forbidden();
+
+				for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+				{
+					entry.wordScores.append(words.score);
+				}
+			}
+
+			indexes.insert(node->id(), m_nodes.size());
+			m_nodes.append(entry);
+		}
+	}
+
+	for (Node& node : m_nodes)
+	{
+		for (const AbstractDialogNode::Id& id : node.node->childNodes())
+		{
+			const int child = indexes.value(id, -1);
+			if (child < 0)
+			{
+				continue;
+			}
+
+			node.children.append(child);
+			node.expectsAnswer = node.expectsAnswer || m_nodes[child].node->type() == ExpectedWordsNode::Type;
+		}
+	}
+
+	m_matcher = ExpectedWordsMatcher::compiled(m_dialog);
+	for (const ExpectedWordsMatcher::Pattern& pattern : m_matcher->patterns())
+	{
+		const int node = indexes.value(pattern.node, -1);
+		m_patternNodes.append(node >= 0 && m_nodes[node].node->type() == ExpectedWordsNode::Type ? node : -1);
+	}
+
+	const auto rootIt = std::find_if(m_nodes.begin(), m_nodes.end(),
+		[](const Node& node) { return node.node->parentNodes().isEmpty(); });
+	if (rootIt != m_nodes.end())
+	{
+		m_root = std::distance(m_nodes.begin(), rootIt);
+	}
+}
+
+DialogSimulator::Result DialogSimulator::simulate(const Transcript& transcript) const
+{
+	Result result { {}, {}, 0, 0.0, 0.0, m_maxScore, false, false };
+
+	QVector<double> phaseScores(m_phases.size(), 0.0);
+
+	if (m_root >= 0)
+	{
+		int current = m_root;
+		int answer = 0;
+
+		int phaseEntry = m_root;
+		int phaseFirstAnswer = 0;
+
+		// protects from cycles of client replicas in broken dialogs
+		int stepsWithoutAnswer = 0;
+
+		const auto moveTo = [&](int next)
+		{
+			const int phase = m_nodes[current].phase;
+			if (m_nodes[next].phase != phase)
+			{
+				const bool repeat = phaseScores[phase] < m_phases[phase].score && m_phases[phase].repeatOnInsufficientScore &&
+					answer > phaseFirstAnswer && answer < transcript.size();
+				if (repeat)
+				{
+					phaseScores[phase] = 0.0;
+					next = phaseEntry;
+				}
+				else
+				{
+					phaseEntry = next;
+				}
+
+				phaseFirstAnswer = answer;
+			}
+
+			current = next;
+		};
+
+		while (true)
+		{
+			const Node& node = m_nodes[current];
+			result.path.append(node.node->id());
+
+			if (node.children.isEmpty())
+			{
+				result.finished = true;
+				break;
+			}
+
+			if (!node.expectsAnswer)
+			{
+				if (++stepsWithoutAnswer > m_nodes.size())
+				{
+					break;
+				}
+
+				moveTo(node.children.first());
+				continue;
+			}
+
+			stepsWithoutAnswer = 0;
+
+			int next = -1;
+			while (next < 0 && answer < transcript.size())
+			{
+				const QHash<int, double> scores = match(transcript[answer++]);
+
+				int best = -1;
+				double bestScore = 0.0;
+				int forbidden = -1;
+
+				for (int child : node.children)
+				{
+					const auto scoreIt = scores.find(child);
+					if (scoreIt == scores.end())
+					{
+						continue;
+					}
+
+					const Node& childNode = m_nodes[child];
+					const double score = *scoreIt;
+
+					if (childNode.forbidden)
+					{
+						forbidden = child;
+						break;
+					}
+
+					if (score >= childNode.minScore && (best < 0 || score > bestScore))
+					{
+						best = child;
+						bestScore = score;
+					}
+				}
+
+				if (forbidden < 0 && best >= 0)
+				{
+					phaseScores[m_nodes[best].phase] += bestScore;
+					next = best;
+					continue;
+				}
+
+				++result.errors;
+				result.penalty += m_phases[node.phase].errorPenalty;
+
+				// a forbidden answer continues the dialog if the graph has a reaction for it
+				if (forbidden >= 0 && !m_nodes[forbidden].children.isEmpty())
+				{
+					next = forbidden;
+				}
+			}
+
+			if (next < 0)
+			{
+				break;
+			}
+
+			moveTo(next);
+		}
+	}
+
+	result.phaseScores = phaseScores.toList();
+	result.score = std::accumulate(phaseScores.begin(), phaseScores.end(), 0.0) - result.penalty;
+
+	const double ratio = m_maxScore > 0.0 ? result.score / m_maxScore * 100.0 : 100.0;
+	result.passed = result.finished && ratio >= m_dialog.successRatio;
+
+	return result;
+}
+
+QList<DialogSimulator::Result> DialogSimulator::simulate(const QList<Transcript>& transcripts) const
+{
+	const std::function<Result(const Transcript&)> simulateOne = [this](const Transcript& transcript)
+	{
+		return simulate(transcript);
+	};
+
+	return QtConcurrent::blockingMapped<QList<Result>>(transcripts, simulateOne);
+}
+
+QHash<int, double> DialogSimulator::match(const QString& answer) const
+{
+	QHash<int, double> result;
+	QSet<int> foundPatterns;
+
+	for (const ExpectedWordsMatcher::Hit& hit : m_matcher->match(ExpectedWordsMatcher::normalize(answer), m_maxTypos))
+	{
+		// every phrase is scored once however many times it is repeated
+		if (foundPatterns.contains(hit.pattern))
+		{
+			continue;
+		}
+		foundPatterns.insert(hit.pattern);
+
+		const int node = m_patternNodes[hit.pattern];
+		if (node >= 0)
+		{
+			result[node] += m_matcher->patterns()[hit.pattern].score;
+		}
+	}
+
+	return result;
+}
+
+double DialogSimulator::Estimate::passRate() const
+{
+	return sessions > 0 ? static_cast<double>(passed) / sessions : 0.0;
+}
+
+double DialogSimulator::Estimate::passRate(double successRatio) const
+{
+	if (sessions == 0)
+	{
+		return 0.0;
+	}
+
+	int result = 0;
+	for (int bucket = std::max(0, static_cast<int>(std::ceil(successRatio))); bucket < histogram.size(); ++bucket)
+	{
+		result += histogram[bucket];
+	}
+	return static_cast<double>(result) / sessions;
+}
+
+DialogSimulator::Estimate DialogSimulator::estimate(const Behaviour& behaviour, int sessions, quint64 seed) const
+{
+	// doesn't depend on the number of threads, so the same chunks get the same generators
+	static const int s_chunkSize = 10000;
+
+	QList<int> chunks;
+	for (int chunk = 0; chunk * s_chunkSize < sessions; ++chunk)
+	{
+		chunks.append(chunk);
+	}
+
+	const std::function<Estimate(int)> estimateOne = [this, &behaviour, sessions, seed](int chunk)
+	{
+		return estimateChunk(behaviour, std::min(s_chunkSize, sessions - chunk * s_chunkSize), seed, chunk);
+	};
+
+	Estimate result { 0, 0, 0, 0.0, QVector<int>(101, 0) };
+	for (const Estimate& chunk : QtConcurrent::blockingMapped<QList<Estimate>>(chunks, estimateOne))
+	{
+		result.sessions += chunk.sessions;
+		result.finished += chunk.finished;
+		result.passed += chunk.passed;
+		result.meanScore += chunk.meanScore;
+
+		for (int bucket = 0; bucket < result.histogram.size(); ++bucket)
+		{
+			result.histogram[bucket] += chunk.histogram[bucket];
+		}
+	}
+
+	result.meanScore = result.finished > 0 ? result.meanScore / result.finished : 0.0;
+	return result;
+}
+
+DialogSimulator::Estimate DialogSimulator::estimateChunk(const Behaviour& behaviour, int sessions, quint64 seed, int chunk) const
+{
+	std::seed_seq seedSequence { static_cast<quint32>(seed), static_cast<quint32>(seed >> 32), static_cast<quint32>(chunk) };
+	std::mt19937_64 random(seedSequence);
+
+	// meanScore holds the sum of the scores until the chunks are merged
+	Estimate result { sessions, 0, 0, 0.0, QVector<int>(101, 0) };
+
+	for (int session = 0; session < sessions; ++session)
+	{
+		double score = 0.0;
+		if (!sampleSession(behaviour, random, score))
+		{
+			continue;
+		}
+
+		++result.finished;
+		result.meanScore += score;
+		++result.histogram[qBound(0, static_cast<int>(score), 100)];
+
+		if (score >= m_dialog.successRatio)
+		{
+			++result.passed;
+		}
+	}
+
+	return result;
+}
+
+bool DialogSimulator::sampleSession(const Behaviour& behaviour, std::mt19937_64& random, double& score) const
+{
+	std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+	score = 0.0;
+	if (m_root < 0)
+	{
+		return false;
+	}
+
+	QVarLengthArray<double, 16> phaseScores(m_phases.size());
+	std::fill(phaseScores.begin(), phaseScores.end(), 0.0);
+	double penalty = 0.0;
+
+	int current = m_root;
+	int phaseEntry = m_root;
+	int phaseRepeats = 0;
+	int stepsWithoutAnswer = 0;
+
+	while (!m_nodes[current].children.isEmpty())
+	{
+		const Node& node = m_nodes[current];
+		int next = -1;
+
+		if (!node.expectsAnswer)
+		{
+			if (++stepsWithoutAnswer > m_nodes.size())
+			{
+				return false;
+			}
+
+			next = node.children.first();
+		}
+		else
+		{
+			stepsWithoutAnswer = 0;
+
+			const auto forbiddenIt = std::find_if(node.children.begin(), node.children.end(),
+				[this](int child) { return m_nodes[child].forbidden; });
+
+			for (int answer = 0; next < 0 && answer < behaviour.maxAnswers; ++answer)
+			{
+				if (forbiddenIt != node.children.end() && chance(random) < behaviour.forbiddenProbability)
+				{
+					penalty += m_phases[node.phase].errorPenalty;
+
+					if (!m_nodes[*forbiddenIt].children.isEmpty())
+					{
+						next = *forbiddenIt;
+					}
+					continue;
+				}
+
+				int best = -1;
+				double bestScore = 0.0;
+
+				for (int child : node.children)
+				{
+					const Node& childNode = m_nodes[child];
+					if (childNode.forbidden || childNode.wordScores.isEmpty())
+					{
+						continue;
+					}
+
+					bool said = false;
+					double childScore = 0.0;
+					for (double wordScore : childNode.wordScores)
+					{
+						if (chance(random) < behaviour.wordProbability)
+						{
+							said = true;
+							childScore += wordScore;
+						}
+					}
+
+					if (said && childScore >= childNode.minScore && (best < 0 || childScore > bestScore))
+					{
+						best = child;
+						bestScore = childScore;
+					}
+				}
+
+				if (best >= 0)
+				{
+					phaseScores[m_nodes[best].phase] += bestScore;
+					next = best;
+				}
+				else
+				{
+					penalty += m_phases[node.phase].errorPenalty;
+				}
+			}
+
+			if (next < 0)
+			{
+				return false;
+			}
+		}
+
+		const int phase = node.phase;
+		if (m_nodes[next].phase != phase)
+		{
+			if (phaseScores[phase] < m_phases[phase].score && m_phases[phase].repeatOnInsufficientScore)
+			{
+				if (phaseRepeats >= behaviour.maxPhaseRepeats || chance(random) >= behaviour.repeatProbability)
+				{
+					return false;
+				}
+
+				++phaseRepeats;
+				phaseScores[phase] = 0.0;
+				next = phaseEntry;
+			}
+			else
+			{
+				phaseEntry = next;
+				phaseRepeats = 0;
+			}
+		}
+
+		current = next;
+	}
+
+	const double total = std::accumulate(phaseScores.begin(), phaseScores.end(), 0.0) - penalty;
+	score = m_maxScore > 0.0 ? total / m_maxScore * 100.0 : 100.0;
+	return true;
+}
+
+}
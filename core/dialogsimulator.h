@@ -0,0 +1,122 @@
+#pragma once
+
+#include "dialog.h"
+#include "expectedwordsmatcher.h"
+
+#include <QVector>
+
+#include <random>
+
+namespace Core
+{
+
+// Replays learner answers against a dialog graph.
+// Starting from the root node the client replicas are passed through, every answer is matched
+// against the expected words following the current replica: the best scoring not forbidden node
+// with at least minScore points is taken, a forbidden or not recognized answer is an error.
+// A phase with insufficient score is replayed if repeatOnInsufficientScore is set.
+//
+// estimate() replays sessions of random learners instead of transcripts, to see how many of them pass the dialog.
+//
+// The graph is prepared once in the constructor, simulate() and estimate() don't modify anything
+// and can be called from several threads at once.
+class DialogSimulator
+{
+public:
+	typedef QStringList Transcript;
+
+	struct Result
+	{
+		QList<AbstractDialogNode::Id> path;
+		QList<double> phaseScores;
+		int errors;
+		double penalty;
+		double score;
+		double maxScore;
+		// whether the transcript reached a node without children
+		bool finished;
+		bool passed;
+	};
+
+	// Behaviour of a random learner for estimate()
+	struct Behaviour
+	{
+		// probability to say every expected word of a node, the words are said independently
+		double wordProbability { 0.7 };
+		// probability that an answer hits a forbidden node, if the replica has one
+		double forbiddenProbability { 0.05 };
+		// probability to repeat a phase finished with insufficient score instead of giving up
+		double repeatProbability { 0.5 };
+		// the learner gives up after so many unrecognized answers to a replica
+		int maxAnswers { 3 };
+		int maxPhaseRepeats { 3 };
+	};
+
+	struct Estimate
+	{
+		int sessions;
+		int finished;
+		int passed;
+		// average score of the finished sessions, percent of the max score
+		double meanScore;
+		// number of finished sessions by score percent, buckets of 1% from 0 to 100
+		QVector<int> histogram;
+
+		double passRate() const;
+		// pass rate with another success ratio, rounded to the histogram buckets
+		double passRate(double successRatio) const;
+	};
+
+	// Answers may contain up to maxTypos typos in every expected phrase, see ExpectedWordsMatcher::match
+	explicit DialogSimulator(const Dialog& dialog, int maxTypos = 0);
+
+	Result simulate(const Transcript& transcript) const;
+	// Replays the transcripts in parallel on all cores
+	QList<Result> simulate(const QList<Transcript>& transcripts) const;
+
+	// Samples sessions of random learners on all cores.
+	// Sessions are split into chunks with their own generators seeded from the seed and the chunk number,
+	// so the result depends on the seed only, not on the number of threads
+	Estimate estimate(const Behaviour& behaviour, int sessions, quint64 seed) const;
+
+private:
+	struct Node
+	{
+		const AbstractDialogNode* node;
+		int phase;
+		QVector<int> children;
+		bool expectsAnswer;
+
+		// expected words only
+		int minScore;
+		bool forbidden;
+		QVector<double> wordScores;
+	};
+
+	struct Phase
+	{
+		double score;
+		bool repeatOnInsufficientScore;
+		double errorPenalty;
+	};
+
+	// Scores of the expected words nodes found in the answer by their indexes
+	QHash<int, double> match(const QString& answer) const;
+
+	// Returns whether the learner finished the dialog, score is the percent of the max score
+	bool sampleSession(const Behaviour& behaviour, std::mt19937_64& random, double& score) const;
+	Estimate estimateChunk(const Behaviour& behaviour, int sessions, quint64 seed, int chunk) const;
+
+private:
+	Dialog m_dialog;
+	QVector<Node> m_nodes;
+	QVector<Phase> m_phases;
+	std::shared_ptr<const ExpectedWordsMatcher> m_matcher;
+	// index of the node of every matcher pattern, -1 for finishing words
+	QVector<int> m_patternNodes;
+	int m_maxTypos;
+	int m_root;
+	double m_maxScore;
+};
+
+}
@@ -0,0 +1,46 @@
+#include "dialogsnapshot.h"
+
+namespace Core
+{
+
+DialogSnapshot::DialogSnapshot()
+{
+}
+
+DialogSnapshot::DialogSnapshot(const Dialog& dialog)
+{
+	std::shared_ptr<Dialog> copy = std::make_shared<Dialog>(dialog);
+
+	for (PhaseNode& phase : copy->phases)
+	{
+		QList<AbstractDialogNode*> nodes;
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			nodes.append(node->clone(false));
+		}
+		phase.setNodes(nodes);
+
+		// hashes are cached on the first use, so they are computed while the copy is private
+		for (const AbstractDialogNode* node : nodes)
+		{
+			node->hash();
+		}
+		phase.hash();
+		phase.contentHash();
+	}
+
+	m_dialog = copy;
+}
+
+bool DialogSnapshot::isNull() const
+{
+	return !m_dialog;
+}
+
+const Dialog& DialogSnapshot::dialog() const
+{
+	Q_ASSERT(m_dialog);
+	return *m_dialog;
+}
+
+}
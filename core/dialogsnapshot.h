@@ -0,0 +1,26 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <memory>
+
+namespace Core
+{
+
+// Immutable copy of a dialog for worker threads. The nodes are copied, so the editor keeps modifying
+// its own nodes in place, and their cached hashes are computed beforehand, so reading the snapshot
+// from several threads writes nothing. Copies of the snapshot and of its dialog share the data
+class DialogSnapshot
+{
+public:
+	DialogSnapshot();
+	explicit DialogSnapshot(const Dialog& dialog);
+
+	bool isNull() const;
+	const Dialog& dialog() const;
+
+private:
+	std::shared_ptr<const Dialog> m_dialog;
+};
+
+}
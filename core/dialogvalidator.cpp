@@ -0,0 +1,545 @@
+#include "dialogvalidator.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+bool isPhase(const AbstractDialogNode* node)
+{
+	return node->type() == PhaseNode::Type;
+}
+
+}
+
+DialogValidator::DialogValidator()
+	: m_dialog(nullptr)
+	, m_nextOrder(0)
+	, m_roots(0)
+	, m_phaseRoots(0)
+	, m_leafs(0)
+	, m_multipleLinks(0)
+{
+}
+
+QList<DialogValidator::Violation> DialogValidator::validate(const Dialog& dialog)
+{
+	DialogValidator validator;
+	validator.setDialog(&dialog);
+
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		validator.addNode(&phase);
+
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			validator.nodeAddedToPhase(node, &phase);
+			validator.addNode(node);
+		}
+	}
+
+	return validator.violations();
+}
+
+void DialogValidator::setDialog(const Dialog* dialog)
+{
+	m_dialog = dialog;
+}
+
+void DialogValidator::clear()
+{
+	m_nodes.clear();
+	m_phases.clear();
+	m_nodeById.clear();
+	m_order.clear();
+	m_nextOrder = 0;
+	m_dirty.clear();
+	m_errors.clear();
+	m_roots = 0;
+	m_phaseRoots = 0;
+	m_leafs = 0;
+	m_multipleLinks = 0;
+	m_outsidePhases.clear();
+	m_branchingPhases.clear();
+}
+
+void DialogValidator::addNode(const AbstractDialogNode* node)
+{
+	if (isPhase(node))
+	{
+		ensurePhase(node);
+		markDirty(node);
+		return;
+	}
+
+	ensureNode(node);
+
+	uncount(node);
+	count(node);
+
+	for (const AbstractDialogNode::Id& id : node->childNodes())
+	{
+		const AbstractDialogNode* child = m_nodeById.value(id);
+		if (child && m_nodes.contains(child))
+		{
+			addEdge(node, child);
+		}
+	}
+
+	for (const AbstractDialogNode::Id& id : node->parentNodes())
+	{
+		const AbstractDialogNode* parent = m_nodeById.value(id);
+		if (parent && m_nodes.contains(parent))
+		{
+			addEdge(parent, node);
+		}
+	}
+
+	markDirty(node);
+}
+
+void DialogValidator::removeNode(const AbstractDialogNode* node)
+{
+	if (isPhase(node))
+	{
+		if (!m_phases.contains(node))
+		{
+			return;
+		}
+
+		const QSet<const AbstractDialogNode*> phaseNodes = m_phases[node].nodes;
+		for (const AbstractDialogNode* phaseNode : phaseNodes)
+		{
+			setPhase(phaseNode, nullptr);
+		}
+
+		m_phases.remove(node);
+		m_branchingPhases.remove(node);
+	}
+	else
+	{
+		if (!m_nodes.contains(node))
+		{
+			return;
+		}
+
+		const NodeState state = m_nodes[node];
+		for (const AbstractDialogNode* parent : state.parents)
+		{
+			removeEdge(parent, node);
+		}
+
+		for (const AbstractDialogNode* child : state.children)
+		{
+			removeEdge(node, child);
+		}
+
+		setPhase(node, nullptr);
+		uncount(node);
+		m_nodes.remove(node);
+	}
+
+	if (m_nodeById.value(node->id()) == node)
+	{
+		m_nodeById.remove(node->id());
+	}
+
+	m_order.remove(node);
+	m_dirty.remove(node);
+	m_errors.remove(node);
+}
+
+void DialogValidator::nodeChanged(const AbstractDialogNode* node)
+{
+	if (isPhase(node) ? m_phases.contains(node) : m_nodes.contains(node))
+	{
+		markDirty(node);
+	}
+}
+
+void DialogValidator::nodesConnected(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	if (isPhase(parent) || isPhase(child))
+	{
+		return;
+	}
+
+	ensureNode(parent);
+	ensureNode(child);
+
+	addEdge(parent, child);
+
+	for (const AbstractDialogNode* node : { parent, child })
+	{
+		uncount(node);
+		count(node);
+		markDirty(node);
+	}
+}
+
+void DialogValidator::nodesDisconnected(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	if (m_nodes.contains(parent) && m_nodes.contains(child))
+	{
+		removeEdge(parent, child);
+	}
+
+	for (const AbstractDialogNode* node : { parent, child })
+	{
+		if (!m_nodes.contains(node))
+		{
+			continue;
+		}
+
+		uncount(node);
+		count(node);
+		markDirty(node);
+	}
+}
+
+void DialogValidator::nodeAddedToPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase)
+{
+	ensureNode(node);
+	ensurePhase(phase);
+	setPhase(node, phase);
+}
+
+void DialogValidator::nodeRemovedFromPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase)
+{
+	if (m_nodes.contains(node) && m_nodes[node].phase == phase)
+	{
+		setPhase(node, nullptr);
+	}
+}
+
+template <typename Container>
+QList<const AbstractDialogNode*> DialogValidator::ordered(const Container& nodes) const
+{
+	QList<const AbstractDialogNode*> result;
+	result.reserve(nodes.size());
+	std::copy(nodes.begin(), nodes.end(), std::back_inserter(result));
+
+	std::sort(result.begin(), result.end(), [this](const AbstractDialogNode* left, const AbstractDialogNode* right)
+	{
+		return m_order.value(left) < m_order.value(right);
+	});
+	return result;
+}
+
+QList<DialogValidator::Violation> DialogValidator::violations()
+{
+	for (const AbstractDialogNode* node : m_dirty)
+	{
+		QString error;
+		if (node->validate(error))
+		{
+			m_errors.remove(node);
+		}
+		else
+		{
+			m_errors.insert(node, error);
+		}
+	}
+	m_dirty.clear();
+
+	QList<Violation> result;
+
+	dialogViolations(result);
+
+	if (m_nodes.isEmpty() && m_phases.isEmpty())
+	{
+		result.append({ "Диалог не может быть пустым", nullptr });
+		return result;
+	}
+
+	if (m_roots > 1)
+	{
+		result.append({ "Должен быть только 1 узел без входящих стрелок (" + QString::number(m_roots) + ")", nullptr });
+	}
+
+	const bool easy = m_dialog && m_dialog->difficulty == Dialog::Difficulty::Easy;
+
+	if (easy && m_leafs > 1)
+	{
+		result.append({ "Должен быть только 1 узел без выходящих стрелок (" + QString::number(m_leafs) + ")", nullptr });
+	}
+
+	if (easy && m_multipleLinks > 0)
+	{
+		result.append({ "Каждый узел должен иметь не больше 1 входящей и 1 выходящей стрелки", nullptr });
+	}
+
+	for (const AbstractDialogNode* node : ordered(m_errors.keys()))
+	{
+		result.append({ "Каждый узел должен быть заполнен корректно (" + m_errors.value(node) + ")", node });
+	}
+
+	for (const AbstractDialogNode* phase : ordered(m_phases.keys()))
+	{
+		if (m_phases.constFind(phase)->nodes.isEmpty())
+		{
+			result.append({ "Фазы не могут быть пустыми", phase });
+		}
+	}
+
+	for (const AbstractDialogNode* node : ordered(m_outsidePhases))
+	{
+		result.append({ "Каждый узел должен находиться в какой-либо фазе", node });
+	}
+
+	for (const AbstractDialogNode* phase : ordered(m_branchingPhases))
+	{
+		result.append({ "Ветвление по фазам недопустимо (" + phase->as<PhaseNode>()->name() + ")", phase });
+	}
+
+	if (!m_phases.isEmpty() && m_phaseRoots == 0)
+	{
+		result.append({ "Ни одна фаза не содержит узла без входящих стрелок", nullptr });
+	}
+
+	return result;
+}
+
+bool DialogValidator::isValid()
+{
+	return violations().isEmpty();
+}
+
+DialogValidator::NodeState& DialogValidator::ensureNode(const AbstractDialogNode* node)
+{
+	auto it = m_nodes.find(node);
+	if (it == m_nodes.end())
+	{
+		it = m_nodes.insert(node, NodeState());
+		m_nodeById.insert(node->id(), node);
+		m_order.insert(node, m_nextOrder++);
+		count(node);
+		markDirty(node);
+	}
+
+	return *it;
+}
+
+DialogValidator::PhaseState& DialogValidator::ensurePhase(const AbstractDialogNode* phase)
+{
+	auto it = m_phases.find(phase);
+	if (it == m_phases.end())
+	{
+		it = m_phases.insert(phase, PhaseState());
+		m_nodeById.insert(phase->id(), phase);
+		m_order.insert(phase, m_nextOrder++);
+	}
+
+	return *it;
+}
+
+void DialogValidator::uncount(const AbstractDialogNode* node)
+{
+	NodeState& state = m_nodes[node];
+	if (!state.counted)
+	{
+		return;
+	}
+
+	m_roots -= state.root;
+	m_leafs -= state.leaf;
+	m_multipleLinks -= state.multipleLinks;
+
+	if (!state.phase)
+	{
+		m_outsidePhases.remove(node);
+	}
+	else if (state.root)
+	{
+		--m_phaseRoots;
+	}
+
+	state.counted = false;
+}
+
+void DialogValidator::count(const AbstractDialogNode* node)
+{
+	NodeState& state = m_nodes[node];
+	Q_ASSERT(!state.counted);
+
+	state.root = node->parentNodes().isEmpty();
+	state.leaf = node->childNodes().isEmpty();
+	state.multipleLinks = node->parentNodes().size() > 1 || node->childNodes().size() > 1;
+
+	m_roots += state.root;
+	m_leafs += state.leaf;
+	m_multipleLinks += state.multipleLinks;
+
+	if (!state.phase)
+	{
+		m_outsidePhases.insert(node);
+	}
+	else if (state.root)
+	{
+		++m_phaseRoots;
+	}
+
+	state.counted = true;
+}
+
+void DialogValidator::addEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	NodeState& parentState = m_nodes[parent];
+	if (parentState.children.contains(child))
+	{
+		return;
+	}
+
+	parentState.children.insert(child);
+	m_nodes[child].parents.insert(parent);
+
+	changeEdgePhases(parent, child, 1);
+}
+
+void DialogValidator::removeEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	NodeState& parentState = m_nodes[parent];
+	if (!parentState.children.contains(child))
+	{
+		return;
+	}
+
+	changeEdgePhases(parent, child, -1);
+
+	parentState.children.remove(child);
+	m_nodes[child].parents.remove(parent);
+}
+
+void DialogValidator::changeEdgePhases(const AbstractDialogNode* parent, const AbstractDialogNode* child, int delta)
+{
+	const AbstractDialogNode* parentPhase = m_nodes[parent].phase;
+	const AbstractDialogNode* childPhase = m_nodes[child].phase;
+	if (!parentPhase || !childPhase || parentPhase == childPhase)
+	{
+		return;
+	}
+
+	QHash<const AbstractDialogNode*, int>& nextPhases = m_phases[parentPhase].nextPhases;
+
+	int& links = nextPhases[childPhase];
+	links += delta;
+	Q_ASSERT(links >= 0);
+	if (links == 0)
+	{
+		nextPhases.remove(childPhase);
+	}
+
+	if (nextPhases.size() > 1)
+	{
+		m_branchingPhases.insert(parentPhase);
+	}
+	else
+	{
+		m_branchingPhases.remove(parentPhase);
+	}
+}
+
+void DialogValidator::setPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase)
+{
+	if (m_nodes[node].phase == phase)
+	{
+		return;
+	}
+
+	const NodeState links = m_nodes[node];
+	for (const AbstractDialogNode* child : links.children)
+	{
+		changeEdgePhases(node, child, -1);
+	}
+	for (const AbstractDialogNode* parent : links.parents)
+	{
+		changeEdgePhases(parent, node, -1);
+	}
+
+	uncount(node);
+
+	NodeState& state = m_nodes[node];
+	if (state.phase)
+	{
+		m_phases[state.phase].nodes.remove(node);
+		markDirty(state.phase);
+	}
+
+	state.phase = phase;
+
+	if (phase)
+	{
+		ensurePhase(phase).nodes.insert(node);
+	}
+
+	count(node);
+
+	for (const AbstractDialogNode* child : links.children)
+	{
+		changeEdgePhases(node, child, 1);
+	}
+	for (const AbstractDialogNode* parent : links.parents)
+	{
+		changeEdgePhases(parent, node, 1);
+	}
+
+	markDirty(node);
+}
+
+void DialogValidator::markDirty(const AbstractDialogNode* node)
+{
+	m_dirty.insert(node);
+
+	if (!isPhase(node))
+	{
+		const AbstractDialogNode* phase = m_nodes.value(node).phase;
+		if (phase)
+		{
+			m_dirty.insert(phase);
+		}
+	}
+}
+
+void DialogValidator::dialogViolations(QList<Violation>& result) const
+{
+	if (!m_dialog)
+	{
+		return;
+	}
+
+	if (m_dialog->name.trimmed().isEmpty())
+	{
+		result.append({ "Имя диалога не может быть пустым", nullptr });
+	}
+
+	if (m_dialog->groups.isEmpty())
+	{
+		result.append({ "Нужно выбрать хотя бы одну группу", nullptr });
+	}
+
+	const ErrorReplica& errorReplica = m_dialog->errorReplica;
+	if (errorReplica.errorReplica && (*errorReplica.errorReplica).trimmed().isEmpty())
+	{
+		result.append({ "Ошибочная реплика не может быть пустой", nullptr });
+	}
+
+	if (errorReplica.errorPenalty && (*errorReplica.errorPenalty) < 0.0)
+	{
+		result.append({ "Количество штрафных баллов должно быть больше или равно 0", nullptr });
+	}
+
+	if (errorReplica.finishingReplica && (*errorReplica.finishingReplica).trimmed().isEmpty())
+	{
+		result.append({ "Завершающая реплика не может быть пустой", nullptr });
+	}
+
+	if (errorReplica.finishingExpectedWords && (*errorReplica.finishingExpectedWords).isEmpty())
+	{
+		result.append({ "Завершающие опорные слова не могут быть пустыми", nullptr });
+	}
+}
+
+}
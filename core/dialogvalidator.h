@@ -0,0 +1,106 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QHash>
+#include <QSet>
+
+namespace Core
+{
+
+// Keeps dialog validation results up to date between edits.
+// Every change of the graph must be reported through the notification methods (after the change is applied),
+// then violations() re-checks only the nodes and phases affected since the previous call.
+class DialogValidator
+{
+public:
+	struct Violation
+	{
+		QString message;
+		// nullptr for violations of the whole dialog
+		const AbstractDialogNode* node;
+	};
+
+	DialogValidator();
+
+	// Checks the whole dialog at once, doesn't check uniqueness of the dialog name
+	static QList<Violation> validate(const Dialog& dialog);
+
+	void setDialog(const Dialog* dialog);
+	void clear();
+
+	void addNode(const AbstractDialogNode* node);
+	void removeNode(const AbstractDialogNode* node);
+	void nodeChanged(const AbstractDialogNode* node);
+
+	void nodesConnected(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+	void nodesDisconnected(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+
+	void nodeAddedToPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase);
+	void nodeRemovedFromPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase);
+
+	QList<Violation> violations();
+	bool isValid();
+
+private:
+	struct NodeState
+	{
+		const AbstractDialogNode* phase { nullptr };
+		QSet<const AbstractDialogNode*> parents;
+		QSet<const AbstractDialogNode*> children;
+
+		// contribution to the counters below, kept to be able to revert it
+		bool counted { false };
+		bool root { false };
+		bool leaf { false };
+		bool multipleLinks { false };
+	};
+
+	struct PhaseState
+	{
+		QSet<const AbstractDialogNode*> nodes;
+		// number of links to the nodes of every next phase
+		QHash<const AbstractDialogNode*, int> nextPhases;
+	};
+
+	NodeState& ensureNode(const AbstractDialogNode* node);
+	PhaseState& ensurePhase(const AbstractDialogNode* phase);
+
+	void uncount(const AbstractDialogNode* node);
+	void count(const AbstractDialogNode* node);
+
+	void addEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+	void removeEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+	void changeEdgePhases(const AbstractDialogNode* parent, const AbstractDialogNode* child, int delta);
+
+	void setPhase(const AbstractDialogNode* node, const AbstractDialogNode* phase);
+	void markDirty(const AbstractDialogNode* node);
+
+	// The nodes in the order they were added, so the violations don't depend on their addresses
+	template <typename Container>
+	QList<const AbstractDialogNode*> ordered(const Container& nodes) const;
+
+	void dialogViolations(QList<Violation>& result) const;
+
+private:
+	const Dialog* m_dialog;
+
+	QHash<const AbstractDialogNode*, NodeState> m_nodes;
+	QHash<const AbstractDialogNode*, PhaseState> m_phases;
+	QHash<AbstractDialogNode::Id, const AbstractDialogNode*> m_nodeById;
+	// position of every node and phase in the order they were added
+	QHash<const AbstractDialogNode*, int> m_order;
+	int m_nextOrder;
+
+	QSet<const AbstractDialogNode*> m_dirty;
+	QHash<const AbstractDialogNode*, QString> m_errors;
+
+	int m_roots;
+	int m_phaseRoots;
+	int m_leafs;
+	int m_multipleLinks;
+	QSet<const AbstractDialogNode*> m_outsidePhases;
+	QSet<const AbstractDialogNode*> m_branchingPhases;
+};
+
+}
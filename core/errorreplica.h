@@ -1,6 +1,7 @@
 #pragma once
 
 #include "optional.h"
+#include "hashcombine.h"
 
 #include <QString>
 #include <QList>
@@ -39,6 +40,16 @@ inline bool operator!=(const ErrorReplica& left, const ErrorReplica& right)
 	return !(left == right);
 }
 
+inline uint qHash(const ErrorReplica& replica, uint seed = 0)
+{
+	size_t result = seed;
+	hashCombine(result, replica.errorReplica);
+	hashCombine(result, replica.errorPenalty);
+	hashCombine(result, replica.finishingExpectedWords);
+	hashCombine(result, replica.finishingReplica);
+	return static_cast<uint>(result);
+}
+
 }
 
 Q_DECLARE_METATYPE(Core::ErrorReplica)
@@ -0,0 +1,255 @@
+#include "expectedwordsindex.h"
+#include "textnormalizer.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+typedef QHash<QString, QVector<ExpectedWordsIndex::Entry>> Index;
+
+void removeEntries(Index& index, const QString& key, const QString& client, const QString& dialog)
+{
+	const auto it = index.find(key);
+	if (it == index.end())
+	{
+		return;
+	}
+
+	QVector<ExpectedWordsIndex::Entry>& entries = *it;
+	entries.erase(std::remove_if(entries.begin(), entries.end(),
+		[&client, &dialog](const ExpectedWordsIndex::Entry& entry) { return entry.client == client && entry.dialog == dialog; }),
+		entries.end());
+
+	if (entries.isEmpty())
+	{
+		index.erase(it);
+	}
+}
+
+QSet<QString> tokens(const QString& phrase)
+{
+	return phrase.split(' ').toSet();
+}
+
+}
+
+void ExpectedWordsIndex::setDialogs(const Dialogs& dialogs)
+{
+	QSet<DialogKey> keys;
+
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		for (const Dialog& dialog : it.value())
+		{
+			const DialogKey key(it.key(), dialog.printableName());
+			keys.insert(key);
+
+			const size_t hash = dialog.hash();
+			const auto hashIt = m_hashes.constFind(key);
+			if (hashIt != m_hashes.constEnd() && *hashIt == hash)
+			{
+				continue;
+			}
+
+			removeDialog(key);
+			addDialog(it.key(), dialog);
+			m_hashes.insert(key, hash);
+		}
+	}
+
+	for (const DialogKey& key : m_hashes.keys())
+	{
+		if (!keys.contains(key))
+		{
+			removeDialog(key);
+		}
+	}
+}
+
+QVector<ExpectedWordsIndex::Entry> ExpectedWordsIndex::find(const QString& text) const
+{
+	const QString phrase = TextNormalizer::normalize(text);
+	if (phrase.isEmpty())
+	{
+		return {};
+	}
+
+	// the rarest word gives the fewest candidates to check
+	const QVector<Entry>* candidates = nullptr;
+	for (const QString& token : tokens(phrase))
+	{
+		const auto it = m_byToken.constFind(token);
+		if (it == m_byToken.constEnd())
+		{
+			return {};
+		}
+
+		if (!candidates || it->size() < candidates->size())
+		{
+			candidates = &*it;
+		}
+	}
+
+	QVector<Entry> result;
+	const QString paddedPhrase = ' ' + phrase + ' ';
+	for (const Entry& entry : *candidates)
+	{
+		if ((' ' + entry.phrase + ' ').contains(paddedPhrase))
+		{
+			result.append(entry);
+		}
+	}
+
+	return result;
+}
+
+QList<ExpectedWordsIndex::Conflict> ExpectedWordsIndex::conflicts(const QString& client) const
+{
+	return forbiddenSiblingConflicts(client) + phraseConflicts(client);
+}
+
+void ExpectedWordsIndex::addDialog(const QString& client, const Dialog& dialog)
+{
+	const QString dialogName = dialog.printableName();
+	QVector<Entry>& entries = m_entries[DialogKey(client, dialogName)];
+
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (!expectedWordsNode)
+			{
+				continue;
+			}
+
+			for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+			{
+				const QString phrase = TextNormalizer::normalize(words.words);
+				if (phrase.isEmpty())
+				{
+					continue;
+				}
+
+				const Entry entry { client, dialogName, phase.id(), phase.name(), node->id(), node->parentNodes(),
+					words.words, phrase, words.score, expectedWordsNode->forbidden() };
+
+				entries.append(entry);
+				m_byPhrase[phrase].append(entry);
+				for (const QString& token : tokens(phrase))
+				{
+					m_byToken[token].append(entry);
+				}
+			}
+		}
+	}
+}
+
+void ExpectedWordsIndex::removeDialog(const DialogKey& key)
+{
+	m_hashes.remove(key);
+
+	for (const Entry& entry : m_entries.take(key))
+	{
+		removeEntries(m_byPhrase, entry.phrase, key.first, key.second);
+		for (const QString& token : tokens(entry.phrase))
+		{
+			removeEntries(m_byToken, token, key.first, key.second);
+		}
+	}
+}
+
+QList<ExpectedWordsIndex::Conflict> ExpectedWordsIndex::forbiddenSiblingConflicts(const QString& client) const
+{
+	QList<Conflict> result;
+
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		if (!client.isEmpty() && it.key().first != client)
+		{
+			continue;
+		}
+
+		for (const Entry& forbidden : it.value())
+		{
+			if (!forbidden.forbidden)
+			{
+				continue;
+			}
+
+			// expected words containing the forbidden ones contain their first word too
+			const QString paddedPhrase = ' ' + forbidden.phrase + ' ';
+			for (const Entry& expected : m_byToken.value(forbidden.phrase.section(' ', 0, 0)))
+			{
+				if (expected.forbidden || expected.client != forbidden.client || expected.dialog != forbidden.dialog ||
+					!expected.parents.intersects(forbidden.parents))
+				{
+					continue;
+				}
+
+				if ((' ' + expected.phrase + ' ').contains(paddedPhrase))
+				{
+					result.append({ Conflict::Type::ForbiddenSibling, forbidden.phrase, { expected, forbidden } });
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+QList<ExpectedWordsIndex::Conflict> ExpectedWordsIndex::phraseConflicts(const QString& client) const
+{
+	QList<Conflict> result;
+
+	for (auto it = m_byPhrase.begin(); it != m_byPhrase.end(); ++it)
+	{
+		if (it->size() < 2)
+		{
+			continue;
+		}
+
+		QVector<Entry> entries;
+		for (const Entry& entry : it.value())
+		{
+			if (!entry.forbidden && (client.isEmpty() || entry.client == client))
+			{
+				entries.append(entry);
+			}
+		}
+
+		if (entries.size() < 2)
+		{
+			continue;
+		}
+
+		const double score = entries.first().score;
+		if (std::any_of(entries.begin(), entries.end(), [score](const Entry& entry) { return entry.score != score; }))
+		{
+			result.append({ Conflict::Type::DifferentScores, it.key(), entries });
+		}
+
+		QHash<DialogKey, QVector<Entry>> entriesByDialog;
+		for (const Entry& entry : entries)
+		{
+			entriesByDialog[DialogKey(entry.client, entry.dialog)].append(entry);
+		}
+
+		for (const QVector<Entry>& dialogEntries : entriesByDialog)
+		{
+			const AbstractDialogNode::Id& phase = dialogEntries.first().phase;
+			if (std::any_of(dialogEntries.begin(), dialogEntries.end(), [&phase](const Entry& entry) { return entry.phase != phase; }))
+			{
+				result.append({ Conflict::Type::DuplicateInPhases, it.key(), dialogEntries });
+			}
+		}
+	}
+
+	return result;
+}
+
+}
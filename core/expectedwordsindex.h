@@ -0,0 +1,80 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+
+namespace Core
+{
+
+// Inverted index of the expected words of all dialogs of all clients: normalized words (see TextNormalizer)
+// to the nodes expecting them. setDialogs() reindexes only dialogs whose hash has changed,
+// so it can be called with the whole model after every reload.
+class ExpectedWordsIndex
+{
+public:
+	typedef QMap<QString, QList<Dialog>> Dialogs;
+
+	struct Entry
+	{
+		// database name of the client
+		QString client;
+		// printable name of the dialog
+		QString dialog;
+		AbstractDialogNode::Id phase;
+		QString phaseName;
+		AbstractDialogNode::Id node;
+		QSet<AbstractDialogNode::Id> parents;
+		QString words;
+		// normalized words
+		QString phrase;
+		double score;
+		bool forbidden;
+	};
+
+	struct Conflict
+	{
+		enum class Type
+		{
+			// words of a forbidden node are a part of expected words of a node with the same parent,
+			// so the expected answer is also a forbidden one
+			ForbiddenSibling,
+			// the same expected words in different phases of a dialog
+			DuplicateInPhases,
+			// the same expected words with different scores
+			DifferentScores
+		};
+
+		Type type;
+		QString phrase;
+		QVector<Entry> entries;
+	};
+
+	void setDialogs(const Dialogs& dialogs);
+
+	// Entries containing all words of the text in the same order
+	QVector<Entry> find(const QString& text) const;
+
+	// Conflicts between dialogs of the client, of all clients if it's empty
+	QList<Conflict> conflicts(const QString& client = QString()) const;
+
+private:
+	typedef QPair<QString, QString> DialogKey;
+
+	void addDialog(const QString& client, const Dialog& dialog);
+	void removeDialog(const DialogKey& key);
+
+	QList<Conflict> forbiddenSiblingConflicts(const QString& client) const;
+	QList<Conflict> phraseConflicts(const QString& client) const;
+
+private:
+	QHash<DialogKey, size_t> m_hashes;
+	QHash<DialogKey, QVector<Entry>> m_entries;
+	QHash<QString, QVector<Entry>> m_byPhrase;
+	QHash<QString, QVector<Entry>> m_byToken;
+};
+
+}
@@ -0,0 +1,261 @@
+#include "expectedwordsmatcher.h"
+#include "textnormalizer.h"
+#include "hashcombine.h"
+
+#include <QMultiHash>
+#include <QMutex>
+
+#include <algorithm>
+#include <functional>
+
+namespace Core
+{
+
+namespace
+{
+
+void addFinishingWords(const ErrorReplica& errorReplica, const std::function<void(const QString&)>& add)
+{
+	if (!errorReplica.finishingExpectedWords)
+	{
+		return;
+	}
+
+	for (const QString& words : *errorReplica.finishingExpectedWords)
+	{
+		add(words);
+	}
+}
+
+}
+
+ExpectedWordsMatcher::ExpectedWordsMatcher(const Dialog& dialog)
+	: ExpectedWordsMatcher(sources(dialog))
+{
+}
+
+ExpectedWordsMatcher::ExpectedWordsMatcher(const QVector<Source>& sources)
+	: m_sources(sources)
+{
+	m_states.append({ {}, 0, -1, {} });
+
+	for (const Source& source : m_sources)
+	{
+		addPattern(source.node, source.words, source.score);
+	}
+
+	build();
+}
+
+std::shared_ptr<const ExpectedWordsMatcher> ExpectedWordsMatcher::compiled(const Dialog& dialog)
+{
+	// few dialogs are simulated at once, the cache is dropped instead of tracking usage
+	static const int s_maxCacheSize = 64;
+	static QMultiHash<size_t, std::shared_ptr<const ExpectedWordsMatcher>> s_cache;
+	static QMutex s_cacheMutex;
+
+	// the automaton depends only on the phrases, so dialogs differing in other fields share it
+	const QVector<Source> dialogSources = sources(dialog);
+	const size_t sourcesHash = hash(dialogSources);
+
+	{
+		QMutexLocker locker(&s_cacheMutex);
+		for (auto it = s_cache.constFind(sourcesHash); it != s_cache.constEnd() && it.key() == sourcesHash; ++it)
+		{
+			if ((*it)->m_sources == dialogSources)
+			{
+				return *it;
+			}
+		}
+	}
+
+	std::shared_ptr<const ExpectedWordsMatcher> matcher(new ExpectedWordsMatcher(dialogSources));
+
+	QMutexLocker locker(&s_cacheMutex);
+	if (s_cache.size() >= s_maxCacheSize)
+	{
+		s_cache.clear();
+	}
+	s_cache.insert(sourcesHash, matcher);
+	return matcher;
+}
+
+QString ExpectedWordsMatcher::normalize(const QString& text)
+{
+	// spaces around make phrases match only whole words
+	const QString words = TextNormalizer::normalize(text);
+	return words.isEmpty() ? words : ' ' + words + ' ';
+}
+
+const QVector<ExpectedWordsMatcher::Pattern>& ExpectedWordsMatcher::patterns() const
+{
+	return m_patterns;
+}
+
+QVector<ExpectedWordsMatcher::Hit> ExpectedWordsMatcher::match(const QString& normalizedAnswer) const
+{
+	QVector<Hit> result;
+
+	int state = 0;
+	for (int i = 0; i < normalizedAnswer.size(); ++i)
+	{
+		const QChar c = normalizedAnswer[i];
+
+		while (state != 0 && !m_states[state].next.contains(c))
+		{
+			state = m_states[state].fail;
+		}
+		state = m_states[state].next.value(c, 0);
+
+		for (int output = m_states[state].patterns.isEmpty() ? m_states[state].output : state; output >= 0; output = m_states[output].output)
+		{
+			for (int pattern : m_states[output].patterns)
+			{
+				result.append({ pattern, i, 0 });
+			}
+		}
+	}
+
+	return result;
+}
+
+QVector<ExpectedWordsMatcher::Hit> ExpectedWordsMatcher::match(const QString& normalizedAnswer, int maxTypos) const
+{
+	QVector<Hit> result = match(normalizedAnswer);
+	if (maxTypos <= 0)
+	{
+		return result;
+	}
+
+	QVector<bool> found(m_patterns.size(), false);
+	for (const Hit& hit : result)
+	{
+		found[hit.pattern] = true;
+	}
+
+	for (int pattern = 0; pattern < m_patterns.size(); ++pattern)
+	{
+		const int allowedTypos = std::min(maxTypos, m_patterns[pattern].words.size() / TypoLength);
+		if (found[pattern] || allowedTypos == 0)
+		{
+			continue;
+		}
+
+		int end = -1;
+		const int distance = m_fuzzyMatchers[pattern].distance(normalizedAnswer, allowedTypos, &end);
+		if (distance >= 0)
+		{
+			result.append({ pattern, end, distance });
+		}
+	}
+
+	return result;
+}
+
+bool ExpectedWordsMatcher::Source::operator==(const Source& other) const
+{
+	return node == other.node && words == other.words && score == other.score;
+}
+
+QVector<ExpectedWordsMatcher::Source> ExpectedWordsMatcher::sources(const Dialog& dialog)
+{
+	QVector<Source> result;
+
+	addFinishingWords(dialog.errorReplica, [&result](const QString& words) { result.append({ {}, words, 0.0 }); });
+
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		addFinishingWords(phase.errorReplica(), [&result, &phase](const QString& words) { result.append({ phase.id(), words, 0.0 }); });
+
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+			if (!expectedWordsNode)
+			{
+				continue;
+			}
+
+			for (const ExpectedWords& words : expectedWordsNode->expectedWords())
+			{
+				result.append({ node->id(), words.words, words.score });
+			}
+		}
+	}
+
+	return result;
+}
+
+size_t ExpectedWordsMatcher::hash(const QVector<Source>& sources)
+{
+	size_t result = 0;
+	for (const Source& source : sources)
+	{
+		hashCombine(result, source.node);
+		hashCombine(result, source.words);
+		hashCombine(result, source.score);
+	}
+	return result;
+}
+
+void ExpectedWordsMatcher::addPattern(const AbstractDialogNode::Id& node, const QString& words, double score)
+{
+	const QString phrase = normalize(words);
+	if (phrase.isEmpty())
+	{
+		return;
+	}
+
+	int state = 0;
+	for (const QChar c : phrase)
+	{
+		const int next = m_states[state].next.value(c, -1);
+		if (next >= 0)
+		{
+			state = next;
+			continue;
+		}
+
+		m_states.append({ {}, 0, -1, {} });
+		m_states[state].next.insert(c, m_states.size() - 1);
+		state = m_states.size() - 1;
+	}
+
+	m_states[state].patterns.append(m_patterns.size());
+	m_patterns.append({ node, phrase.trimmed(), score });
+	m_fuzzyMatchers.append(FuzzyMatcher(phrase));
+}
+
+void ExpectedWordsMatcher::build()
+{
+	// breadth first, so fail links always point to already processed states
+	QVector<int> queue;
+	for (int child : m_states[0].next)
+	{
+		queue.append(child);
+	}
+
+	for (int i = 0; i < queue.size(); ++i)
+	{
+		const int state = queue[i];
+
+		for (auto it = m_states[state].next.constBegin(); it != m_states[state].next.constEnd(); ++it)
+		{
+			const QChar c = it.key();
+			const int child = it.value();
+
+			int fail = m_states[state].fail;
+			while (fail != 0 && !m_states[fail].next.contains(c))
+			{
+				fail = m_states[fail].fail;
+			}
+			fail = m_states[fail].next.value(c, 0);
+
+			m_states[child].fail = fail;
+			m_states[child].output = m_states[fail].patterns.isEmpty() ? m_states[fail].output : fail;
+
+			queue.append(child);
+		}
+	}
+}
+
+}
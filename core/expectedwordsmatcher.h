@@ -0,0 +1,89 @@
+#pragma once
+
+#include "dialog.h"
+#include "fuzzymatcher.h"
+
+#include <QVector>
+#include <memory>
+
+namespace Core
+{
+
+// Aho-Corasick automaton over all expected words of a dialog, including the finishing expected words
+// of the dialog and phase error replicas. A single pass over an answer reports every phrase found in it.
+// Phrases and answers are compared after normalize(), so different forms of the same words match
+// and a phrase matches only whole words of an answer.
+class ExpectedWordsMatcher
+{
+public:
+	struct Pattern
+	{
+		// id of ExpectedWordsNode, id of PhaseNode for finishing words of a phase, empty for finishing words of the dialog.
+		// Ids are used instead of pointers because the automaton is shared between copies of the dialog
+		AbstractDialogNode::Id node;
+		// normalized words of the phrase
+		QString words;
+		double score;
+	};
+
+	struct Hit
+	{
+		int pattern;
+		// position of the last matched character in the answer
+		int end;
+		// number of typos, 0 for exact matches
+		int distance;
+	};
+
+	explicit ExpectedWordsMatcher(const Dialog& dialog);
+
+	// Shares compiled automatons between dialogs with the same expected words and finishing words
+	static std::shared_ptr<const ExpectedWordsMatcher> compiled(const Dialog& dialog);
+
+	// Stems of the words separated and surrounded by spaces, see TextNormalizer
+	static QString normalize(const QString& text);
+
+	const QVector<Pattern>& patterns() const;
+	QVector<Hit> match(const QString& normalizedAnswer) const;
+	// Also reports phrases found with at most maxTypos edits, but no more than one typo per TypoLength characters,
+	// so short words must be typed exactly. Phrases found exactly are not searched approximately
+	QVector<Hit> match(const QString& normalizedAnswer, int maxTypos) const;
+
+	static const int TypoLength = 4;
+
+private:
+	// A phrase as it is written in the dialog, the cache compares them to find the same automaton
+	struct Source
+	{
+		AbstractDialogNode::Id node;
+		QString words;
+		double score;
+
+		bool operator==(const Source& other) const;
+	};
+
+	explicit ExpectedWordsMatcher(const QVector<Source>& sources);
+
+	static QVector<Source> sources(const Dialog& dialog);
+	static size_t hash(const QVector<Source>& sources);
+
+	void addPattern(const AbstractDialogNode::Id& node, const QString& words, double score);
+	void build();
+
+private:
+	struct State
+	{
+		QHash<QChar, int> next;
+		int fail;
+		// nearest state by fail links which ends some patterns, -1 if none
+		int output;
+		QVector<int> patterns;
+	};
+
+	QVector<Source> m_sources;
+	QVector<Pattern> m_patterns;
+	QVector<FuzzyMatcher> m_fuzzyMatchers;
+	QVector<State> m_states;
+};
+
+}
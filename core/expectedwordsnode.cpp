@@ -1,5 +1,6 @@
 #include "expectedwordsnode.h"
 #include "hashcombine.h"
+#include "memoryusage.h"
 
 namespace Core
 {
@@ -75,6 +76,7 @@ const QList<ExpectedWords>& ExpectedWordsNode::expectedWords() const
 void ExpectedWordsNode::setExpectedWords(const QList<ExpectedWords>& expectedWords)
 {
 	m_expectedWords = expectedWords;
+	invalidateHash();
 }
 
 int ExpectedWordsNode::minScore() const
@@ -85,6 +87,7 @@ int ExpectedWordsNode::minScore() const
 void ExpectedWordsNode::setMinScore(int score)
 {
 	m_minScore = score;
+	invalidateHash();
 }
 
 bool ExpectedWordsNode::customHint() const
@@ -95,6 +98,7 @@ bool ExpectedWordsNode::customHint() const
 void ExpectedWordsNode::setCustomHint(bool customHint)
 {
 	m_customHint = customHint;
+	invalidateHash();
 }
 
 const QString& ExpectedWordsNode::hint() const
@@ -105,6 +109,7 @@ const QString& ExpectedWordsNode::hint() const
 void ExpectedWordsNode::setHint(const QString& hint)
 {
 	m_hint = hint;
+	invalidateHash();
 }
 
 bool ExpectedWordsNode::forbidden() const
@@ -181,6 +186,25 @@ size_t ExpectedWordsNode::calculateHash() const
 	return seed;
 }
 
+size_t ExpectedWordsNode::objectSize() const
+{
+	return sizeof(*this);
+}
+
+void ExpectedWordsNode::accountData(MemoryCounter& counter) const
+{
+	// ExpectedWords is a large type, QList keeps every item in its own allocation
+	if (!m_expectedWords.isEmpty() && counter.addContainer(&m_expectedWords.first(), m_expectedWords.size(), sizeof(void*) + sizeof(ExpectedWords)))
+	{
+		for (const ExpectedWords& words : m_expectedWords)
+		{
+			counter.addString(words.words);
+		}
+	}
+
+	counter.addString(m_hint);
+}
+
 bool operator==(const ExpectedWordsNode& left, const ExpectedWordsNode& right)
 {
 	return left.expectedWords() == right.expectedWords()
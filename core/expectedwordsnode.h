@@ -55,6 +55,8 @@ private:
 	virtual AbstractDialogNode* shallowCopy() const override;
 	virtual bool compareData(AbstractDialogNode* other) const override;
 	virtual size_t calculateHash() const override;
+	virtual size_t objectSize() const override;
+	virtual void accountData(MemoryCounter& counter) const override;
 
 private:
 	QList<ExpectedWords> m_expectedWords;
@@ -0,0 +1,160 @@
+#include "fuzzymatcher.h"
+
+#include <QVector>
+
+#include <algorithm>
+
+namespace Core
+{
+
+FuzzyMatcher::FuzzyMatcher(const QString& phrase, bool transpositions)
+	: m_phrase(phrase)
+	, m_transpositions(transpositions)
+{
+	if (m_phrase.size() > MaxBitParallelLength)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_phrase.size(); ++i)
+	{
+		m_masks[m_phrase[i]] |= quint64(1) << i;
+	}
+}
+
+const QString& FuzzyMatcher::phrase() const
+{
+	return m_phrase;
+}
+
+int FuzzyMatcher::distance(const QString& text, int maxDistance, int* end) const
+{
+	int matchEnd = -1;
+	int result = -1;
+
+	// deleting the whole phrase is always possible, the search finds better alignments in a non empty text
+	if (m_phrase.isEmpty() || text.isEmpty())
+	{
+		result = m_phrase.size() <= maxDistance ? m_phrase.size() : -1;
+	}
+	// even the best alignment needs to insert the missing characters
+	else if (maxDistance >= 0 && text.size() >= m_phrase.size() - maxDistance)
+	{
+		result = m_phrase.size() <= MaxBitParallelLength ? bitParallelDistance(text, maxDistance, matchEnd) : dynamicDistance(text, maxDistance, matchEnd);
+	}
+
+	if (end)
+	{
+		*end = matchEnd;
+	}
+
+	return result;
+}
+
+int FuzzyMatcher::bitParallelDistance(const QString& text, int maxDistance, int& end) const
+{
+	const int length = m_phrase.size();
+	const quint64 all = length == 64 ? ~quint64(0) : (quint64(1) << length) - 1;
+	const quint64 last = quint64(1) << (length - 1);
+
+	// vertical deltas of the current column of the distance matrix, positive and negative
+	quint64 positive = all;
+	quint64 negative = 0;
+	quint64 previousDiagonal = 0;
+	quint64 previousMask = 0;
+
+	int score = length;
+	int best = -1;
+
+	for (int j = 0; j < text.size(); ++j)
+	{
+		const quint64 mask = m_masks.value(text[j], 0);
+
+		quint64 diagonal = (((mask & positive) + positive) ^ positive) | mask | negative;
+		if (m_transpositions)
+		{
+			diagonal |= ((~previousDiagonal & mask) << 1) & previousMask;
+		}
+
+		quint64 horizontalPositive = negative | ~(diagonal | positive);
+		quint64 horizontalNegative = positive & diagonal;
+
+		if (horizontalPositive & last)
+		{
+			++score;
+		}
+		else if (horizontalNegative & last)
+		{
+			--score;
+		}
+
+		horizontalPositive <<= 1;
+		horizontalNegative <<= 1;
+
+		positive = (horizontalNegative | ~(diagonal | horizontalPositive)) & all;
+		negative = diagonal & horizontalPositive & all;
+
+		previousDiagonal = diagonal;
+		previousMask = mask;
+
+		if (score <= maxDistance && (best < 0 || score < best))
+		{
+			best = score;
+			end = j;
+			if (best == 0)
+			{
+				break;
+			}
+		}
+	}
+
+	return best;
+}
+
+int FuzzyMatcher::dynamicDistance(const QString& text, int maxDistance, int& end) const
+{
+	const int length = m_phrase.size();
+
+	// columns of the distance matrix for the previous two and the current characters of the text
+	QVector<int> beforePrevious(length + 1);
+	QVector<int> previous(length + 1);
+	QVector<int> current(length + 1);
+	for (int i = 0; i <= length; ++i)
+	{
+		previous[i] = i;
+	}
+
+	int best = -1;
+
+	for (int j = 0; j < text.size(); ++j)
+	{
+		current[0] = 0;
+		for (int i = 1; i <= length; ++i)
+		{
+			current[i] = std::min({ previous[i] + 1, current[i - 1] + 1, previous[i - 1] + (m_phrase[i - 1] == text[j] ? 0 : 1) });
+
+			if (m_transpositions && i > 1 && j > 0 && m_phrase[i - 1] == text[j - 1] && m_phrase[i - 2] == text[j])
+			{
+				current[i] = std::min(current[i], beforePrevious[i - 2] + 1);
+			}
+		}
+
+		const int score = current[length];
+		if (score <= maxDistance && (best < 0 || score < best))
+		{
+			best = score;
+			end = j;
+			if (best == 0)
+			{
+				break;
+			}
+		}
+
+		std::swap(beforePrevious, previous);
+		std::swap(previous, current);
+	}
+
+	return best;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+namespace Core
+{
+
+// Approximate search of a phrase in a text: the smallest edit distance between the phrase and any part of the text.
+// Insertions, deletions, substitutions and, if enabled, transpositions of adjacent characters cost one edit.
+// Phrases up to 64 characters use the bit-parallel algorithm of Myers (with the Hyyrö extension for transpositions),
+// longer ones fall back to the usual dynamic programming.
+class FuzzyMatcher
+{
+public:
+	explicit FuzzyMatcher(const QString& phrase = QString(), bool transpositions = true);
+
+	const QString& phrase() const;
+
+	// -1 if the phrase isn't found with maxDistance edits or less.
+	// end receives the position of the last character of the closest match in the text, -1 if the match is empty
+	int distance(const QString& text, int maxDistance, int* end = nullptr) const;
+
+	static const int MaxBitParallelLength = 64;
+
+private:
+	int bitParallelDistance(const QString& text, int maxDistance, int& end) const;
+	int dynamicDistance(const QString& text, int maxDistance, int& end) const;
+
+private:
+	QString m_phrase;
+	bool m_transpositions;
+	// bit i is set for every character equal to the i-th character of the phrase
+	QHash<QChar, quint64> m_masks;
+};
+
+}
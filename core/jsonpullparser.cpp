@@ -0,0 +1,655 @@
+#include "jsonpullparser.h"
+
+#include <cstring>
+
+namespace Core
+{
+
+namespace
+{
+
+// deeper documents are rejected instead of overflowing the stack in skipValue()
+const int s_maxDepth = 256;
+
+QString typeError(JsonPullParser::Type type)
+{
+	switch (type)
+	{
+	case JsonPullParser::Type::Null:
+		return "ожидалось значение null";
+	case JsonPullParser::Type::Bool:
+		return "ожидалось логическое значение";
+	case JsonPullParser::Type::Number:
+		return "ожидалось число";
+	case JsonPullParser::Type::String:
+		return "ожидалась строка";
+	case JsonPullParser::Type::Array:
+		return "ожидался массив";
+	case JsonPullParser::Type::Object:
+		return "ожидался объект";
+	case JsonPullParser::Type::Invalid:
+		break;
+	}
+
+	return "ожидалось значение";
+}
+
+bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+int hexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
+
+void appendUtf8(QByteArray& buffer, uint code)
+{
+	if (code < 0x80)
+	{
+		buffer.append(static_cast<char>(code));
+	}
+	else if (code < 0x800)
+	{
+		buffer.append(static_cast<char>(0xc0 | (code >> 6)));
+		buffer.append(static_cast<char>(0x80 | (code & 0x3f)));
+	}
+	else if (code < 0x10000)
+	{
+		buffer.append(static_cast<char>(0xe0 | (code >> 12)));
+		buffer.append(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+		buffer.append(static_cast<char>(0x80 | (code & 0x3f)));
+	}
+	else
+	{
+		buffer.append(static_cast<char>(0xf0 | (code >> 18)));
+		buffer.append(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+		buffer.append(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+		buffer.append(static_cast<char>(0x80 | (code & 0x3f)));
+	}
+}
+
+}
+
+JsonPullParser::JsonPullParser(const QByteArray& json)
+	: m_position(json.constData())
+	, m_end(json.constData() + json.size())
+{
+}
+
+JsonPullParser::Type JsonPullParser::peek()
+{
+	if (hasError())
+	{
+		return Type::Invalid;
+	}
+
+	skipWhitespace();
+	if (m_position == m_end)
+	{
+		return Type::Invalid;
+	}
+
+	switch (*m_position)
+	{
+	case '{':
+		return Type::Object;
+	case '[':
+		return Type::Array;
+	case '"':
+		return Type::String;
+	case 't':
+	case 'f':
+		return Type::Bool;
+	case 'n':
+		return Type::Null;
+	default:
+		return *m_position == '-' || isDigit(*m_position) ? Type::Number : Type::Invalid;
+	}
+}
+
+bool JsonPullParser::readString(QString& value)
+{
+	if (peek() != Type::String)
+	{
+		return fail(typeError(Type::String));
+	}
+
+	const char* data = nullptr;
+	int size = 0;
+	QByteArray storage;
+	if (!parseString(data, size, storage))
+	{
+		return false;
+	}
+
+	value = QString::fromUtf8(data, size);
+	return true;
+}
+
+bool JsonPullParser::readNumber(double& value)
+{
+	if (peek() != Type::Number)
+	{
+		return fail(typeError(Type::Number));
+	}
+
+	return parseNumber(value);
+}
+
+bool JsonPullParser::readBool(bool& value)
+{
+	if (peek() != Type::Bool)
+	{
+		return fail(typeError(Type::Bool));
+	}
+
+	value = *m_position == 't';
+	return parseLiteral(value ? "true" : "false");
+}
+
+bool JsonPullParser::skipValue()
+{
+	switch (peek())
+	{
+	case Type::Object:
+		beginObject();
+		while (nextKey())
+		{
+			skipValue();
+		}
+		return !hasError();
+
+	case Type::Array:
+		beginArray();
+		while (nextElement())
+		{
+			skipValue();
+		}
+		return !hasError();
+
+	case Type::String:
+	{
+		const char* data = nullptr;
+		int size = 0;
+		QByteArray storage;
+		return parseString(data, size, storage);
+	}
+
+	case Type::Number:
+	{
+		double value = 0.0;
+		return parseNumber(value);
+	}
+
+	case Type::Bool:
+		return parseLiteral(*m_position == 't' ? "true" : "false");
+
+	case Type::Null:
+		return parseLiteral("null");
+
+	case Type::Invalid:
+		break;
+	}
+
+	return fail(typeError(Type::Invalid));
+}
+
+bool JsonPullParser::readRaw(QByteArray& value)
+{
+	// peek() skips the whitespace before the value
+	if (peek() == Type::Invalid)
+	{
+		return fail(typeError(Type::Invalid));
+	}
+
+	const char* begin = m_position;
+	if (!skipValue())
+	{
+		return false;
+	}
+
+	value = QByteArray::fromRawData(begin, static_cast<int>(m_position - begin));
+	return true;
+}
+
+bool JsonPullParser::beginObject()
+{
+	return beginValue('{', Type::Object);
+}
+
+bool JsonPullParser::nextKey()
+{
+	if (hasError())
+	{
+		return false;
+	}
+
+	Q_ASSERT(!m_frames.isEmpty() && m_frames.last().object);
+	Frame& frame = m_frames.last();
+
+	skipWhitespace();
+	if (consume('}'))
+	{
+		m_frames.removeLast();
+		return false;
+	}
+
+	if (!frame.first)
+	{
+		if (!consume(','))
+		{
+			return fail("ожидалась запятая или }");
+		}
+
+		skipWhitespace();
+	}
+
+	frame.first = false;
+	if (m_position == m_end || *m_position != '"')
+	{
+		return fail("ожидалось имя свойства");
+	}
+
+	if (!parseString(frame.key, frame.keySize, frame.keyStorage))
+	{
+		return false;
+	}
+
+	skipWhitespace();
+	if (!consume(':'))
+	{
+		return fail("ожидалось двоеточие");
+	}
+
+	return true;
+}
+
+bool JsonPullParser::keyIs(const char* name) const
+{
+	Q_ASSERT(!m_frames.isEmpty() && m_frames.last().object);
+	const Frame& frame = m_frames.last();
+	return static_cast<int>(std::strlen(name)) == frame.keySize && std::memcmp(name, frame.key, frame.keySize) == 0;
+}
+
+bool JsonPullParser::beginArray()
+{
+	return beginValue('[', Type::Array);
+}
+
+bool JsonPullParser::nextElement()
+{
+	if (hasError())
+	{
+		return false;
+	}
+
+	Q_ASSERT(!m_frames.isEmpty() && !m_frames.last().object);
+	Frame& frame = m_frames.last();
+
+	skipWhitespace();
+	if (consume(']'))
+	{
+		m_frames.removeLast();
+		return false;
+	}
+
+	if (frame.first)
+	{
+		frame.first = false;
+		return true;
+	}
+
+	if (!consume(','))
+	{
+		return fail("ожидалась запятая или ]");
+	}
+
+	++frame.index;
+	return true;
+}
+
+bool JsonPullParser::atEnd()
+{
+	if (hasError())
+	{
+		return false;
+	}
+
+	skipWhitespace();
+	return m_position == m_end;
+}
+
+bool JsonPullParser::hasError() const
+{
+	return !m_error.isEmpty();
+}
+
+bool JsonPullParser::fail(const QString& message)
+{
+	if (m_error.isEmpty())
+	{
+		const QString currentPath = path();
+		m_error = currentPath.isEmpty() ? message : currentPath + ": " + message;
+	}
+
+	return false;
+}
+
+const QString& JsonPullParser::errorString() const
+{
+	return m_error;
+}
+
+QString JsonPullParser::path() const
+{
+	QString result;
+
+	for (const Frame& frame : m_frames)
+	{
+		if (frame.first)
+		{
+			break;
+		}
+
+		if (frame.object)
+		{
+			if (!result.isEmpty())
+			{
+				result += '.';
+			}
+			result += QString::fromUtf8(frame.key, frame.keySize);
+		}
+		else
+		{
+			result += '[' + QString::number(frame.index) + ']';
+		}
+	}
+
+	return result;
+}
+
+void JsonPullParser::skipWhitespace()
+{
+	while (m_position != m_end && (*m_position == ' ' || *m_position == '\n' || *m_position == '\r' || *m_position == '\t'))
+	{
+		++m_position;
+	}
+}
+
+bool JsonPullParser::consume(char c)
+{
+	if (m_position == m_end || *m_position != c)
+	{
+		return false;
+	}
+
+	++m_position;
+	return true;
+}
+
+bool JsonPullParser::beginValue(char c, Type type)
+{
+	if (hasError())
+	{
+		return false;
+	}
+
+	skipWhitespace();
+	if (!consume(c))
+	{
+		return fail(typeError(type));
+	}
+
+	if (m_frames.size() >= s_maxDepth)
+	{
+		return fail("слишком глубокая вложенность");
+	}
+
+	m_frames.append({ type == Type::Object, true, 0, nullptr, 0, QByteArray() });
+	return true;
+}
+
+bool JsonPullParser::parseString(const char*& data, int& size, QByteArray& storage)
+{
+	Q_ASSERT(*m_position == '"');
+	++m_position;
+
+	// most strings have no escapes and are used as is
+	const char* start = m_position;
+	while (m_position != m_end && *m_position != '"' && *m_position != '\\')
+	{
+		if (static_cast<unsigned char>(*m_position) < 0x20)
+		{
+			return fail("управляющий символ в строке");
+		}
+		++m_position;
+	}
+
+	if (m_position == m_end)
+	{
+		return fail("незакрытая строка");
+	}
+
+	if (*m_position == '"')
+	{
+		data = start;
+		size = static_cast<int>(m_position - start);
+		++m_position;
+		return true;
+	}
+
+	storage = QByteArray(start, static_cast<int>(m_position - start));
+
+	const auto readHex = [this](uint& code)
+	{
+		if (m_end - m_position < 4)
+		{
+			return false;
+		}
+
+		code = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			const int digit = hexValue(*m_position++);
+			if (digit < 0)
+			{
+				return false;
+			}
+			code = code * 16 + digit;
+		}
+
+		return true;
+	};
+
+	while (m_position != m_end && *m_position != '"')
+	{
+		const char c = *m_position++;
+		if (static_cast<unsigned char>(c) < 0x20)
+		{
+			return fail("управляющий символ в строке");
+		}
+
+		if (c != '\\')
+		{
+			storage.append(c);
+			continue;
+		}
+
+		if (m_position == m_end)
+		{
+			break;
+		}
+
+		switch (*m_position++)
+		{
+		case '"':
+			storage.append('"');
+			break;
+		case '\\':
+			storage.append('\\');
+			break;
+		case '/':
+			storage.append('/');
+			break;
+		case 'b':
+			storage.append('\b');
+			break;
+		case 'f':
+			storage.append('\f');
+			break;
+		case 'n':
+			storage.append('\n');
+			break;
+		case 'r':
+			storage.append('\r');
+			break;
+		case 't':
+			storage.append('\t');
+			break;
+		case 'u':
+		{
+			uint code = 0;
+			if (!readHex(code) || (code >= 0xdc00 && code < 0xe000))
+			{
+				return fail("неверная escape-последовательность");
+			}
+
+			// characters outside of the BMP are written as surrogate pairs
+			if (code >= 0xd800 && code < 0xdc00)
+			{
+				uint low = 0;
+				if (!consume('\\') || !consume('u') || !readHex(low) || low < 0xdc00 || low >= 0xe000)
+				{
+					return fail("неверная escape-последовательность");
+				}
+				code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+			}
+
+			appendUtf8(storage, code);
+			break;
+		}
+		default:
+			return fail("неверная escape-последовательность");
+		}
+	}
+
+	if (m_position == m_end)
+	{
+		return fail("незакрытая строка");
+	}
+
+	++m_position;
+	data = storage.constData();
+	size = storage.size();
+	return true;
+}
+
+bool JsonPullParser::parseNumber(double& value)
+{
+	const char* start = m_position;
+	bool integral = true;
+
+	consume('-');
+	if (!consume('0'))
+	{
+		if (m_position == m_end || !isDigit(*m_position))
+		{
+			return fail("неверное число");
+		}
+
+		while (m_position != m_end && isDigit(*m_position))
+		{
+			++m_position;
+		}
+	}
+
+	if (consume('.'))
+	{
+		integral = false;
+		if (m_position == m_end || !isDigit(*m_position))
+		{
+			return fail("неверное число");
+		}
+
+		while (m_position != m_end && isDigit(*m_position))
+		{
+			++m_position;
+		}
+	}
+
+	if (m_position != m_end && (*m_position == 'e' || *m_position == 'E'))
+	{
+		integral = false;
+		++m_position;
+		if (!consume('+'))
+		{
+			consume('-');
+		}
+
+		if (m_position == m_end || !isDigit(*m_position))
+		{
+			return fail("неверное число");
+		}
+
+		while (m_position != m_end && isDigit(*m_position))
+		{
+			++m_position;
+		}
+	}
+
+	const int size = static_cast<int>(m_position - start);
+
+	// ids, types and scores are small integers, they are converted without the general parser
+	if (integral && size <= 15)
+	{
+		const bool negative = *start == '-';
+		qint64 integer = 0;
+		for (const char* digit = negative ? start + 1 : start; digit != m_position; ++digit)
+		{
+			integer = integer * 10 + (*digit - '0');
+		}
+
+		value = static_cast<double>(negative ? -integer : integer);
+		return true;
+	}
+
+	bool ok = false;
+	value = QByteArray(start, size).toDouble(&ok);
+	if (!ok)
+	{
+		return fail("неверное число");
+	}
+
+	return true;
+}
+
+bool JsonPullParser::parseLiteral(const char* literal)
+{
+	const int size = static_cast<int>(std::strlen(literal));
+	if (m_end - m_position < size || std::memcmp(m_position, literal, size) != 0)
+	{
+		return fail(typeError(Type::Invalid));
+	}
+
+	m_position += size;
+	return true;
+}
+
+}
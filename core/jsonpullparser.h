@@ -0,0 +1,88 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace Core
+{
+
+// Forward only JSON reader over a byte array. Values are read in the order they appear without building
+// a document, only the path to the current value is kept for error messages like "phases[1].nodes[0].id".
+// All functions return false once an error has occurred, so callers check hasError() after the loops.
+class JsonPullParser
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object,
+		Invalid
+	};
+
+	explicit JsonPullParser(const QByteArray& json);
+
+	// Type of the next value, the value is not consumed
+	Type peek();
+
+	// Each read fails if the next value has another type
+	bool readString(QString& value);
+	bool readNumber(double& value);
+	bool readBool(bool& value);
+	bool skipValue();
+	// Skips the next value and returns its JSON, the bytes point into the parsed JSON and are valid while it is
+	bool readRaw(QByteArray& value);
+
+	// Members are iterated with nextKey() until it returns false, it consumes the closing brace
+	bool beginObject();
+	bool nextKey();
+	bool keyIs(const char* name) const;
+
+	// Elements are iterated with nextElement() the same way
+	bool beginArray();
+	bool nextElement();
+
+	// Whether only whitespace is left after the top level value
+	bool atEnd();
+
+	bool hasError() const;
+	// Keeps the first error only, always returns false to be returned by the caller
+	bool fail(const QString& message);
+	const QString& errorString() const;
+
+	// Path of the current value
+	QString path() const;
+
+private:
+	struct Frame
+	{
+		bool object;
+		bool first;
+		int index;
+		// the key points into the JSON unless it has escapes
+		const char* key;
+		int keySize;
+		QByteArray keyStorage;
+	};
+
+	void skipWhitespace();
+	bool consume(char c);
+	bool beginValue(char c, Type type);
+
+	// UTF-8 of the string without quotes, points into the JSON if there are no escapes
+	bool parseString(const char*& data, int& size, QByteArray& storage);
+	bool parseNumber(double& value);
+	bool parseLiteral(const char* literal);
+
+private:
+	const char* m_position;
+	const char* m_end;
+	QVector<Frame> m_frames;
+	QString m_error;
+};
+
+}
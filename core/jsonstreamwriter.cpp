@@ -0,0 +1,254 @@
+#include "jsonstreamwriter.h"
+
+#include <QLocale>
+
+#include <cmath>
+
+namespace Core
+{
+
+namespace
+{
+
+const char s_hexDigits[] = "0123456789abcdef";
+
+// Characters are encoded in chunks on the stack, so the string isn't converted to a temporary UTF-8 copy first
+class Utf8Appender
+{
+public:
+	explicit Utf8Appender(QByteArray& buffer)
+		: m_buffer(buffer)
+	{
+	}
+
+	~Utf8Appender()
+	{
+		flush();
+	}
+
+	void append(char c)
+	{
+		if (m_size == ChunkSize)
+		{
+			flush();
+		}
+		m_chunk[m_size++] = c;
+	}
+
+	void append(uint code)
+	{
+		if (code < 0x80)
+		{
+			append(static_cast<char>(code));
+		}
+		else if (code < 0x800)
+		{
+			append(static_cast<char>(0xc0 | (code >> 6)));
+			append(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+		else if (code < 0x10000)
+		{
+			append(static_cast<char>(0xe0 | (code >> 12)));
+			append(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+			append(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+		else
+		{
+			append(static_cast<char>(0xf0 | (code >> 18)));
+			append(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+			append(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+			append(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+	}
+
+	void flush()
+	{
+		m_buffer.append(m_chunk, m_size);
+		m_size = 0;
+	}
+
+private:
+	static const int ChunkSize = 256;
+
+	QByteArray& m_buffer;
+	char m_chunk[ChunkSize];
+	int m_size { 0 };
+};
+
+void appendEscaped(QByteArray& buffer, const QString& value)
+{
+	const QChar* data = value.constData();
+	const int size = value.size();
+
+	Utf8Appender appender(buffer);
+	appender.append('"');
+
+	for (int i = 0; i < size; ++i)
+	{
+		const ushort c = data[i].unicode();
+		if (c >= 0x20 && c != '"' && c != '\\')
+		{
+			if (!QChar::isSurrogate(c))
+			{
+				appender.append(static_cast<uint>(c));
+			}
+			else if (QChar::isHighSurrogate(c) && i + 1 < size && data[i + 1].isLowSurrogate())
+			{
+				appender.append(QChar::surrogateToUcs4(c, data[i + 1].unicode()));
+				++i;
+			}
+			else
+			{
+				// an unpaired surrogate, replaced like QString::toUtf8() does
+				appender.append('?');
+			}
+			continue;
+		}
+
+		appender.append('\\');
+		switch (c)
+		{
+		case '"':
+			appender.append('"');
+			break;
+		case '\\':
+			appender.append('\\');
+			break;
+		case '\b':
+			appender.append('b');
+			break;
+		case '\f':
+			appender.append('f');
+			break;
+		case '\n':
+			appender.append('n');
+			break;
+		case '\r':
+			appender.append('r');
+			break;
+		case '\t':
+			appender.append('t');
+			break;
+		default:
+			appender.append('u');
+			appender.append('0');
+			appender.append('0');
+			appender.append(s_hexDigits[c >> 4]);
+			appender.append(s_hexDigits[c & 0xf]);
+			break;
+		}
+	}
+
+	appender.append('"');
+}
+
+}
+
+JsonStreamWriter::JsonStreamWriter(QByteArray& buffer)
+	: m_buffer(buffer)
+{
+}
+
+void JsonStreamWriter::beginObject()
+{
+	beginValue();
+	m_buffer.append('{');
+	m_hasElements.append(false);
+}
+
+void JsonStreamWriter::beginObject(const char* key)
+{
+	writeKey(key);
+	beginObject();
+}
+
+void JsonStreamWriter::endObject()
+{
+	Q_ASSERT(!m_hasElements.isEmpty() && !m_afterKey);
+	m_hasElements.removeLast();
+	m_buffer.append('}');
+}
+
+void JsonStreamWriter::beginArray()
+{
+	beginValue();
+	m_buffer.append('[');
+	m_hasElements.append(false);
+}
+
+void JsonStreamWriter::beginArray(const char* key)
+{
+	writeKey(key);
+	beginArray();
+}
+
+void JsonStreamWriter::endArray()
+{
+	Q_ASSERT(!m_hasElements.isEmpty() && !m_afterKey);
+	m_hasElements.removeLast();
+	m_buffer.append(']');
+}
+
+void JsonStreamWriter::writeKey(const char* key)
+{
+	beginValue();
+	m_buffer.append('"');
+	m_buffer.append(key);
+	m_buffer.append("\":");
+	m_afterKey = true;
+}
+
+void JsonStreamWriter::writeValue(const QString& value)
+{
+	beginValue();
+	appendEscaped(m_buffer, value);
+}
+
+void JsonStreamWriter::writeValue(double value)
+{
+	beginValue();
+
+	// like QJsonDocument: no infinities and NaNs in JSON
+	if (!std::isfinite(value))
+	{
+		m_buffer.append("null");
+		return;
+	}
+
+	m_buffer.append(QByteArray::number(value, 'g', QLocale::FloatingPointShortest));
+}
+
+void JsonStreamWriter::writeValue(int value)
+{
+	beginValue();
+	m_buffer.append(QByteArray::number(value));
+}
+
+void JsonStreamWriter::writeValue(bool value)
+{
+	beginValue();
+	m_buffer.append(value ? "true" : "false");
+}
+
+void JsonStreamWriter::beginValue()
+{
+	if (m_afterKey)
+	{
+		m_afterKey = false;
+		return;
+	}
+
+	if (m_hasElements.isEmpty())
+	{
+		return;
+	}
+
+	if (m_hasElements.last())
+	{
+		m_buffer.append(',');
+	}
+
+	m_hasElements.last() = true;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVarLengthArray>
+
+namespace Core
+{
+
+// Appends compact JSON to a byte array as it is written, strings are encoded as UTF-8.
+// Produces the same text as QJsonDocument::Compact except for the order of the object keys,
+// without building QJsonObject and QJsonArray trees first.
+class JsonStreamWriter
+{
+public:
+	explicit JsonStreamWriter(QByteArray& buffer);
+
+	void beginObject();
+	void beginObject(const char* key);
+	void endObject();
+
+	void beginArray();
+	void beginArray(const char* key);
+	void endArray();
+
+	// The value is written by the next call, may be a nested writer like DialogJsonWriter
+	void writeKey(const char* key);
+
+	void writeValue(const QString& value);
+	void writeValue(double value);
+	void writeValue(int value);
+	void writeValue(bool value);
+
+	template <typename T>
+	void write(const char* key, const T& value)
+	{
+		writeKey(key);
+		writeValue(value);
+	}
+
+	// Keeps overloads for string literals from converting to bool
+	void write(const char* key, const char* value)
+	{
+		writeKey(key);
+		writeValue(QString::fromUtf8(value));
+	}
+
+	template <typename Container>
+	void writeArray(const char* key, const Container& values)
+	{
+		beginArray(key);
+		for (const auto& value : values)
+		{
+			writeValue(value);
+		}
+		endArray();
+	}
+
+private:
+	// Comma before every element of an object or an array but the first one
+	void beginValue();
+
+private:
+	QByteArray& m_buffer;
+	// one flag per open object or array, whether it has elements already
+	QVarLengthArray<bool, 16> m_hasElements;
+	bool m_afterKey { false };
+};
+
+}
@@ -0,0 +1,132 @@
+#include "memoryusage.h"
+
+namespace Core
+{
+
+namespace
+{
+
+// QArrayData and QListData headers
+const qint64 c_arrayHeaderSize = 24;
+// QHashData header
+const qint64 c_hashHeaderSize = 48;
+
+}
+
+qint64 MemoryUsage::total() const
+{
+	return strings + containers + objects;
+}
+
+MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other)
+{
+	strings += other.strings;
+	containers += other.containers;
+	objects += other.objects;
+	shared += other.shared;
+	return *this;
+}
+
+MemoryUsage operator-(const MemoryUsage& left, const MemoryUsage& right)
+{
+	MemoryUsage result;
+	result.strings = left.strings - right.strings;
+	result.containers = left.containers - right.containers;
+	result.objects = left.objects - right.objects;
+	result.shared = left.shared - right.shared;
+	return result;
+}
+
+void MemoryCounter::addString(const QString& string)
+{
+	// empty strings point to the shared null
+	if (string.isEmpty())
+	{
+		return;
+	}
+
+	addBuffer(string.constData(), c_arrayHeaderSize + (string.capacity() + 1) * sizeof(QChar), m_usage.strings);
+}
+
+void MemoryCounter::addStrings(const QList<QString>& strings)
+{
+	if (strings.isEmpty())
+	{
+		return;
+	}
+
+	// QString is stored in place, the address of the first one identifies the list buffer
+	if (addContainer(&strings.first(), strings.size(), sizeof(void*)))
+	{
+		for (const QString& string : strings)
+		{
+			addString(string);
+		}
+	}
+}
+
+void MemoryCounter::addStrings(const QSet<QString>& strings)
+{
+	if (strings.isEmpty())
+	{
+		return;
+	}
+
+	// buckets and nodes with the next pointer, the hash and the key
+	const qint64 bytes = c_hashHeaderSize + strings.capacity() * sizeof(void*) + strings.size() * (2 * sizeof(void*) + sizeof(QString));
+	if (addBuffer(&*strings.constBegin(), bytes, m_usage.containers))
+	{
+		for (const QString& string : strings)
+		{
+			addString(string);
+		}
+	}
+}
+
+void MemoryCounter::addErrorReplica(const ErrorReplica& error)
+{
+	if (error.errorReplica)
+	{
+		addString(*error.errorReplica);
+	}
+
+	if (error.finishingExpectedWords)
+	{
+		addStrings(*error.finishingExpectedWords);
+	}
+
+	if (error.finishingReplica)
+	{
+		addString(*error.finishingReplica);
+	}
+}
+
+bool MemoryCounter::addObject(const void* object, qint64 bytes)
+{
+	return addBuffer(object, bytes, m_usage.objects);
+}
+
+bool MemoryCounter::addContainer(const void* data, int size, qint64 itemSize)
+{
+	return addBuffer(data, c_arrayHeaderSize + size * itemSize, m_usage.containers);
+}
+
+const MemoryUsage& MemoryCounter::usage() const
+{
+	return m_usage;
+}
+
+bool MemoryCounter::addBuffer(const void* data, qint64 bytes, qint64& component)
+{
+	if (m_counted.contains(data))
+	{
+		m_usage.shared += bytes;
+		return false;
+	}
+
+	m_counted.insert(data);
+	component += bytes;
+	return true;
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "errorreplica.h"
+
+#include <QList>
+#include <QSet>
+#include <QString>
+
+namespace Core
+{
+
+// Approximate bytes taken by a part of the model
+struct MemoryUsage
+{
+	qint64 strings = 0;
+	qint64 containers = 0;
+	// node, phase and dialog objects
+	qint64 objects = 0;
+	// Buffers referenced again after being counted: what interning and implicit sharing save
+	qint64 shared = 0;
+
+	qint64 total() const;
+
+	MemoryUsage& operator+=(const MemoryUsage& other);
+};
+
+MemoryUsage operator-(const MemoryUsage& left, const MemoryUsage& right);
+
+// Collects MemoryUsage of dialogs, every shared buffer and node is counted once.
+// Estimates ignore allocator overhead and spare capacity of containers
+class MemoryCounter
+{
+public:
+	void addString(const QString& string);
+	void addStrings(const QList<QString>& strings);
+	void addStrings(const QSet<QString>& strings);
+	void addErrorReplica(const ErrorReplica& error);
+
+	// Return false if the object or the container buffer is already counted,
+	// its members must not be counted again then
+	bool addObject(const void* object, qint64 bytes);
+	bool addContainer(const void* data, int size, qint64 itemSize);
+
+	const MemoryUsage& usage() const;
+
+private:
+	bool addBuffer(const void* data, qint64 bytes, qint64& component);
+
+private:
+	QSet<const void*> m_counted;
+	MemoryUsage m_usage;
+};
+
+}
@@ -0,0 +1,58 @@
+#include "modelmemoryreport.h"
+
+namespace Core
+{
+
+ModelMemoryReport::ModelMemoryReport(const QMap<QString, QList<Dialog>>& dialogs)
+{
+	MemoryCounter counter;
+
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		MemoryUsage& client = m_clients[it.key()];
+
+		for (const Dialog& dialog : it.value())
+		{
+			const MemoryUsage before = counter.usage();
+			dialog.accountMemory(counter);
+
+			const DialogUsage usage = { it.key(), dialog.printableName(), counter.usage() - before };
+			client += usage.usage;
+			m_dialogs.append(usage);
+
+			// a whole shared phase is a single reference above, so the saving is measured by counting the dialog alone
+			MemoryCounter dialogCounter;
+			dialog.accountMemory(dialogCounter);
+			m_unshared += dialogCounter.usage().total();
+		}
+	}
+
+	m_total = counter.usage();
+}
+
+const QVector<ModelMemoryReport::DialogUsage>& ModelMemoryReport::dialogs() const
+{
+	return m_dialogs;
+}
+
+const QMap<QString, MemoryUsage>& ModelMemoryReport::clients() const
+{
+	return m_clients;
+}
+
+const MemoryUsage& ModelMemoryReport::total() const
+{
+	return m_total;
+}
+
+double ModelMemoryReport::deduplicationRatio() const
+{
+	if (m_total.total() == 0)
+	{
+		return 1.0;
+	}
+
+	return static_cast<double>(m_unshared) / m_total.total();
+}
+
+}
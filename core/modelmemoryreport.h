@@ -0,0 +1,40 @@
+#pragma once
+
+#include "dialog.h"
+#include "memoryusage.h"
+
+#include <QMap>
+#include <QVector>
+
+namespace Core
+{
+
+// Memory taken by the loaded dialogs by client, dialog and component.
+// Buffers shared between dialogs are charged to the first dialog using them
+// and reported as shared by the others, so the sum of the dialogs is the real usage
+class ModelMemoryReport
+{
+public:
+	struct DialogUsage
+	{
+		QString client;
+		QString dialog;
+		MemoryUsage usage;
+	};
+
+	explicit ModelMemoryReport(const QMap<QString, QList<Dialog>>& dialogs);
+
+	const QVector<DialogUsage>& dialogs() const;
+	const QMap<QString, MemoryUsage>& clients() const;
+	const MemoryUsage& total() const;
+	// Memory the dialogs would take if they shared nothing with each other to the memory they take
+	double deduplicationRatio() const;
+
+private:
+	QVector<DialogUsage> m_dialogs;
+	QMap<QString, MemoryUsage> m_clients;
+	MemoryUsage m_total;
+	qint64 m_unshared { 0 };
+};
+
+}
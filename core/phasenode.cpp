@@ -1,8 +1,11 @@
 #include "phasenode.h"
 #include "expectedwordsnode.h"
 #include "hashcombine.h"
+#include "memoryusage.h"
 
-#include "logger.h"
+#include <QVector>
+
+#include <algorithm>
 
 namespace Core
 {
@@ -10,250 +13,323 @@ namespace Core
 namespace
 {
 
-QList<AbstractDialogNode*> filterLeafs(const QList<AbstractDialogNode*>& nodes)
+// The best sum of expected words scores over the paths inside the phase. A path starts at a node without parents
+// in the phase and ends at a node without children in the phase. Scores are propagated from parents to children
+// in topological order, so it is linear in the number of links however many paths there are.
+// Nodes on cycles are never ready and are left out, like DialogAnalysis does
+double calculateBestPossibleScore(const QList<AbstractDialogNode*>& nodes)
 {
-	QList<AbstractDialogNode*> leafs;
-	std::copy_if(nodes.begin(), nodes.end(), std::back_inserter(leafs),
-		[&nodes](AbstractDialogNode* node)
-		{
-			const QSet<AbstractDialogNode::Id> nodeChilds = node->childNodes();
-			if (nodeChilds.empty())
-			{
-				return true;
-			}
-
-			return std::any_of(nodeChilds.begin(), nodeChilds.end(), [&nodes](AbstractDialogNode::Id childId)
-			{
-				const auto childNodeIt = findNodeById(nodes.begin(), nodes.end(), childId);
-				return childNodeIt == nodes.end();
-			});
-		});
-	return leafs;
-}
-
-typedef QList<AbstractDialogNode*> NodesPath;
-
-QList<NodesPath> findPathsToRoot(AbstractDialogNode* node, const QList<AbstractDialogNode*>& nodes)
-{
-	LOG << "searching path to root from " << node->id();
-
-	if (node->parentNodes().empty())
+	QHash<AbstractDialogNode::Id, int> indexes;
+	indexes.reserve(nodes.size());
+	for (int i = 0; i < nodes.size(); ++i)
 	{
-		LOG << node->id() << " is root";
-		return { { node } };
+		indexes.insert(nodes[i]->id(), i);
 	}
 
-	QList<NodesPath> path;
+	const auto inPhase = [&indexes](const AbstractDialogNode::Id& id) { return indexes.contains(id); };
+
+	QVector<double> bestScores(nodes.size(), 0.0);
+	// number of parents in the phase not processed yet, entries of the phase start without any
+	QVector<int> pendingParents(nodes.size(), 0);
+	QVector<int> ready;
 
-	for (const AbstractDialogNode::Id& parentId : node->parentNodes())
+	for (int i = 0; i < nodes.size(); ++i)
 	{
-		const auto parentNodeIt = findNodeById(nodes.begin(), nodes.end(), parentId);
-		if (parentNodeIt == nodes.end())
+		const QSet<AbstractDialogNode::Id>& parents = nodes[i]->parentNodes();
+		const bool entry = parents.isEmpty() || !std::all_of(parents.begin(), parents.end(), inPhase);
+		if (entry)
 		{
-			LOG << node->id() << " is root";
-			return { { node } };
+			ready.append(i);
 		}
-
-		QList<NodesPath> pathToParent = findPathsToRoot(*parentNodeIt, nodes);
-		for (NodesPath& path : pathToParent)
+		else
 		{
-			path.prepend(node);
+			pendingParents[i] = parents.size();
 		}
-
-		LOG << "found " << pathToParent.length() << " paths to " << node->id();
-
-		path.append(pathToParent);
 	}
 
-	return path;
-}
-
-double calculateBestPossibleScore(const QString& name, const QList<AbstractDialogNode*>& nodes)
-{
-	QList<AbstractDialogNode*> leafs = filterLeafs(nodes);
-
-	typedef QList<AbstractDialogNode*> NodesPath;
-	QList<NodesPath> leafToRootPaths;
-	for (AbstractDialogNode* leaf : leafs)
+	double result = 0.0;
+	for (int next = 0; next < ready.size(); ++next)
 	{
-		QList<NodesPath> paths = findPathsToRoot(leaf, nodes);
+		const int index = ready[next];
+		const AbstractDialogNode* node = nodes[index];
 
-		leafToRootPaths.append(paths);
-	}
+		const ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
+		if (expectedWordsNode)
+		{
+			bestScores[index] += expectedWordsNode->bestPossibleScore();
+		}
 
-	LOG << name << ": Found " << leafToRootPaths.length() << " leafToRoot paths";
+		const QSet<AbstractDialogNode::Id>& children = node->childNodes();
+		if (children.isEmpty() || !std::all_of(children.begin(), children.end(), inPhase))
+		{
+			result = std::max(result, bestScores[index]);
+		}
 
-	QList<double> scores;
-	std::transform(leafToRootPaths.begin(), leafToRootPaths.end(), std::back_inserter(scores),
-		[](const NodesPath& path)
+		for (const AbstractDialogNode::Id& childId : children)
 		{
-			double score = 0.0;
-			for (AbstractDialogNode* node : path)
+			const int child = indexes.value(childId, -1);
+			// entries don't continue the paths of their parents
+			if (child < 0 || pendingParents[child] == 0 || !nodes[child]->parentNodes().contains(node->id()))
 			{
-				ExpectedWordsNode* expectedWordsNode = node->as<ExpectedWordsNode>();
-				if (expectedWordsNode)
-				{
-					score += expectedWordsNode->bestPossibleScore();
-				}
+				continue;
 			}
-			return score;
-		});
 
-	if (scores.empty())
-	{
-		return 0.0;
+			bestScores[child] = std::max(bestScores[child], bestScores[index]);
+			if (--pendingParents[child] == 0)
+			{
+				ready.append(child);
+			}
+		}
 	}
 
-	const auto maxScoreIt = std::max_element(scores.begin(), scores.end());
-	Q_ASSERT(maxScoreIt != scores.end());
-	return *maxScoreIt;
+	return result;
 }
 
-double calculateBestPossibleScoreCached(const QString& name, const QList<AbstractDialogNode*>& nodes)
+void retainNode(AbstractDialogNode* node)
 {
-	typedef quint64 HashType;
-
-	static const auto hash = [](const QList<AbstractDialogNode*>& nodes) -> HashType
-	{
-		size_t seed = 0;
-		for (AbstractDialogNode* node : nodes)
-		{
-			seed ^= node->hash();
-		}
-		return seed;
-	};
-
-	static QMap<HashType, double> s_cache;
+	node->ref.ref();
+}
 
-	const HashType nodesHash = hash(nodes);
-	auto it = s_cache.find(nodesHash);
-	if (it != s_cache.end())
+void releaseNode(AbstractDialogNode* node)
+{
+	if (!node->ref.deref())
 	{
-		return *it;
+		delete node;
 	}
-
-	const double bestPossibleScore = calculateBestPossibleScore(name, nodes);
-	s_cache.insert(nodesHash, bestPossibleScore);
-	return bestPossibleScore;
 }
 
 }
 
-PhaseNode::PhaseNode(const QString& name, double score, bool repeatOnInsufficientScore, const QList<AbstractDialogNode*>& nodes, const ErrorReplica& errorReplica)
-	: m_name(name)
-	, m_score(score)
-	, m_repeatOnInsufficientScore(repeatOnInsufficientScore)
-	, m_nodes(nodes)
-	, m_errorReplica(errorReplica)
+class PhaseNodeData
+	: public QSharedData
 {
-}
-
-PhaseNode::PhaseNode(const PhaseNode& other)
-	: m_name(other.m_name)
-	, m_score(other.m_score)
-	, m_repeatOnInsufficientScore(other.m_repeatOnInsufficientScore)
-	, m_errorReplica(other.m_errorReplica)
-	, m_repeatReplica(other.m_repeatReplica)
-{
-	setId(other.id());
-
-	for (const AbstractDialogNode::Id& id : other.parentNodes())
+public:
+	PhaseNodeData(const QString& name, double score, bool repeatOnInsufficientScore, const QList<AbstractDialogNode*>& nodes, const ErrorReplica& errorReplica)
+		: name(name)
+		, score(score)
+		, repeatOnInsufficientScore(repeatOnInsufficientScore)
+		, nodes(nodes)
+		, errorReplica(errorReplica)
+		, contentHash(0)
+		, contentHashValid(false)
+		, nodesEditable(false)
 	{
-		appendParent(id);
+		std::for_each(this->nodes.begin(), this->nodes.end(), retainNode);
 	}
 
-	for (const AbstractDialogNode::Id& id : other.childNodes())
+	// Nodes are not cloned, they are shared until one of them is requested for modification
+	PhaseNodeData(const PhaseNodeData& other)
+		: QSharedData(other)
+		, name(other.name)
+		, score(other.score)
+		, repeatOnInsufficientScore(other.repeatOnInsufficientScore)
+		, nodes(other.nodes)
+		, errorReplica(other.errorReplica)
+		, repeatReplica(other.repeatReplica)
+		, contentHash(other.contentHash)
+		, contentHashValid(other.contentHashValid)
+		, nodesEditable(other.nodesEditable)
 	{
-		appendChild(id);
+		std::for_each(nodes.begin(), nodes.end(), retainNode);
 	}
 
-	for (AbstractDialogNode* node : other.nodes())
+	~PhaseNodeData()
 	{
-		m_nodes.append(node->clone(false));
+		std::for_each(nodes.begin(), nodes.end(), releaseNode);
 	}
+
+	QString name;
+	double score;
+	bool repeatOnInsufficientScore;
+	QList<AbstractDialogNode*> nodes;
+
+	ErrorReplica errorReplica;
+	Optional<QString> repeatReplica;
+
+	// see PhaseNode::contentHash()
+	mutable size_t contentHash;
+	mutable bool contentHashValid;
+	// the nodes were handed out by mutableNode() or detachNodes() and may be edited without notice
+	bool nodesEditable;
+};
+
+PhaseNode::PhaseNode(const QString& name, double score, bool repeatOnInsufficientScore, const QList<AbstractDialogNode*>& nodes, const ErrorReplica& errorReplica)
+	: d(new PhaseNodeData(name, score, repeatOnInsufficientScore, nodes, errorReplica))
+{
 }
 
+PhaseNode::PhaseNode(const PhaseNode& other) = default;
+
+PhaseNode::PhaseNode(PhaseNode&& other) = default;
+
+PhaseNode::~PhaseNode() = default;
+
+PhaseNode& PhaseNode::operator=(const PhaseNode& other) = default;
+
+PhaseNode& PhaseNode::operator=(PhaseNode&& other) = default;
+
 const QString& PhaseNode::name() const
 {
-	return m_name;
+	return d->name;
 }
 
 void PhaseNode::setName(const QString& name)
 {
-	m_name = name;
+	d->name = name;
+	invalidateHash();
+	invalidateContentHash();
 }
 
 double PhaseNode::score() const
 {
-	return m_score;
+	return d->score;
 }
 
 void PhaseNode::setScore(double score)
 {
-	m_score = score;
+	d->score = score;
+	invalidateHash();
+	invalidateContentHash();
 }
 
 double PhaseNode::bestPossibleScore() const
 {
-	return calculateBestPossibleScoreCached(m_name, m_nodes);
+	return calculateBestPossibleScore(d->nodes);
 }
 
 bool PhaseNode::repeatOnInsufficientScore() const
 {
-	return m_repeatOnInsufficientScore;
+	return d->repeatOnInsufficientScore;
 }
 
 void PhaseNode::setRepeatOnInsufficientScore(bool repeatOnInsufficientScore)
 {
-	m_repeatOnInsufficientScore = repeatOnInsufficientScore;
+	d->repeatOnInsufficientScore = repeatOnInsufficientScore;
+	invalidateHash();
+	invalidateContentHash();
 }
 
 const QList<AbstractDialogNode*>& PhaseNode::nodes() const
 {
-	return m_nodes;
+	return d->nodes;
 }
 
 void PhaseNode::appendNode(AbstractDialogNode* node)
 {
-	if (!m_nodes.contains(node))
+	if (!nodes().contains(node))
 	{
-		m_nodes.append(node);
+		retainNode(node);
+		d->nodes.append(node);
+		invalidateContentHash();
 	}
 }
 
 void PhaseNode::removeNode(AbstractDialogNode* node)
 {
-	m_nodes.removeOne(node);
+	if (!nodes().contains(node))
+	{
+		return;
+	}
+
+	d->nodes.removeOne(node);
+	releaseNode(node);
+	invalidateContentHash();
+}
+
+void PhaseNode::setNodes(const QList<AbstractDialogNode*>& nodes)
+{
+	// retained first, the new nodes may include some of the old ones
+	std::for_each(nodes.begin(), nodes.end(), retainNode);
+	std::for_each(d->nodes.begin(), d->nodes.end(), releaseNode);
+	d->nodes = nodes;
+	d->nodesEditable = false;
+	invalidateContentHash();
+}
+
+AbstractDialogNode* PhaseNode::mutableNode(const Id& id)
+{
+	const auto constNodeIt = findNodeById(nodes(), id);
+	if (constNodeIt == nodes().end())
+	{
+		return nullptr;
+	}
+
+	const int index = std::distance(nodes().begin(), constNodeIt);
+	AbstractDialogNode*& node = d->nodes[index];
+	if (node->ref.load() > 1)
+	{
+		AbstractDialogNode* copy = node->clone(false);
+		retainNode(copy);
+		releaseNode(node);
+		node = copy;
+	}
+
+	d->nodesEditable = true;
+	invalidateContentHash();
+	return node;
+}
+
+const QList<AbstractDialogNode*>& PhaseNode::detachNodes()
+{
+	// the phase data is detached first, its copy retains the nodes shared with the other phases
+	QList<AbstractDialogNode*>& nodes = d->nodes;
+	for (AbstractDialogNode*& node : nodes)
+	{
+		if (node->ref.load() > 1)
+		{
+			AbstractDialogNode* copy = node->clone(false);
+			retainNode(copy);
+			releaseNode(node);
+			node = copy;
+		}
+	}
+
+	d->nodesEditable = true;
+	invalidateContentHash();
+	return nodes;
+}
+
+bool PhaseNode::isSharedWith(const PhaseNode& other) const
+{
+	return d == other.d;
 }
 
 const ErrorReplica& PhaseNode::errorReplica() const
 {
-	return m_errorReplica;
+	return d->errorReplica;
 }
 
 ErrorReplica& PhaseNode::errorReplica()
 {
-	return m_errorReplica;
+	invalidateHash();
+	invalidateContentHash();
+	return d->errorReplica;
 }
 
 void PhaseNode::setErrorReplica(const ErrorReplica& replica)
 {
-	m_errorReplica = replica;
+	d->errorReplica = replica;
+	invalidateHash();
+	invalidateContentHash();
 }
 
 void PhaseNode::resetErrorReplica()
 {
-	m_errorReplica = ErrorReplica();
+	d->errorReplica = ErrorReplica();
+	invalidateHash();
+	invalidateContentHash();
 }
 
 Optional<QString>& PhaseNode::repeatReplica()
 {
-	return m_repeatReplica;
+	invalidateHash();
+	invalidateContentHash();
+	return d->repeatReplica;
 }
 
 const Optional<QString>& PhaseNode::repeatReplica() const
 {
-	return m_repeatReplica;
+	return d->repeatReplica;
 }
 
 int PhaseNode::type() const
@@ -263,47 +339,47 @@ int PhaseNode::type() const
 
 bool PhaseNode::validate(QString& errorMessage) const
 {
-	if (m_name.trimmed().isEmpty())
+	if (d->name.trimmed().isEmpty())
 	{
 		errorMessage = "Имя фазы не может быть пустым";
 		return false;
 	}
 
-	if (m_repeatOnInsufficientScore && !m_nodes.empty())
+	if (d->repeatOnInsufficientScore && !d->nodes.empty())
 	{
-		const double bestPossibleScore = calculateBestPossibleScoreCached(m_name, m_nodes);
-		if (bestPossibleScore < m_score)
+		const double bestPossibleScore = calculateBestPossibleScore(d->nodes);
+		if (bestPossibleScore < d->score)
 		{
 			errorMessage = "Cлишком большое количество баллов (максимум - " + QString::number(bestPossibleScore) + ")";
 			return false;
 		}
 	}
 
-	if (m_errorReplica.errorReplica && (*m_errorReplica.errorReplica).trimmed().isEmpty())
+	if (d->errorReplica.errorReplica && (*d->errorReplica.errorReplica).trimmed().isEmpty())
 	{
 		errorMessage = "Реплика для ошибки не может быть пустой";
 		return false;
 	}
 
-	if (m_errorReplica.errorPenalty && (*m_errorReplica.errorPenalty) < 0.0)
+	if (d->errorReplica.errorPenalty && (*d->errorReplica.errorPenalty) < 0.0)
 	{
 		errorMessage = "Количество штрафных баллов должно быть больше или равно 0";
 		return false;
 	}
 
-	if (m_errorReplica.finishingReplica && (*m_errorReplica.finishingReplica).trimmed().isEmpty())
+	if (d->errorReplica.finishingReplica && (*d->errorReplica.finishingReplica).trimmed().isEmpty())
 	{
 		errorMessage = "Завершающая реплика не может быть пустой";
 		return false;
 	}
 
-	if (m_errorReplica.finishingExpectedWords && (*m_errorReplica.finishingExpectedWords).isEmpty())
+	if (d->errorReplica.finishingExpectedWords && (*d->errorReplica.finishingExpectedWords).isEmpty())
 	{
 		errorMessage = "Завершающие опорные слова не могут быть пустыми";
 		return false;
 	}
 
-	if (m_repeatReplica && (*m_repeatReplica).trimmed().isEmpty())
+	if (d->repeatReplica && (*d->repeatReplica).trimmed().isEmpty())
 	{
 		errorMessage = "Реплика для повтора не может быть пустой";
 		return false;
@@ -314,14 +390,8 @@ bool PhaseNode::validate(QString& errorMessage) const
 
 AbstractDialogNode* PhaseNode::shallowCopy() const
 {
-	QList<AbstractDialogNode*> clonedNodes;
-	for (AbstractDialogNode* node : m_nodes)
-	{
-		clonedNodes.append(node->clone(false));
-	}
-
-	PhaseNode* result = new PhaseNode(m_name, m_score, m_repeatOnInsufficientScore, clonedNodes, m_errorReplica);
-	result->m_repeatReplica = m_repeatReplica;
+	PhaseNode* result = new PhaseNode(QString(), 0.0, false, {}, ErrorReplica());
+	result->d = d;
 	return result;
 }
 
@@ -335,28 +405,93 @@ size_t PhaseNode::calculateHash() const
 {
 	size_t seed = 0;
 
-	hashCombine(seed, m_name);
-	hashCombine(seed, m_score);
-	hashCombine(seed, m_repeatOnInsufficientScore);
+	hashCombine(seed, d->name);
+	hashCombine(seed, d->score);
+	hashCombine(seed, d->repeatOnInsufficientScore);
+
+	hashCombine(seed, d->errorReplica);
+	hashCombine(seed, d->repeatReplica);
+
+	// nodes are modified in place without notifying the phase, see contentHash()
+
+	return seed;
+}
+
+size_t PhaseNode::objectSize() const
+{
+	return sizeof(*this);
+}
+
+void PhaseNode::accountData(MemoryCounter& counter) const
+{
+	// the data is shared between copies of the phase until one of them is modified
+	if (!counter.addObject(d.constData(), sizeof(PhaseNodeData)))
+	{
+		return;
+	}
+
+	counter.addString(d->name);
+	counter.addErrorReplica(d->errorReplica);
+	if (d->repeatReplica)
+	{
+		counter.addString(*d->repeatReplica);
+	}
+
+	if (!d->nodes.isEmpty() && counter.addContainer(&d->nodes.first(), d->nodes.size(), sizeof(void*)))
+	{
+		for (const AbstractDialogNode* node : d->nodes)
+		{
+			node->accountMemory(counter);
+		}
+	}
+}
+
+size_t PhaseNode::contentHash() const
+{
+	if (d->contentHashValid)
+	{
+		return d->contentHash;
+	}
+
+	size_t seed = dataHash();
 
-	for (AbstractDialogNode* node : m_nodes)
+	for (AbstractDialogNode* node : d->nodes)
 	{
-		seed ^= node->hash();
+		hashCombine(seed, node->hash());
 	}
 
-	// omitted, because these fields are not required atm
-	//hashCombine(seed, m_errorReplica);
-	//hashCombine(seed, m_repeatReplica);
+	// the handed out nodes don't notify the phase when they are edited, their own hashes are still cached
+	if (!d->nodesEditable)
+	{
+		d->contentHash = seed;
+		d->contentHashValid = true;
+	}
 
 	return seed;
 }
 
+void PhaseNode::invalidateContentHash()
+{
+	d->contentHashValid = false;
+}
+
 bool operator==(const PhaseNode& left, const PhaseNode& right)
 {
+	if (left.isSharedWith(right))
+	{
+		return true;
+	}
+
+	if (left.contentHash() != right.contentHash())
+	{
+		return false;
+	}
+
 	return left.name() == right.name() &&
 		left.score() == right.score() &&
 		left.repeatOnInsufficientScore() == right.repeatOnInsufficientScore() &&
 		left.errorReplica() == right.errorReplica() &&
+		left.repeatReplica() == right.repeatReplica() &&
 		left.nodes().size() == right.nodes().size() &&
 		std::equal(left.nodes().begin(), left.nodes().end(), right.nodes().begin(),
 			[](AbstractDialogNode* left, AbstractDialogNode* right) { return left->compare(right); });
@@ -2,10 +2,13 @@
 
 #include "abstractdialognode.h"
 #include "errorreplica.h"
+#include <QSharedDataPointer>
 
 namespace Core
 {
 
+class PhaseNodeData;
+
 class PhaseNode
 	: public AbstractDialogNode
 {
@@ -17,6 +20,11 @@ public:
 
 	PhaseNode(const QString& name, double score, bool repeatOnInsufficientScore, const QList<AbstractDialogNode*>& nodes, const ErrorReplica& errorReplica);
 	PhaseNode(const PhaseNode& other);
+	PhaseNode(PhaseNode&& other);
+	~PhaseNode();
+
+	PhaseNode& operator=(const PhaseNode& other);
+	PhaseNode& operator=(PhaseNode&& other);
 
 	const QString& name() const;
 	void setName(const QString& name);
@@ -31,6 +39,20 @@ public:
 	const QList<AbstractDialogNode*>& nodes() const;
 	void appendNode(AbstractDialogNode* node);
 	void removeNode(AbstractDialogNode* node);
+	// Shares the nodes with their other owners, like a copy of a phase does, see PhaseTemplateLibrary
+	void setNodes(const QList<AbstractDialogNode*>& nodes);
+
+	// Copies the node if it is shared with another phase, so it can be modified in place
+	AbstractDialogNode* mutableNode(const Id& id);
+	// Same for all nodes, must be called before handing the nodes out for in-place editing
+	const QList<AbstractDialogNode*>& detachNodes();
+
+	bool isSharedWith(const PhaseNode& other) const;
+
+	// Hash of the phase fields and its nodes, ignores the phase id like operator== does.
+	// Cached until the phase changes, while the nodes are handed out for editing it is
+	// recomputed from the cached node hashes
+	size_t contentHash() const;
 
 	const ErrorReplica& errorReplica() const;
 	ErrorReplica& errorReplica();
@@ -47,15 +69,13 @@ private:
 	virtual AbstractDialogNode* shallowCopy() const override;
 	virtual bool compareData(AbstractDialogNode* other) const override;
 	virtual size_t calculateHash() const override;
+	virtual size_t objectSize() const override;
+	virtual void accountData(MemoryCounter& counter) const override;
 
-private:
-	QString m_name;
-	double m_score;
-	bool m_repeatOnInsufficientScore;
-	QList<AbstractDialogNode*> m_nodes;
+	void invalidateContentHash();
 
-	ErrorReplica m_errorReplica;
-	Optional<QString> m_repeatReplica;
+private:
+	QSharedDataPointer<PhaseNodeData> d;
 };
 
 bool operator==(const PhaseNode& left, const PhaseNode& right);
@@ -0,0 +1,578 @@
+#include "phasetemplatelibrary.h"
+#include "dialogbinaryreader.h"
+#include "dialogbinarywriter.h"
+#include "hashcombine.h"
+
+#include <QUuid>
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+size_t contentKey(const AbstractDialogNode* node)
+{
+	size_t seed = node->dataHash();
+	hashCombine(seed, node->type());
+	return seed;
+}
+
+// Content of the node and of its neighbours in the phase, without the ids
+QHash<AbstractDialogNode::Id, size_t> structureKeys(const QList<AbstractDialogNode*>& nodes)
+{
+	QHash<AbstractDialogNode::Id, size_t> contentKeys;
+	for (const AbstractDialogNode* node : nodes)
+	{
+		contentKeys.insert(node->id(), contentKey(node));
+	}
+
+	QHash<AbstractDialogNode::Id, size_t> result;
+	for (const AbstractDialogNode* node : nodes)
+	{
+		// sums don't depend on the order of the links, the nodes of other phases add nothing
+		size_t children = 0;
+		for (const AbstractDialogNode::Id& child : node->childNodes())
+		{
+			children += contentKeys.value(child);
+		}
+
+		size_t parents = 0;
+		for (const AbstractDialogNode::Id& parent : node->parentNodes())
+		{
+			parents += contentKeys.value(parent);
+		}
+
+		size_t seed = contentKeys.value(node->id());
+		hashCombine(seed, children);
+		hashCombine(seed, parents);
+		result.insert(node->id(), seed);
+	}
+
+	return result;
+}
+
+QString createId()
+{
+	return QUuid::createUuid().toString();
+}
+
+// Drops the links of the other phases to the removed nodes
+void removeLinks(QList<PhaseNode>& phases, const QSet<AbstractDialogNode::Id>& removed)
+{
+	for (PhaseNode& phase : phases)
+	{
+		QList<AbstractDialogNode::Id> linked;
+		for (const AbstractDialogNode* node : phase.nodes())
+		{
+			if (node->parentNodes().intersects(removed) || node->childNodes().intersects(removed))
+			{
+				linked.append(node->id());
+			}
+		}
+
+		for (const AbstractDialogNode::Id& id : linked)
+		{
+			AbstractDialogNode* node = phase.mutableNode(id);
+			for (const AbstractDialogNode::Id& removedId : removed)
+			{
+				if (node->parentNodes().contains(removedId))
+				{
+					node->removeParent(removedId);
+				}
+				if (node->childNodes().contains(removedId))
+				{
+					node->removeChild(removedId);
+				}
+			}
+		}
+	}
+}
+
+}
+
+QString PhaseTemplateLibrary::add(const QString& name, const PhaseNode& phase)
+{
+	const QString id = createId();
+
+	PhaseNode templatePhase = phase;
+	templatePhase.setId(id);
+	templatePhase.setName(name);
+
+	m_index.insert(nodesHash(phase.nodes()), m_templates.size());
+	m_templates.append({ id, name, templatePhase });
+	return id;
+}
+
+void PhaseTemplateLibrary::rename(const QString& id, const QString& name)
+{
+	for (Template& item : m_templates)
+	{
+		if (item.id == id)
+		{
+			item.name = name;
+			item.phase.setName(name);
+			return;
+		}
+	}
+}
+
+void PhaseTemplateLibrary::remove(const QString& id)
+{
+	const auto it = std::find_if(m_templates.begin(), m_templates.end(), [&id](const Template& item) { return item.id == id; });
+	if (it != m_templates.end())
+	{
+		m_templates.erase(it);
+		rebuildIndex();
+	}
+}
+
+const QVector<PhaseTemplateLibrary::Template>& PhaseTemplateLibrary::templates() const
+{
+	return m_templates;
+}
+
+const PhaseTemplateLibrary::Template* PhaseTemplateLibrary::find(const QString& id) const
+{
+	const auto it = std::find_if(m_templates.begin(), m_templates.end(), [&id](const Template& item) { return item.id == id; });
+	return it == m_templates.end() ? nullptr : &*it;
+}
+
+QString PhaseTemplateLibrary::match(const PhaseNode& phase) const
+{
+	Match match = Match::None;
+	IdMap templateIds;
+	const Template* item = findTemplate(phase, match, templateIds);
+	return item ? item->id : QString();
+}
+
+PhaseNode PhaseTemplateLibrary::instantiate(const QString& id, const QSet<AbstractDialogNode::Id>& usedIds) const
+{
+	const Template* item = find(id);
+	Q_ASSERT(item);
+
+	PhaseNode result = item->phase;
+	result.setId(createId());
+
+	const QList<AbstractDialogNode*>& nodes = item->phase.nodes();
+
+	QSet<AbstractDialogNode::Id> ids;
+	for (const AbstractDialogNode* node : nodes)
+	{
+		ids.insert(node->id());
+	}
+
+	const bool idsUsed = ids.intersects(usedIds);
+	// the links to the other phases of the dialog the template was made from
+	const bool linksOutside = std::any_of(nodes.begin(), nodes.end(), [&ids](const AbstractDialogNode* node)
+	{
+		return !ids.contains(node->parentNodes()) || !ids.contains(node->childNodes());
+	});
+
+	if (idsUsed || linksOutside)
+	{
+		IdMap newIds;
+		for (const AbstractDialogNode* node : nodes)
+		{
+			newIds.insert(node->id(), idsUsed ? createId() : node->id());
+		}
+		result.setNodes(copyNodes(nodes, newIds));
+	}
+
+	return result;
+}
+
+int PhaseTemplateLibrary::usages(const QString& id, const QMap<QString, QList<Dialog>>& dialogs) const
+{
+	int result = 0;
+	for (const QList<Dialog>& clientDialogs : dialogs)
+	{
+		for (const Dialog& dialog : clientDialogs)
+		{
+			result += std::count_if(dialog.phases.begin(), dialog.phases.end(), [this, &id](const PhaseNode& phase) { return match(phase) == id; });
+		}
+	}
+	return result;
+}
+
+Dialog PhaseTemplateLibrary::link(const Dialog& dialog) const
+{
+	Dialog result = dialog;
+
+	for (int i = 0; i < dialog.phases.size(); ++i)
+	{
+		// remapped phases keep their nodes, the node ids can't be shared
+		Match match = Match::None;
+		IdMap templateIds;
+		const Template* item = findTemplate(dialog.phases[i], match, templateIds);
+		if (item && match == Match::Same && item->phase.nodes() != dialog.phases[i].nodes())
+		{
+			result.phases[i].setNodes(item->phase.nodes());
+		}
+	}
+
+	return result;
+}
+
+QMap<QString, QList<Dialog>> PhaseTemplateLibrary::link(const QMap<QString, QList<Dialog>>& dialogs) const
+{
+	if (m_templates.isEmpty())
+	{
+		return dialogs;
+	}
+
+	QMap<QString, QList<Dialog>> result;
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		QList<Dialog>& clientDialogs = result[it.key()];
+		clientDialogs.reserve(it.value().size());
+		for (const Dialog& dialog : it.value())
+		{
+			clientDialogs.append(link(dialog));
+		}
+	}
+	return result;
+}
+
+bool PhaseTemplateLibrary::canUpdate(const QString& id, const PhaseNode& phase) const
+{
+	const Template* item = find(id);
+	IdMap templateIds;
+	return item && mapToTemplate(phase.nodes(), item->phase.nodes(), templateIds);
+}
+
+PhaseTemplateLibrary::UpdatedDialogs PhaseTemplateLibrary::update(const QString& id, const PhaseNode& phase, const QMap<QString, QList<Dialog>>& dialogs)
+{
+	UpdatedDialogs result;
+
+	const auto it = std::find_if(m_templates.begin(), m_templates.end(), [&id](const Template& item) { return item.id == id; });
+	IdMap sourceIds;
+	if (it == m_templates.end() || !mapToTemplate(phase.nodes(), it->phase.nodes(), sourceIds))
+	{
+		return result;
+	}
+
+	// the template gets the ids it had and keeps only the links inside the phase
+	PhaseNode templatePhase = it->phase;
+	templatePhase.setNodes(copyNodes(phase.nodes(), sourceIds));
+
+	for (auto clientIt = dialogs.begin(); clientIt != dialogs.end(); ++clientIt)
+	{
+		for (const Dialog& dialog : clientIt.value())
+		{
+			Dialog updated = dialog;
+			QSet<AbstractDialogNode::Id> removed;
+
+			for (int i = 0; i < dialog.phases.size(); ++i)
+			{
+				const QList<AbstractDialogNode*>& nodes = dialog.phases[i].nodes();
+
+				IdMap templateIds;
+				const Match match = matchNodes(nodes, it->phase.nodes(), templateIds);
+				if (match == Match::None)
+				{
+					continue;
+				}
+
+				if (match == Match::Same)
+				{
+					for (const AbstractDialogNode* node : nodes)
+					{
+						templateIds.insert(node->id(), node->id());
+					}
+				}
+
+				const QList<AbstractDialogNode*> updatedNodes = applyTemplate(nodes, templateIds, templatePhase.nodes(), match == Match::Same);
+				for (const AbstractDialogNode* node : nodes)
+				{
+					if (findNodeById(updatedNodes, node->id()) == updatedNodes.end())
+					{
+						removed.insert(node->id());
+					}
+				}
+
+				updated.phases[i].setNodes(updatedNodes);
+			}
+
+			if (updated.phases.isSharedWith(dialog.phases))
+			{
+				continue;
+			}
+
+			removeLinks(updated.phases, removed);
+			result[clientIt.key()].insert(dialog, updated);
+		}
+	}
+
+	it->phase = templatePhase;
+	rebuildIndex();
+	return result;
+}
+
+QByteArray PhaseTemplateLibrary::save() const
+{
+	QList<PhaseNode> phases;
+	for (const Template& item : m_templates)
+	{
+		phases.append(item.phase);
+	}
+
+	return DialogBinaryWriter().write(Dialog("", Dialog::Difficulty::Easy, "", phases, ErrorReplica(), 0.0, {}));
+}
+
+bool PhaseTemplateLibrary::load(const QByteArray& data)
+{
+	bool ok = false;
+	const Dialog dialog = DialogBinaryReader().read(data, ok);
+	if (!ok)
+	{
+		return false;
+	}
+
+	m_templates.clear();
+	for (const PhaseNode& phase : dialog.phases)
+	{
+		m_templates.append({ phase.id(), phase.name(), phase });
+	}
+
+	rebuildIndex();
+	return true;
+}
+
+size_t PhaseTemplateLibrary::nodesHash(const QList<AbstractDialogNode*>& nodes)
+{
+	// independent of the order of the nodes
+	size_t result = 0;
+	for (size_t key : structureKeys(nodes))
+	{
+		result += key;
+	}
+	return result;
+}
+
+PhaseTemplateLibrary::Match PhaseTemplateLibrary::matchNodes(const QList<AbstractDialogNode*>& nodes,
+	const QList<AbstractDialogNode*>& templateNodes, IdMap& templateIds)
+{
+	if (nodes.size() != templateNodes.size())
+	{
+		return Match::None;
+	}
+
+	const bool same = std::all_of(nodes.begin(), nodes.end(), [&templateNodes](AbstractDialogNode* node)
+	{
+		const auto it = findNodeById(templateNodes, node->id());
+		return it != templateNodes.end() && node->compare(*it);
+	});
+	if (same)
+	{
+		return Match::Same;
+	}
+
+	// nodes are paired by their content and the content of their neighbours, then the links are checked.
+	// Equal nodes with equal neighbours paired the wrong way leave the phase unmatched
+	const QHash<AbstractDialogNode::Id, size_t> keys = structureKeys(nodes);
+	const QHash<AbstractDialogNode::Id, size_t> templateKeys = structureKeys(templateNodes);
+
+	QMultiHash<size_t, AbstractDialogNode*> candidates;
+	for (AbstractDialogNode* node : templateNodes)
+	{
+		candidates.insert(templateKeys.value(node->id()), node);
+	}
+
+	templateIds.clear();
+	for (AbstractDialogNode* node : nodes)
+	{
+		const size_t key = keys.value(node->id());
+		auto it = candidates.find(key);
+		while (it != candidates.end() && it.key() == key && !node->compareContent(*it))
+		{
+			++it;
+		}
+
+		if (it == candidates.end() || it.key() != key)
+		{
+			return Match::None;
+		}
+
+		templateIds.insert(node->id(), (*it)->id());
+		candidates.erase(it);
+	}
+
+	for (const AbstractDialogNode* node : nodes)
+	{
+		const AbstractDialogNode* templateNode = *findNodeById(templateNodes, templateIds.value(node->id()));
+
+		QSet<AbstractDialogNode::Id> children;
+		for (const AbstractDialogNode::Id& child : node->childNodes())
+		{
+			if (templateIds.contains(child))
+			{
+				children.insert(templateIds.value(child));
+			}
+		}
+
+		QSet<AbstractDialogNode::Id> templateChildren;
+		for (const AbstractDialogNode::Id& child : templateNode->childNodes())
+		{
+			if (templateKeys.contains(child))
+			{
+				templateChildren.insert(child);
+			}
+		}
+
+		if (children != templateChildren)
+		{
+			return Match::None;
+		}
+	}
+
+	return Match::Remapped;
+}
+
+const PhaseTemplateLibrary::Template* PhaseTemplateLibrary::findTemplate(const PhaseNode& phase, Match& match, IdMap& templateIds) const
+{
+	if (phase.nodes().isEmpty())
+	{
+		return nullptr;
+	}
+
+	// node hashes are cached, so only phases with a matching hash are compared
+	const size_t hash = nodesHash(phase.nodes());
+	for (auto it = m_index.find(hash); it != m_index.end() && it.key() == hash; ++it)
+	{
+		const Template& item = m_templates[it.value()];
+		match = matchNodes(phase.nodes(), item.phase.nodes(), templateIds);
+		if (match != Match::None)
+		{
+			return &item;
+		}
+	}
+
+	return nullptr;
+}
+
+bool PhaseTemplateLibrary::mapToTemplate(const QList<AbstractDialogNode*>& nodes, const QList<AbstractDialogNode*>& templateNodes, IdMap& templateIds)
+{
+	if (matchNodes(nodes, templateNodes, templateIds) == Match::Remapped)
+	{
+		return true;
+	}
+
+	// a phase sharing the template ids, possibly edited since, its added nodes become template nodes with their ids
+	templateIds.clear();
+	bool sharesIds = false;
+	for (const AbstractDialogNode* node : nodes)
+	{
+		templateIds.insert(node->id(), node->id());
+		sharesIds |= findNodeById(templateNodes, node->id()) != templateNodes.end();
+	}
+	return sharesIds;
+}
+
+QList<AbstractDialogNode*> PhaseTemplateLibrary::applyTemplate(const QList<AbstractDialogNode*>& nodes, const IdMap& templateIds,
+	const QList<AbstractDialogNode*>& templateNodes, bool sharedIds)
+{
+	// the template ids are mapped back to the ids of the phase, added nodes get new ids unless the phase shares the template ids
+	IdMap phaseIds;
+	for (auto it = templateIds.begin(); it != templateIds.end(); ++it)
+	{
+		phaseIds.insert(it.value(), it.key());
+	}
+	for (const AbstractDialogNode* node : templateNodes)
+	{
+		if (!phaseIds.contains(node->id()))
+		{
+			phaseIds.insert(node->id(), sharedIds ? node->id() : createId());
+		}
+	}
+
+	QList<AbstractDialogNode*> result = copyNodes(templateNodes, phaseIds);
+
+	for (AbstractDialogNode*& node : result)
+	{
+		// the links to the other phases of the dialog are kept
+		const auto nodeIt = findNodeById(nodes, node->id());
+		if (nodeIt != nodes.end())
+		{
+			for (const AbstractDialogNode::Id& parent : (*nodeIt)->parentNodes())
+			{
+				if (!templateIds.contains(parent))
+				{
+					node->appendParent(parent);
+				}
+			}
+			for (const AbstractDialogNode::Id& child : (*nodeIt)->childNodes())
+			{
+				if (!templateIds.contains(child))
+				{
+					node->appendChild(child);
+				}
+			}
+		}
+
+		// nodes without links outside are shared with the template, like link() does
+		if (sharedIds)
+		{
+			const auto templateIt = findNodeById(templateNodes, node->id());
+			if (templateIt != templateNodes.end() && node->compare(*templateIt))
+			{
+				delete node;
+				node = *templateIt;
+			}
+		}
+	}
+
+	return result;
+}
+
+QList<AbstractDialogNode*> PhaseTemplateLibrary::copyNodes(const QList<AbstractDialogNode*>& nodes, const IdMap& ids)
+{
+	QList<AbstractDialogNode*> result;
+
+	for (const AbstractDialogNode* node : nodes)
+	{
+		AbstractDialogNode* copy = node->clone(false);
+		copy->setId(ids.value(node->id()));
+
+		for (const AbstractDialogNode::Id& parent : node->parentNodes())
+		{
+			copy->removeParent(parent);
+		}
+		for (const AbstractDialogNode::Id& child : node->childNodes())
+		{
+			copy->removeChild(child);
+		}
+
+		for (const AbstractDialogNode::Id& parent : node->parentNodes())
+		{
+			if (ids.contains(parent))
+			{
+				copy->appendParent(ids.value(parent));
+			}
+		}
+		for (const AbstractDialogNode::Id& child : node->childNodes())
+		{
+			if (ids.contains(child))
+			{
+				copy->appendChild(ids.value(child));
+			}
+		}
+
+		result.append(copy);
+	}
+
+	return result;
+}
+
+void PhaseTemplateLibrary::rebuildIndex()
+{
+	m_index.clear();
+	for (int i = 0; i < m_templates.size(); ++i)
+	{
+		m_index.insert(nodesHash(m_templates[i].phase.nodes()), i);
+	}
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "dialog.h"
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+namespace Core
+{
+
+// Phases reused by many dialogs, like greetings and farewells.
+// A dialog uses a template when one of its phases has the same nodes and links, possibly with other ids,
+// like a template inserted twice into one dialog. Phases with the template ids share the template node objects
+// instead of keeping copies, the nodes are copied only when a phase modifies them, see PhaseNode::mutableNode().
+// Links to other phases are not a part of a template. Name, score and replicas of the phase are its own,
+// they override the template ones.
+class PhaseTemplateLibrary
+{
+public:
+	struct Template
+	{
+		QString id;
+		QString name;
+		PhaseNode phase;
+	};
+
+	// source dialogs to the updated ones by client
+	typedef QMap<QString, QMap<Dialog, Dialog>> UpdatedDialogs;
+
+	QString add(const QString& name, const PhaseNode& phase);
+	void rename(const QString& id, const QString& name);
+	void remove(const QString& id);
+
+	const QVector<Template>& templates() const;
+	const Template* find(const QString& id) const;
+
+	// Id of the template with the nodes of the phase, empty if there is no such template
+	QString match(const PhaseNode& phase) const;
+	// A new phase using the template. It shares the template nodes unless their ids are used by the dialog
+	PhaseNode instantiate(const QString& id, const QSet<AbstractDialogNode::Id>& usedIds) const;
+	int usages(const QString& id, const QMap<QString, QList<Dialog>>& dialogs) const;
+
+	// Phases using templates share the template nodes afterwards
+	Dialog link(const Dialog& dialog) const;
+	QMap<QString, QList<Dialog>> link(const QMap<QString, QList<Dialog>>& dialogs) const;
+
+	// Whether the phase can be mapped onto the template nodes: it uses the template, possibly edited since, by its node ids,
+	// or it has the same nodes with other ids
+	bool canUpdate(const QString& id, const PhaseNode& phase) const;
+	// Replaces the template nodes with the nodes of the phase and propagates them to the phases using the template.
+	// The phases keep their node ids and their links to the other phases, the links to removed nodes are dropped.
+	// Does nothing if the phase can't be mapped onto the template, see canUpdate()
+	UpdatedDialogs update(const QString& id, const PhaseNode& phase, const QMap<QString, QList<Dialog>>& dialogs);
+
+	// The library is stored in the binary dialog format, templates are the phases of a dialog
+	QByteArray save() const;
+	bool load(const QByteArray& data);
+
+private:
+	typedef QHash<AbstractDialogNode::Id, AbstractDialogNode::Id> IdMap;
+
+	enum class Match
+	{
+		None,
+		// the same nodes with the same ids
+		Same,
+		// the same nodes with other ids
+		Remapped
+	};
+
+	// Independent of the node ids, so remapped phases have the same hash
+	static size_t nodesHash(const QList<AbstractDialogNode*>& nodes);
+	// Fills the template node ids by the phase node ids for a remapped phase
+	static Match matchNodes(const QList<AbstractDialogNode*>& nodes, const QList<AbstractDialogNode*>& templateNodes, IdMap& templateIds);
+	const Template* findTemplate(const PhaseNode& phase, Match& match, IdMap& templateIds) const;
+	// Fills the template node ids by the phase node ids, the ids of the nodes missing from the template are kept
+	static bool mapToTemplate(const QList<AbstractDialogNode*>& nodes, const QList<AbstractDialogNode*>& templateNodes, IdMap& templateIds);
+	// The template nodes with the ids of a phase using it and with the links of the phase to the other phases
+	static QList<AbstractDialogNode*> applyTemplate(const QList<AbstractDialogNode*>& nodes, const IdMap& templateIds,
+		const QList<AbstractDialogNode*>& templateNodes, bool sharedIds);
+	// Copies of the nodes with the ids replaced, links to the nodes without a new id are dropped
+	static QList<AbstractDialogNode*> copyNodes(const QList<AbstractDialogNode*>& nodes, const IdMap& ids);
+	void rebuildIndex();
+
+private:
+	QVector<Template> m_templates;
+	// nodes hash to the template indexes
+	QMultiHash<size_t, int> m_index;
+};
+
+}
@@ -0,0 +1,140 @@
+#include "stringpool.h"
+
+#include <QAtomicInteger>
+#include <QReadWriteLock>
+#include <QSet>
+
+namespace Core
+{
+
+namespace
+{
+
+struct Pool
+{
+	QSet<QString> texts;
+	QAtomicInteger<qint64> requests;
+	QAtomicInteger<qint64> savedBytes;
+	QReadWriteLock lock;
+};
+
+Pool& pool()
+{
+	static Pool s_pool;
+	return s_pool;
+}
+
+qint64 textBytes(const QString& text)
+{
+	return sizeof(QString::Data) + (text.size() + 1) * sizeof(QChar);
+}
+
+}
+
+QString StringPool::intern(const QString& text)
+{
+	if (text.isEmpty())
+	{
+		return text;
+	}
+
+	Pool& p = pool();
+	p.requests.fetchAndAddRelaxed(1);
+
+	const auto pooled = [&p, &text](const QString& result)
+	{
+		if (result.constData() != text.constData())
+		{
+			p.savedBytes.fetchAndAddRelaxed(textBytes(text));
+		}
+		return result;
+	};
+
+	{
+		QReadLocker locker(&p.lock);
+		const auto it = p.texts.constFind(text);
+		if (it != p.texts.constEnd())
+		{
+			return pooled(*it);
+		}
+	}
+
+	QWriteLocker locker(&p.lock);
+
+	// another thread could add it while the lock was released
+	const auto it = p.texts.constFind(text);
+	if (it != p.texts.constEnd())
+	{
+		return pooled(*it);
+	}
+
+	p.texts.insert(text);
+	return text;
+}
+
+QList<QString> StringPool::intern(const QList<QString>& texts)
+{
+	QList<QString> result;
+	result.reserve(texts.size());
+	for (const QString& text : texts)
+	{
+		result << intern(text);
+	}
+	return result;
+}
+
+void StringPool::intern(ErrorReplica& error)
+{
+	if (error.errorReplica)
+	{
+		error.errorReplica = intern(*error.errorReplica);
+	}
+
+	if (error.finishingExpectedWords)
+	{
+		error.finishingExpectedWords = intern(*error.finishingExpectedWords);
+	}
+
+	if (error.finishingReplica)
+	{
+		error.finishingReplica = intern(*error.finishingReplica);
+	}
+}
+
+int StringPool::purge()
+{
+	Pool& p = pool();
+	QWriteLocker locker(&p.lock);
+
+	int removed = 0;
+	for (auto it = p.texts.begin(); it != p.texts.end(); )
+	{
+		// copies are made under the lock only, so a detached text is used by the pool alone
+		if (it->isDetached())
+		{
+			it = p.texts.erase(it);
+			++removed;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	return removed;
+}
+
+StringPool::Statistics StringPool::statistics()
+{
+	Pool& p = pool();
+	QReadLocker locker(&p.lock);
+
+	Statistics result = { p.texts.size(), 0, p.requests.load(), p.savedBytes.load() };
+	for (const QString& text : p.texts)
+	{
+		result.bytes += textBytes(text);
+	}
+	return result;
+}
+
+}
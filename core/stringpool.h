@@ -0,0 +1,38 @@
+#pragma once
+
+#include "errorreplica.h"
+
+#include <QString>
+#include <QList>
+
+namespace Core
+{
+
+// Pool of texts repeated across dialogs: default error, finishing and repeat replicas, finishing expected words
+// and groups. Every phase created from the defaults or read from the backend used to keep its own copy of them,
+// interned texts share one implicitly shared buffer instead.
+// Texts stay in the pool until purge(), it's safe to use from several threads.
+class StringPool
+{
+public:
+	struct Statistics
+	{
+		int strings;
+		// Memory held by the pooled texts
+		qint64 bytes;
+		qint64 requests;
+		// Memory of the duplicates replaced by pooled texts since the start
+		qint64 savedBytes;
+	};
+
+	static QString intern(const QString& text);
+	static QList<QString> intern(const QList<QString>& texts);
+	static void intern(ErrorReplica& error);
+
+	// Drops texts that aren't used outside the pool anymore, returns their number
+	static int purge();
+
+	static Statistics statistics();
+};
+
+}
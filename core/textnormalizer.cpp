@@ -0,0 +1,212 @@
+#include "textnormalizer.h"
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace Core
+{
+
+namespace
+{
+
+const QChar s_yo(0x0451);
+const QChar s_ye(0x0435);
+
+bool isVowel(QChar c)
+{
+	static const QString s_vowels = QString::fromUtf8("аеиоуыэюя");
+	return s_vowels.contains(c);
+}
+
+// Endings are checked from the longest one, so the lists are sorted once
+QStringList sortedEndings(const char* endings)
+{
+	QStringList result = QString::fromUtf8(endings).split(' ', QString::SkipEmptyParts);
+	std::sort(result.begin(), result.end(), [](const QString& left, const QString& right) { return left.size() > right.size(); });
+	return result;
+}
+
+// Endings of the first group must follow а or я, which stays in the word
+bool removeEnding(QString& word, int region, const QStringList& endings, bool afterAOrYa = false)
+{
+	static const QChar s_a = QString::fromUtf8("а")[0];
+	static const QChar s_ya = QString::fromUtf8("я")[0];
+
+	for (const QString& ending : endings)
+	{
+		const int position = word.size() - ending.size();
+		if (position < region || !word.endsWith(ending))
+		{
+			continue;
+		}
+
+		if (afterAOrYa && (position == region || (word[position - 1] != s_a && word[position - 1] != s_ya)))
+		{
+			continue;
+		}
+
+		word.truncate(position);
+		return true;
+	}
+
+	return false;
+}
+
+// Start of the region after the first vowel that follows a consonant, starting from the given position
+int regionAfter(const QString& word, int start)
+{
+	for (int i = start + 1; i < word.size(); ++i)
+	{
+		if (!isVowel(word[i]) && isVowel(word[i - 1]))
+		{
+			return i + 1;
+		}
+	}
+
+	return word.size();
+}
+
+}
+
+QString TextNormalizer::normalize(const QString& text)
+{
+	QStringList result = words(text);
+	for (QString& word : result)
+	{
+		word = stem(word);
+	}
+
+	return result.join(' ');
+}
+
+QStringList TextNormalizer::words(const QString& text)
+{
+	// single pass over the buffer, letters are lowered and everything else becomes a separator
+	QString buffer(text.size(), QChar(' '));
+	const QChar* source = text.constData();
+	QChar* target = buffer.data();
+	for (int i = 0; i < text.size(); ++i)
+	{
+		const QChar c = source[i];
+		if (c.isLetterOrNumber())
+		{
+			const QChar lower = c.toLower();
+			target[i] = lower == s_yo ? s_ye : lower;
+		}
+	}
+
+	return buffer.split(' ', QString::SkipEmptyParts);
+}
+
+QString TextNormalizer::stem(const QString& word)
+{
+	// the same words repeat in all nodes and answers, cleared when grows too much
+	static const int s_maxCacheSize = 100000;
+	static QHash<QString, QString> s_cache;
+	static QReadWriteLock s_cacheLock;
+
+	{
+		QReadLocker locker(&s_cacheLock);
+		const auto it = s_cache.constFind(word);
+		if (it != s_cache.constEnd())
+		{
+			return *it;
+		}
+	}
+
+	const QString result = calculateStem(word);
+
+	QWriteLocker locker(&s_cacheLock);
+	if (s_cache.size() >= s_maxCacheSize)
+	{
+		s_cache.clear();
+	}
+	s_cache.insert(word, result);
+
+	return result;
+}
+
+QString TextNormalizer::calculateStem(const QString& word)
+{
+	static const QStringList s_perfectiveGerund1 = sortedEndings("в вши вшись");
+	static const QStringList s_perfectiveGerund2 = sortedEndings("ив ивши ившись ыв ывши ывшись");
+	static const QStringList s_reflexive = sortedEndings("ся сь");
+	static const QStringList s_adjective = sortedEndings("ее ие ые ое ими ыми ей ий ый ой ем им ым ом его ого ему ому их ых ую юю ая яя ою ею");
+	static const QStringList s_participle1 = sortedEndings("ем нн вш ющ щ");
+	static const QStringList s_participle2 = sortedEndings("ивш ывш ующ");
+	static const QStringList s_verb1 = sortedEndings("ла на ете йте ли й л ем н ло но ет ют ны ть ешь нно");
+	static const QStringList s_verb2 = sortedEndings("ила ыла ена ейте уйте ите или ыли ей уй ил ыл им ым ен ило ыло ено ят ует уют ит ыт ены ить ыть ишь ую ю");
+	static const QStringList s_noun = sortedEndings("а ев ов ие ье е иями ями ами еи ии и ией ей ой ий й иям ям ием ем ам ом о у ах иях ях ы ь ию ью ю ия ья я");
+	static const QStringList s_superlative = sortedEndings("ейш ейше");
+	static const QStringList s_derivational = sortedEndings("ост ость");
+	static const QString s_doubleN = QString::fromUtf8("нн");
+	static const QChar s_i = QString::fromUtf8("и")[0];
+	static const QChar s_softSign = QString::fromUtf8("ь")[0];
+
+	QString result = word;
+
+	int rv = 0;
+	while (rv < result.size() && !isVowel(result[rv]))
+	{
+		++rv;
+	}
+	++rv;
+	if (rv >= result.size())
+	{
+		return result;
+	}
+
+	const int r1 = regionAfter(result, 0);
+	const int r2 = regionAfter(result, r1);
+
+	// step 1
+	if (!removeEnding(result, rv, s_perfectiveGerund1, true) && !removeEnding(result, rv, s_perfectiveGerund2))
+	{
+		removeEnding(result, rv, s_reflexive);
+
+		if (removeEnding(result, rv, s_adjective))
+		{
+			if (!removeEnding(result, rv, s_participle1, true))
+			{
+				removeEnding(result, rv, s_participle2);
+			}
+		}
+		else if (!removeEnding(result, rv, s_verb1, true) && !removeEnding(result, rv, s_verb2))
+		{
+			removeEnding(result, rv, s_noun);
+		}
+	}
+
+	// step 2
+	if (result.size() > rv && result.endsWith(s_i))
+	{
+		result.chop(1);
+	}
+
+	// step 3
+	removeEnding(result, r2, s_derivational);
+
+	// step 4
+	if (result.endsWith(s_doubleN) && result.size() - 1 > rv)
+	{
+		result.chop(1);
+	}
+	else if (removeEnding(result, rv, s_superlative))
+	{
+		if (result.endsWith(s_doubleN))
+		{
+			result.chop(1);
+		}
+	}
+	else if (result.size() > rv && result.endsWith(s_softSign))
+	{
+		result.chop(1);
+	}
+
+	return result;
+}
+
+}
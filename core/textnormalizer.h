@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace Core
+{
+
+// Brings expected words and answers to the same form: lower case, ё replaced by е,
+// punctuation replaced by spaces and every word reduced to its stem (Snowball Russian stemmer),
+// so inflected forms of the same word are equal.
+// Stems are cached, it's safe to use from several threads.
+class TextNormalizer
+{
+public:
+	// Words of the result are separated by single spaces
+	static QString normalize(const QString& text);
+
+	// Lower cased words of the text without stemming
+	static QStringList words(const QString& text);
+
+	static QString stem(const QString& word);
+
+private:
+	static QString calculateStem(const QString& word);
+};
+
+}
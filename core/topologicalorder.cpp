@@ -0,0 +1,197 @@
+#include "topologicalorder.h"
+
+#include <algorithm>
+
+namespace Core
+{
+
+TopologicalOrder::TopologicalOrder()
+	: m_nextOrder(0)
+{
+}
+
+void TopologicalOrder::clear()
+{
+	m_vertices.clear();
+	m_nextOrder = 0;
+}
+
+void TopologicalOrder::addNode(const AbstractDialogNode* node)
+{
+	if (m_vertices.contains(node))
+	{
+		return;
+	}
+
+	Vertex vertex;
+	vertex.order = m_nextOrder++;
+	m_vertices.insert(node, vertex);
+}
+
+void TopologicalOrder::removeNode(const AbstractDialogNode* node)
+{
+	const auto it = m_vertices.find(node);
+	if (it == m_vertices.end())
+	{
+		return;
+	}
+
+	for (const AbstractDialogNode* parent : it->parents)
+	{
+		m_vertices[parent].children.remove(node);
+	}
+
+	for (const AbstractDialogNode* child : it->children)
+	{
+		m_vertices[child].parents.remove(node);
+	}
+
+	m_vertices.erase(it);
+}
+
+bool TopologicalOrder::createsCycle(const AbstractDialogNode* parent, const AbstractDialogNode* child) const
+{
+	if (parent == child)
+	{
+		return true;
+	}
+
+	if (!m_vertices.contains(parent) || !m_vertices.contains(child))
+	{
+		return false;
+	}
+
+	const int parentOrder = m_vertices.constFind(parent)->order;
+	if (parentOrder < m_vertices.constFind(child)->order)
+	{
+		return false;
+	}
+
+	Region region;
+	return !forwardRegion(child, parentOrder, parent, region);
+}
+
+bool TopologicalOrder::addEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	if (parent == child)
+	{
+		return false;
+	}
+
+	addNode(parent);
+	addNode(child);
+
+	Vertex& parentVertex = m_vertices[parent];
+	if (parentVertex.children.contains(child))
+	{
+		return true;
+	}
+
+	const int parentOrder = parentVertex.order;
+	const int childOrder = m_vertices[child].order;
+	if (childOrder < parentOrder)
+	{
+		Region forward;
+		if (!forwardRegion(child, parentOrder, parent, forward))
+		{
+			return false;
+		}
+
+		reorder(backwardRegion(parent, childOrder), forward);
+	}
+
+	m_vertices[parent].children.insert(child);
+	m_vertices[child].parents.insert(parent);
+	return true;
+}
+
+void TopologicalOrder::removeEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child)
+{
+	if (!m_vertices.contains(parent) || !m_vertices.contains(child))
+	{
+		return;
+	}
+
+	// the order stays valid when an edge disappears
+	m_vertices[parent].children.remove(child);
+	m_vertices[child].parents.remove(parent);
+}
+
+bool TopologicalOrder::forwardRegion(const AbstractDialogNode* from, int upperBound, const AbstractDialogNode* target, Region& region) const
+{
+	QSet<const AbstractDialogNode*> visited { from };
+	Region stack { from };
+
+	while (!stack.isEmpty())
+	{
+		const AbstractDialogNode* node = stack.takeLast();
+		region.append(node);
+
+		for (const AbstractDialogNode* child : m_vertices.constFind(node)->children)
+		{
+			if (child == target)
+			{
+				return false;
+			}
+
+			if (m_vertices.constFind(child)->order < upperBound && !visited.contains(child))
+			{
+				visited.insert(child);
+				stack.append(child);
+			}
+		}
+	}
+
+	return true;
+}
+
+TopologicalOrder::Region TopologicalOrder::backwardRegion(const AbstractDialogNode* from, int lowerBound) const
+{
+	QSet<const AbstractDialogNode*> visited { from };
+	Region stack { from };
+	Region region;
+
+	while (!stack.isEmpty())
+	{
+		const AbstractDialogNode* node = stack.takeLast();
+		region.append(node);
+
+		for (const AbstractDialogNode* parent : m_vertices.constFind(node)->parents)
+		{
+			if (m_vertices.constFind(parent)->order > lowerBound && !visited.contains(parent))
+			{
+				visited.insert(parent);
+				stack.append(parent);
+			}
+		}
+	}
+
+	return region;
+}
+
+void TopologicalOrder::reorder(Region backward, Region forward)
+{
+	const auto byOrder = [this](const AbstractDialogNode* left, const AbstractDialogNode* right)
+	{
+		return m_vertices[left].order < m_vertices[right].order;
+	};
+
+	std::sort(backward.begin(), backward.end(), byOrder);
+	std::sort(forward.begin(), forward.end(), byOrder);
+
+	// ancestors of the parent take the smallest of the freed positions, descendants of the child the rest
+	QList<int> orders;
+	for (const AbstractDialogNode* node : backward + forward)
+	{
+		orders.append(m_vertices[node].order);
+	}
+	std::sort(orders.begin(), orders.end());
+
+	int index = 0;
+	for (const AbstractDialogNode* node : backward + forward)
+	{
+		m_vertices[node].order = orders[index++];
+	}
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "abstractdialognode.h"
+
+#include <QHash>
+#include <QSet>
+
+namespace Core
+{
+
+// Dynamic topological order of the dialog graph (Pearce-Kelly).
+// Adding an edge only reorders the nodes between its ends, so checking whether an edge
+// would create a cycle costs time proportional to the affected part of the graph.
+class TopologicalOrder
+{
+public:
+	TopologicalOrder();
+
+	void clear();
+
+	void addNode(const AbstractDialogNode* node);
+	void removeNode(const AbstractDialogNode* node);
+
+	bool createsCycle(const AbstractDialogNode* parent, const AbstractDialogNode* child) const;
+
+	// Returns false and keeps the graph unchanged if the edge would create a cycle
+	bool addEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+	void removeEdge(const AbstractDialogNode* parent, const AbstractDialogNode* child);
+
+private:
+	struct Vertex
+	{
+		int order;
+		QSet<const AbstractDialogNode*> parents;
+		QSet<const AbstractDialogNode*> children;
+	};
+
+	typedef QList<const AbstractDialogNode*> Region;
+
+	bool forwardRegion(const AbstractDialogNode* from, int upperBound, const AbstractDialogNode* target, Region& region) const;
+	Region backwardRegion(const AbstractDialogNode* from, int lowerBound) const;
+	void reorder(Region backward, Region forward);
+
+private:
+	QHash<const AbstractDialogNode*, Vertex> m_vertices;
+	int m_nextOrder;
+};
+
+}
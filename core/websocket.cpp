@@ -7,16 +7,11 @@ namespace Core
 namespace
 {
 
-QString serialize(const QJsonObject& object)
+QByteArray serialize(const QJsonObject& object)
 {
 	return QJsonDocument(object).toJson(QJsonDocument::Compact);
 }
 
-QJsonObject deserialize(const QString& message)
-{
-	return QJsonDocument::fromJson(message.toUtf8()).object();
-}
-
 }
 
 WebSocket::WebSocket(const QUrl& url, QObject* parent)
@@ -46,13 +41,17 @@ int WebSocket::sendMessage(const QJsonObject& originalMessage)
 		message["queryId"] = queryId;
 	}
 
-	const int queryId = message["queryId"].toInt();
+	return sendMessage(message["queryId"].toInt(), serialize(message));
+}
 
+int WebSocket::sendMessage(int queryId, const QByteArray& message)
+{
 	if (m_webSocket.state() != QAbstractSocket::ConnectedState)
 	{
 		LOG << "Socket is closed, push to pending";
 
-		m_pendingMessages.push_back(message);
+		// a deep copy, a shared one would make the caller's reused buffer detach and lose its capacity
+		m_pendingMessages.push_back({ queryId, QByteArray(message.constData(), message.size()) });
 
 		if (m_webSocket.state() != QAbstractSocket::ConnectingState)
 		{
@@ -62,8 +61,9 @@ int WebSocket::sendMessage(const QJsonObject& originalMessage)
 		return queryId;
 	}
 
-	LOG << "Send message: " << serialize(message);
-	m_webSocket.sendTextMessage(serialize(message));
+	// whole messages are too large for the log, dialog updates take megabytes
+	LOG << "Send message" << ARG(queryId) << ARG2(message.size(), "size");
+	m_webSocket.sendTextMessage(QString::fromUtf8(message));
 
 	return queryId;
 }
@@ -76,8 +76,8 @@ void WebSocket::onConnected()
 
 	while (!m_pendingMessages.isEmpty())
 	{
-		auto message = m_pendingMessages.takeFirst();
-		sendMessage(message);
+		const auto message = m_pendingMessages.takeFirst();
+		sendMessage(message.first, message.second);
 	}
 
 	emit connected();
@@ -97,8 +97,8 @@ void WebSocket::onError(QAbstractSocket::SocketError errorCode)
 
 void WebSocket::onTextFrameReceived(const QString& frame, bool isLastFrame)
 {
-	LOG << "Received text frame: " << frame << "; isLastFrame: " << isLastFrame;
-	emit messageReceived(deserialize(frame));
+	LOG << "Received text frame" << ARG2(frame.size(), "size") << ARG(isLastFrame);
+	emit messageReceived(frame.toUtf8());
 }
 
 int WebSocket::generateQueryId()
@@ -17,11 +17,15 @@ public:
 	~WebSocket();
 
 	int sendMessage(const QJsonObject& message);
+	// Sends a message already serialized to compact UTF-8 JSON, it must contain the query id.
+	// The message is copied, so the caller may reuse its buffer
+	int sendMessage(int queryId, const QByteArray& message);
 
 signals:
 	void connected();
 	void disconnected();
-	void messageReceived(const QJsonObject& message);
+	// UTF-8 JSON of the message, it is parsed by the receiver so large messages aren't copied into a document first
+	void messageReceived(const QByteArray& message);
 	void error(const QString& errorMessage);
 
 private slots:
@@ -38,7 +42,8 @@ private:
 	QWebSocket m_webSocket;
 	int m_queryId;
 
-	QVector<QJsonObject> m_pendingMessages;
+	// query ids with serialized messages
+	QVector<QPair<int, QByteArray>> m_pendingMessages;
 };
 
 }
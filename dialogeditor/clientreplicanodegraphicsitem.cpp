@@ -16,12 +16,12 @@ int ClientReplicaNodeGraphicsItem::type() const
 
 Core::AbstractDialogNode* ClientReplicaNodeGraphicsItem::data()
 {
-	return m_replica;
+	return m_replica.data();
 }
 
 const Core::AbstractDialogNode* ClientReplicaNodeGraphicsItem::data() const
 {
-	return m_replica;
+	return m_replica.data();
 }
 
 QString ClientReplicaNodeGraphicsItem::getHeaderText() const
@@ -39,7 +39,8 @@ private:
 	void closeEditor();
 
 private:
-	Core::ClientReplicaNode* m_replica;
+	// Keeps the node alive while it is moved between phases
+	QExplicitlySharedDataPointer<Core::ClientReplicaNode> m_replica;
 	ClientReplicaEditor* m_editor;
 };
 
@@ -26,15 +26,15 @@ void DialogConstructorGraphicsScene::addConstructorItems()
 	phaseNode->setPos(QPoint(0, 0));
 	addItem(phaseNode);
 
-	NodeGraphicsItem* clientReplicaNode = new ClientReplicaNodeGraphicsItem(&m_replica, NodeGraphicsItem::Draggable, this);
+	NodeGraphicsItem* clientReplicaNode = new ClientReplicaNodeGraphicsItem(new Core::ClientReplicaNode(""), NodeGraphicsItem::Draggable, this);
 	clientReplicaNode->setPos(QPoint(0, 90));
 	addItem(clientReplicaNode);
 
-	NodeGraphicsItem* allowedExpectedWordsNode = new ExpectedWordsNodeGraphicsItem(&m_allowedExpectedWords, NodeGraphicsItem::Draggable, this);
+	NodeGraphicsItem* allowedExpectedWordsNode = new ExpectedWordsNodeGraphicsItem(new Core::ExpectedWordsNode({}, 0, false), NodeGraphicsItem::Draggable, this);
 	allowedExpectedWordsNode->setPos(QPoint(0, 180));
 	addItem(allowedExpectedWordsNode);
 
-	NodeGraphicsItem* forbiddenExpectedWordsNode = new ExpectedWordsNodeGraphicsItem(&m_forbiddenExpectedWords, NodeGraphicsItem::Draggable, this);
+	NodeGraphicsItem* forbiddenExpectedWordsNode = new ExpectedWordsNodeGraphicsItem(new Core::ExpectedWordsNode({}, 0, true), NodeGraphicsItem::Draggable, this);
 	forbiddenExpectedWordsNode->setPos(QPoint(0, 270));
 	addItem(forbiddenExpectedWordsNode);
 
@@ -22,7 +22,4 @@ private:
 private:
 	Core::Dialog m_dialog;
 	Core::PhaseNode m_phase { "", 0, false, {}, {} };
-	Core::ClientReplicaNode m_replica { "" };
-	Core::ExpectedWordsNode m_allowedExpectedWords { {}, 0, false };
-	Core::ExpectedWordsNode m_forbiddenExpectedWords { {}, 0, true };
 };
@@ -10,10 +10,15 @@
 #include "arrowlinegraphicsitem.h"
 #include "saveasdialog.h"
 #include "groupsdialog.h"
+#include "passratewindow.h"
+
+#include "core/dialoganalysis.h"
 
 #include "logger.h"
 #include <QPushButton>
 #include <QMessageBox>
+#include <QMenu>
+#include <QTimer>
 
 #include <set>
 
@@ -58,79 +63,6 @@ bool nodesAlreadyConnected(NodeGraphicsItem* parent, NodeGraphicsItem* child)
 	return existingLinkIt != outcomingLinks.end();
 }
 
-QList<Core::AbstractDialogNode*> gatherNodes(const QMap<PhaseGraphicsItem*, QList<NodeGraphicsItem*>>& dialog)
-{
-	QList<Core::AbstractDialogNode*> result;
-
-	for (PhaseGraphicsItem* phase : dialog.keys())
-	{
-		for (NodeGraphicsItem* node : dialog[phase])
-		{
-			result << node->data()->clone(false);
-		}
-	}
-
-	return result;
-}
-
-typedef QList<Core::AbstractDialogNode*> NodesPath;
-
-QList<NodesPath> findPathsBetweenNodes(Core::AbstractDialogNode* childNode, Core::AbstractDialogNode* parentNode, const QList<Core::AbstractDialogNode*>& nodes, bool compareWithSelf = true)
-{
-	LOG << "searching path to root from " << childNode->id();
-
-	if (compareWithSelf && childNode == parentNode)
-	{
-		LOG << childNode->id() << " is target node (" << parentNode->id() << ")";
-		return { { childNode } };
-	}
-
-	QList<NodesPath> path;
-
-	for (const Core::AbstractDialogNode::Id& parentId : childNode->parentNodes())
-	{
-		const auto parentNodeIt = Core::findNodeById(nodes.begin(), nodes.end(), parentId);
-		if (parentNodeIt == nodes.end())
-		{
-			LOG << childNode->id() << " is target node (" << parentNode->id() << ")";
-			return { { childNode } };
-		}
-
-		QList<NodesPath> pathToParent = findPathsBetweenNodes(*parentNodeIt, parentNode, nodes);
-		for (NodesPath& path : pathToParent)
-		{
-			path.prepend(childNode);
-		}
-
-		LOG << "found " << pathToParent.length() << " paths to " << childNode->id();
-
-		path.append(pathToParent);
-	}
-
-	return path;
-}
-
-bool hasCycles(Core::AbstractDialogNode* childNode, const QList<Core::AbstractDialogNode*>& nodes)
-{
-	QList<NodesPath> paths = findPathsBetweenNodes(childNode, childNode, nodes, false);
-
-	LOG << "Found " << paths.size() << " potential paths to " << childNode->id() << " from itself";
-
-	for (const NodesPath& path : paths)
-	{
-		QStringList nodes;
-		std::transform(path.begin(), path.end(), std::back_inserter(nodes), [](Core::AbstractDialogNode* node){ return node->id(); });
-
-		LOG << "Path: " << nodes.join("->");
-	}
-
-	paths.erase(
-		std::remove_if(paths.begin(), paths.end(), [childNode](const NodesPath& path) { return path.length() == 1 && path[0] == childNode; }),
-		paths.end());
-
-	return !paths.isEmpty();
-}
-
 QList<PhaseGraphicsInfo> getPhasesGraphicsInfo(QList<PhaseGraphicsItem*> phases)
 {
 	QList<PhaseGraphicsInfo> result;
@@ -179,6 +111,7 @@ DialogEditorWindow::DialogEditorWindow(const Core::Client& client, const Core::D
 {
 	m_ui->setupUi(this);
 	setAttribute(Qt::WA_DeleteOnClose, true);
+	m_validator.setDialog(&m_dialog);
 	setModal(true);
 
 	m_ui->nameEdit->setText(dialog.name);
@@ -230,6 +163,13 @@ DialogEditorWindow::DialogEditorWindow(const Core::Client& client, const Core::D
 
 		m_dialog.phases = getPhases();
 
+		// the journal is kept until the dialog is stored on the server
+		m_saved = true;
+		if (m_journal)
+		{
+			m_journal->flush();
+		}
+
 		emit dialogModified(m_dialog, graphicsInfo);
 
 		close();
@@ -256,6 +196,23 @@ DialogEditorWindow::DialogEditorWindow(const Core::Client& client, const Core::D
 	connect(m_ui->connectNodesButton, &QPushButton::clicked, this, &DialogEditorWindow::onConnectNodesClicked);
 	connect(m_ui->removeStandaloneNodesButton, &QPushButton::clicked, this, &DialogEditorWindow::removeStandaloneNodes);
 
+	m_ui->insertTemplateButton->hide();
+	connect(m_ui->insertTemplateButton, &QPushButton::clicked, this, &DialogEditorWindow::showPhaseTemplates);
+
+	m_ui->undoButton->setShortcut(QKeySequence::Undo);
+	m_ui->redoButton->setShortcut(QKeySequence::Redo);
+	connect(m_ui->undoButton, &QPushButton::clicked, this, &DialogEditorWindow::undo);
+	connect(m_ui->redoButton, &QPushButton::clicked, this, &DialogEditorWindow::redo);
+
+	connect(m_ui->passRateButton, &QPushButton::clicked, [this]()
+	{
+		Core::Dialog dialog = m_dialog;
+		dialog.phases = getPhases();
+
+		PassRateWindow* window = new PassRateWindow(Core::DialogSnapshot(dialog), this);
+		window->show();
+	});
+
 	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeSelectionChanged, this, &DialogEditorWindow::onNodeSelectionChanged);
 	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeSelectionChanged, this, &DialogEditorWindow::updateConnectControls);
 
@@ -286,7 +243,24 @@ DialogEditorWindow::DialogEditorWindow(const Core::Client& client, const Core::D
 
 	connect(m_dialogGraphicsScene, &DialogGraphicsScene::primaryPhaseChanged, this, &DialogEditorWindow::onPrimaryPhaseChanged);
 
+	// a series of changes, like removing of the standalone nodes, becomes one undo step
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeAdded, this, &DialogEditorWindow::scheduleHistoryRecord);
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeRemoved, this, &DialogEditorWindow::scheduleHistoryRecord);
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeChanged, this, &DialogEditorWindow::scheduleHistoryRecord);
+
+	const auto scheduleHistoryRecordForBoth = [this](NodeGraphicsItem* first, NodeGraphicsItem* second)
+	{
+		scheduleHistoryRecord(first);
+		scheduleHistoryRecord(second);
+	};
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeAddedToPhase, this, scheduleHistoryRecordForBoth);
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodeRemovedFromPhase, this, scheduleHistoryRecordForBoth);
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodesConnected, this, scheduleHistoryRecordForBoth);
+	connect(m_dialogGraphicsScene, &DialogGraphicsScene::nodesDisconnected, this, scheduleHistoryRecordForBoth);
+
 	m_dialogGraphicsScene->setDialog(&m_dialog, phasesGraphicsInfo);
+	// the loaded dialog is the first state, even an empty one
+	recordHistory();
 
 	m_ui->dialogGraphicsView->setScene(m_dialogGraphicsScene);
 	m_ui->dialogGraphicsView->setMinRatio(50.0);
@@ -299,6 +273,12 @@ DialogEditorWindow::DialogEditorWindow(const Core::Client& client, const Core::D
 
 DialogEditorWindow::~DialogEditorWindow()
 {
+	// closing without saving drops the changes on purpose
+	if (m_journal && !m_saved)
+	{
+		m_journal->discard();
+	}
+
 	delete m_ui;
 }
 
@@ -322,12 +302,45 @@ void DialogEditorWindow::enableSaveAs(const QList<Core::Client>& clients, const
 			m_dialog.name = newDialogName;
 			m_dialog.phases = getPhases();
 
+			m_saved = true;
+			if (m_journal)
+			{
+				m_journal->flush();
+			}
+
 			emit dialogCreated(client, m_dialog, graphicsInfo);
 			close();
 		});
 	});
 }
 
+void DialogEditorWindow::enableAutosave(const QString& journalPath, const DialogJournal::Origin& origin)
+{
+	m_journal.reset(new DialogJournal(journalPath, origin, [this]() { return journalState(); }));
+	// the first record is the opened dialog
+	m_journal->touch();
+}
+
+void DialogEditorWindow::enablePhaseTemplates(const Core::PhaseTemplateLibrary* phaseTemplates)
+{
+	m_phaseTemplates = phaseTemplates;
+	m_ui->insertTemplateButton->show();
+}
+
+void DialogEditorWindow::showNode(const Core::AbstractDialogNode::Id& id)
+{
+	const auto it = std::find_if(m_nodeItems.begin(), m_nodeItems.end(),
+		[&id](const NodeGraphicsItem* node) { return node->data()->id() == id; });
+	if (it == m_nodeItems.end())
+	{
+		return;
+	}
+
+	m_dialogGraphicsScene->clearSelection();
+	(*it)->setSelected(true);
+	m_ui->dialogGraphicsView->centerOn(*it);
+}
+
 void DialogEditorWindow::onNodeAdded(NodeGraphicsItem* /*node*/)
 {
 }
@@ -354,15 +367,47 @@ void DialogEditorWindow::onNodeSelectionChanged(NodeGraphicsItem* node, bool val
 
 void DialogEditorWindow::updateSaveControls()
 {
-	QString error;
-	if (!validateDialog(error))
+	if (m_journal)
+	{
+		m_journal->touch();
+	}
+
+	QStringList errors;
+	if (!validateDialog(errors))
 	{
-		showError(error);
+		showError(errors.first());
+		m_ui->errorTextLabel->setToolTip(errors.join("\n"));
 	}
 	else
 	{
 		hideError();
 	}
+
+	// the analysis is updated once after a series of changes, like loading of the dialog
+	if (!m_analysisScheduled)
+	{
+		m_analysisScheduled = true;
+		QTimer::singleShot(0, this, &DialogEditorWindow::updateAnalysis);
+	}
+}
+
+void DialogEditorWindow::updateAnalysis()
+{
+	m_analysisScheduled = false;
+
+	// the graph must be correct to order the phases, other errors don't matter
+	m_ui->passRateButton->setEnabled(m_validator.isValid());
+
+	if (!m_validator.isValid())
+	{
+		m_ui->analysisLabel->setText("Анализ доступен после исправления ошибок");
+		return;
+	}
+
+	Core::Dialog dialog = m_dialog;
+	dialog.phases = getPhases();
+
+	m_ui->analysisLabel->setText(Core::DialogAnalysis(dialog).summary().join("\n"));
 }
 
 void DialogEditorWindow::showError(QString text)
@@ -381,6 +426,7 @@ void DialogEditorWindow::hideError()
 	m_ui->errorIconLabel->hide();
 
 	m_ui->errorTextLabel->setText("");
+	m_ui->errorTextLabel->setToolTip("");
 	m_ui->errorTextLabel->hide();
 
 	m_ui->saveButton->setEnabled(true);
@@ -489,20 +535,11 @@ void DialogEditorWindow::updateConnectControls()
 		return;
 	}
 
-	// TODO: optimize
-	/*const Core::AbstractDialogNode::Id childNodeId = childNode->data()->id();
-	const Core::AbstractDialogNode::Id parentNodeId = parentNode->data()->id();
-
-	QList<Core::AbstractDialogNode*> nodes = gatherNodes(m_nodesByPhase);
-	auto childNodeIt = Core::findNodeById(nodes.begin(), nodes.end(), childNodeId);
-	auto parentNodeIt = Core::findNodeById(nodes.begin(), nodes.end(), parentNodeId);
-	(*childNodeIt)->appendParent(parentNodeId);
-	(*parentNodeIt)->appendChild(childNodeId);
-	if (hasCycles(*childNodeIt, nodes))
+	if (m_nodesOrder.createsCycle(parentNode->data(), childNode->data()))
 	{
 		m_ui->connectNodesButton->setEnabled(false);
 		return;
-	}*/
+	}
 
 	if (parentNode->type() == ExpectedWordsNodeGraphicsItem::Type && childNode->type() == ExpectedWordsNodeGraphicsItem::Type)
 	{
@@ -552,6 +589,12 @@ void DialogEditorWindow::nodeAdded(NodeGraphicsItem* node)
 			m_dialog.phases.append(*phaseNode);
 		}
 	}
+	else
+	{
+		m_nodesOrder.addNode(node->data());
+	}
+
+	m_validator.addNode(node->data());
 }
 
 void DialogEditorWindow::nodeRemoved(NodeGraphicsItem* node)
@@ -560,6 +603,8 @@ void DialogEditorWindow::nodeRemoved(NodeGraphicsItem* node)
 
 	Q_ASSERT(m_nodeItems.contains(node));
 	m_nodeItems.removeOne(node);
+	m_validator.removeNode(node->data());
+	m_nodesOrder.removeNode(node->data());
 
 	if (node->type() == PhaseGraphicsItem::Type)
 	{
@@ -583,6 +628,8 @@ void DialogEditorWindow::nodeRemoved(NodeGraphicsItem* node)
 
 void DialogEditorWindow::nodeChanged(NodeGraphicsItem* node)
 {
+	m_validator.nodeChanged(node->data());
+
 	if (node->type() != PhaseGraphicsItem::Type)
 	{
 		return;
@@ -616,6 +663,12 @@ void DialogEditorWindow::nodesConnected(NodeGraphicsItem* parent, NodeGraphicsIt
 
 	parentNode->appendChild(childNode->id());
 	childNode->appendParent(parentNode->id());
+
+	m_validator.nodesConnected(parentNode, childNode);
+	if (!m_nodesOrder.addEdge(parentNode, childNode))
+	{
+		LOG << "link " << parentNode->id() << "->" << childNode->id() << " creates a cycle";
+	}
 }
 
 void DialogEditorWindow::nodesDisconnected(NodeGraphicsItem* parent, NodeGraphicsItem* child)
@@ -631,6 +684,9 @@ void DialogEditorWindow::nodesDisconnected(NodeGraphicsItem* parent, NodeGraphic
 	Q_ASSERT(parentNode->childNodes().contains(childNode->id()));
 	parentNode->removeChild(childNode->id());
 	childNode->removeParent(parentNode->id());
+
+	m_validator.nodesDisconnected(parentNode, childNode);
+	m_nodesOrder.removeEdge(parentNode, childNode);
 }
 
 void DialogEditorWindow::nodeAddedToPhase(NodeGraphicsItem* node, PhaseGraphicsItem* phase)
@@ -640,6 +696,8 @@ void DialogEditorWindow::nodeAddedToPhase(NodeGraphicsItem* node, PhaseGraphicsI
 
 	m_nodesByPhase[phase].append(node);
 	phase->data()->as<Core::PhaseNode>()->appendNode(node->data());
+
+	m_validator.nodeAddedToPhase(node->data(), phase->data());
 }
 
 void DialogEditorWindow::nodeRemovedFromPhase(NodeGraphicsItem* node, PhaseGraphicsItem* phase)
@@ -649,6 +707,8 @@ void DialogEditorWindow::nodeRemovedFromPhase(NodeGraphicsItem* node, PhaseGraph
 
 	m_nodesByPhase[phase].removeOne(node);
 	phase->data()->as<Core::PhaseNode>()->removeNode(node->data());
+
+	m_validator.nodeRemovedFromPhase(node->data(), phase->data());
 }
 
 void DialogEditorWindow::onPrimaryPhaseChanged(PhaseGraphicsItem* phase)
@@ -657,202 +717,220 @@ void DialogEditorWindow::onPrimaryPhaseChanged(PhaseGraphicsItem* phase)
 	m_dialogConstructorGraphicsScene->setDefaults(phaseNode->errorReplica(), phaseNode->repeatReplica());
 }
 
-bool DialogEditorWindow::validateDialog() const
+void DialogEditorWindow::showPhaseTemplates()
 {
-	QString error;
-	return validateDialog(error);
+	Q_ASSERT(m_phaseTemplates);
+
+	QMenu menu(this);
+	for (const Core::PhaseTemplateLibrary::Template& item : m_phaseTemplates->templates())
+	{
+		const QString id = item.id;
+		menu.addAction(item.name, [this, id]() { insertPhaseTemplate(id); });
+	}
+
+	if (menu.isEmpty())
+	{
+		menu.addAction("Нет шаблонов")->setEnabled(false);
+	}
+
+	menu.exec(m_ui->insertTemplateButton->mapToGlobal(m_ui->insertTemplateButton->rect().bottomLeft()));
 }
 
-bool DialogEditorWindow::validateDialog(QString& error) const
+// The phase shares the template nodes, they are cloned for editing like the nodes of the loaded phases
+void DialogEditorWindow::insertPhaseTemplate(const QString& id)
 {
-	if (m_dialog.name.trimmed().isEmpty())
+	const Core::PhaseTemplateLibrary::Template* item = m_phaseTemplates->find(id);
+	if (!item)
 	{
-		error = "Имя диалога не может быть пустым";
-		return false;
+		return;
 	}
 
-	if (!m_nameValidator(m_dialog.name, m_dialog.difficulty))
+	QSet<Core::AbstractDialogNode::Id> usedIds;
+	QSet<QString> phaseNames;
+	for (NodeGraphicsItem* node : m_nodeItems)
 	{
-		error = "Имя диалога должно быть уникальным";
-		return false;
+		usedIds.insert(node->data()->id());
+		if (node->type() == PhaseGraphicsItem::Type)
+		{
+			phaseNames.insert(node->data()->as<Core::PhaseNode>()->name());
+		}
 	}
 
-	if (m_dialog.groups.isEmpty())
+	Core::PhaseNode phase = m_phaseTemplates->instantiate(id, usedIds);
+
+	// the layout of the phases is stored by name
+	QString name = item->name;
+	for (int i = 2; phaseNames.contains(name); ++i)
 	{
-		error = "Нужно выбрать хотя бы одну группу";
-		return false;
+		name = QString("%1 (%2)").arg(item->name).arg(i);
 	}
+	phase.setName(name);
+
+	m_dialog.phases.append(phase);
+	m_dialogGraphicsScene->addPhase();
+}
 
-	const Core::ErrorReplica& errorReplica = m_dialog.errorReplica;	
-	if (errorReplica.errorReplica && (*errorReplica.errorReplica).trimmed().isEmpty())
+void DialogEditorWindow::scheduleHistoryRecord(NodeGraphicsItem* node)
+{
+	if (m_restoring)
 	{
-		error = "Ошибочная реплика не может быть пустой";
-		return false;
+		return;
 	}
 
-	if (errorReplica.errorPenalty && (*errorReplica.errorPenalty) < 0.0)
+	// the history copies only the changed nodes and rebuilds only their phases
+	m_historyChanges.insert(node->data()->id());
+	if (node->getPhase())
 	{
-		error = "Количество штрафных баллов должно быть больше или равно 0";
-		return false;
+		m_historyChanges.insert(node->getPhase()->data()->id());
 	}
 
-	if (errorReplica.finishingReplica && (*errorReplica.finishingReplica).trimmed().isEmpty())
+	if (m_historyScheduled)
 	{
-		error = "Завершающая реплика не может быть пустой";
-		return false;
+		return;
 	}
 
-	if (errorReplica.finishingExpectedWords && (*errorReplica.finishingExpectedWords).isEmpty())
+	m_historyScheduled = true;
+	QTimer::singleShot(0, this, &DialogEditorWindow::recordHistory);
+}
+
+void DialogEditorWindow::recordHistory()
+{
+	if (m_restoring)
 	{
-		error = "Завершающие опорные слова не могут быть пустыми";
-		return false;
+		return;
 	}
 
-	QVector<Core::AbstractDialogNode*> nodes;
-	std::transform(m_nodeItems.begin(), m_nodeItems.end(), std::back_inserter(nodes), [](NodeGraphicsItem* item) { return item->data(); });
+	m_historyScheduled = false;
 
-	if (nodes.isEmpty())
+	QList<const Core::PhaseNode*> phases;
+	QList<PhaseGraphicsItem*> phaseItems;
+	for (NodeGraphicsItem* node : m_nodeItems)
 	{
-		error = "Диалог не может быть пустым";
-		return false;
+		if (node->type() == PhaseGraphicsItem::Type)
+		{
+			PhaseGraphicsItem* phaseItem = qgraphicsitem_cast<PhaseGraphicsItem*>(node);
+			phaseItems.append(phaseItem);
+			phases.append(phaseItem->data()->as<const Core::PhaseNode>());
+		}
 	}
 
-	const int nodesWithoutParents = std::count_if(nodes.begin(), nodes.end(),
-		[](Core::AbstractDialogNode* node)
-		{
-			if (node->type() == Core::ClientReplicaNode::Type ||
-				node->type() == Core::ExpectedWordsNode::Type)
-			{
-				return node->parentNodes().isEmpty();
-			}
+	m_history.record(phases, getPhasesGraphicsInfo(phaseItems), m_historyChanges);
+	m_historyChanges.clear();
+	updateHistoryControls();
+}
 
-			return false;
-		});
+void DialogEditorWindow::undo()
+{
+	// the last change may still wait to be recorded
+	if (m_historyScheduled)
+	{
+		recordHistory();
+	}
+
+	if (m_history.canUndo())
+	{
+		restore(m_history.undo());
+	}
+}
 
-	if (nodesWithoutParents > 1)
+void DialogEditorWindow::redo()
+{
+	if (m_historyScheduled)
 	{
-		error = "Должен быть только 1 узел без входящих стрелок (" + QString::number(nodesWithoutParents) + ")";
-		return false;
+		recordHistory();
 	}
 
-	if (m_dialog.difficulty == Core::Dialog::Difficulty::Easy)
+	if (m_history.canRedo())
 	{
-		const int nodesWithoutChilds = std::count_if(nodes.begin(), nodes.end(),
-			[](Core::AbstractDialogNode* node)
-			{
-				if (node->type() == Core::ClientReplicaNode::Type ||
-					node->type() == Core::ExpectedWordsNode::Type)
-				{
-					return node->childNodes().isEmpty();
-				}
+		restore(m_history.redo());
+	}
+}
 
-				return false;
-			});
+void DialogEditorWindow::updateHistoryControls()
+{
+	m_ui->undoButton->setEnabled(m_history.canUndo());
+	m_ui->redoButton->setEnabled(m_history.canRedo());
+}
+
+// The scene is rebuilt from the snapshot, which stays unchanged
+void DialogEditorWindow::restore(const DialogHistory::Snapshot& snapshot)
+{
+	m_restoring = true;
 
-		if (nodesWithoutChilds > 1)
+	const QVector<NodeGraphicsItem*> items = m_nodeItems;
+
+	// the editor state is reset below at once instead of node by node
+	m_dialogGraphicsScene->blockSignals(true);
+	for (NodeGraphicsItem* item : items)
+	{
+		if (item->type() != PhaseGraphicsItem::Type)
 		{
-			error = "Должен быть только 1 узел без выходящих стрелок (" + QString::number(nodesWithoutChilds) + ")";
-			return false;
+			m_dialogGraphicsScene->removeNodeFromScene(item);
 		}
 	}
-
-	if (m_dialog.difficulty == Core::Dialog::Difficulty::Easy)
+	for (NodeGraphicsItem* item : items)
 	{
-		const auto incorrectLinksNodeIt = std::find_if(nodes.begin(), nodes.end(),
-			[](Core::AbstractDialogNode* node)
-			{
-				if (node->type() != Core::ClientReplicaNode::Type &&
-					node->type() != Core::ExpectedWordsNode::Type)
-				{
-					return false;
-				}
-
-				return node->parentNodes().size() > 1 || node->childNodes().size() > 1;
-			});
-		if (incorrectLinksNodeIt != nodes.end())
+		if (item->type() == PhaseGraphicsItem::Type)
 		{
-			error = "Каждый узел должен иметь не больше 1 входящей и 1 выходящей стрелки";
-			return false;
+			m_dialogGraphicsScene->removeNodeFromScene(item);
 		}
 	}
+	m_dialogGraphicsScene->blockSignals(false);
+	qDeleteAll(items);
 
-	const auto invalidNodeIt = std::find_if(nodes.begin(), nodes.end(),
-		[](Core::AbstractDialogNode* node)
-		{
-			return !node->validate();
-		});
-	if (invalidNodeIt != nodes.end())
-	{
-		error = "Каждый узел должен быть заполнен корректно";
-		return false;
-	}
+	m_nodeItems.clear();
+	m_nodesByPhase.clear();
+	m_selectedNodes.clear();
+	m_validator.clear();
+	m_nodesOrder.clear();
 
-	const auto emptyPhaseIt = std::find_if(m_nodesByPhase.begin(), m_nodesByPhase.end(),
-		[](const QList<NodeGraphicsItem*>& nodesByPhase)
-		{
-			return nodesByPhase.isEmpty();
-		});
-	if (emptyPhaseIt != m_nodesByPhase.end())
-	{
-		error = "Фазы не могут быть пустыми";
-		return false;
-	}
+	// the phases share their data with the snapshot, the scene clones the shared nodes before the items edit them
+	m_dialog.phases = snapshot.phases;
+	m_dialogGraphicsScene->setDialog(&m_dialog, snapshot.graphicsInfo);
+	m_historyChanges.clear();
 
-	const auto nodeOutsidePhaseIt = std::find_if(nodes.begin(), nodes.end(),
-		[this](Core::AbstractDialogNode* node)
-		{
-			if (node->type() == Core::PhaseNode::Type)
-			{
-				return false;
-			}
+	m_restoring = false;
 
-			for (const auto& phase : m_nodesByPhase.keys())
-			{
-				const auto& nodes = m_nodesByPhase.value(phase);
-				const auto existingNodeIt = std::find_if(nodes.begin(), nodes.end(), [node](NodeGraphicsItem* item) { return item->data() == node; });
-				if (existingNodeIt != nodes.end())
-				{
-					return false;
-				}
-			}
+	updateSaveControls();
+	updateConnectControls();
+	updateRemoveControls();
+	updateHistoryControls();
+}
 
-			return true;
-		});
-	if (nodeOutsidePhaseIt != nodes.end())
+// The phases come from the history, so the journal writes only the phases changed since its last record
+DialogJournal::State DialogEditorWindow::journalState()
+{
+	if (m_historyScheduled)
 	{
-		error = "Каждый узел должен находиться в какой-либо фазе";
-		return false;
+		recordHistory();
 	}
 
-	// TODO: use phases from dialog, just sort them
-	PhaseGraphicsItem* phase = findFirstPhase();
-	if (phase)
-	{
-		while (phase)
-		{
-			const QList<PhaseGraphicsItem*> nextPhases = findNextPhase(phase);
-			if (nextPhases.empty())
-			{
-				phase = nullptr;
-				continue;
-			}
+	DialogJournal::State state;
+	state.dialog = m_dialog;
+	state.dialog.phases = m_history.current().phases;
+	state.graphicsInfo = m_history.current().graphicsInfo;
+	return state;
+}
 
-			const bool allPhasesAreSame = std::set<PhaseGraphicsItem*>(nextPhases.begin(), nextPhases.end()).size() <= 1;
-			if (!allPhasesAreSame)
-			{
-				error = "Ветвление по фазам недопустимо (" + phase->data()->as<Core::PhaseNode>()->name() + ")";
-				return false;
-			}
-			phase = *nextPhases.begin();
-		}
+bool DialogEditorWindow::validateDialog()
+{
+	QStringList errors;
+	return validateDialog(errors);
+}
+
+bool DialogEditorWindow::validateDialog(QStringList& errors)
+{
+	for (const Core::DialogValidator::Violation& violation : m_validator.violations())
+	{
+		errors.append(violation.message);
 	}
-	else
+
+	if (!m_dialog.name.trimmed().isEmpty() && !m_nameValidator(m_dialog.name, m_dialog.difficulty))
 	{
-		error = "wut";
-		return false;
+		errors.prepend("Имя диалога должно быть уникальным");
 	}
 
-	return true;
+	return errors.isEmpty();
 }
 
 QList<Core::PhaseNode> DialogEditorWindow::getPhases()
@@ -963,13 +1041,6 @@ QList<PhaseGraphicsItem*> DialogEditorWindow::findNextPhase(PhaseGraphicsItem* c
 Core::PhaseNode DialogEditorWindow::getPhaseNode(PhaseGraphicsItem* phaseItem)
 {
 	Core::PhaseNode* phaseNode = phaseItem->data()->as<Core::PhaseNode>();
-
-	QList<Core::AbstractDialogNode*> nodes;
-	for (Core::AbstractDialogNode* node : phaseNode->nodes())
-	{
-		nodes.append(node->clone(false));
-	}
-
 	return Core::PhaseNode(*phaseNode);
 }
 
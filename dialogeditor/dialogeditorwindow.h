@@ -2,7 +2,12 @@
 
 #include "dialoggraphicsscene.h"
 #include "dialoggraphicsinfo.h"
+#include "dialoghistory.h"
+#include "dialogjournal.h"
 #include "core/client.h"
+#include "core/dialogvalidator.h"
+#include "core/phasetemplatelibrary.h"
+#include "core/topologicalorder.h"
 #include <QWidget>
 #include <QDialog>
 #include <memory>
@@ -27,6 +32,15 @@ public:
 	typedef std::function<bool(const Core::Client& client, const QString&, Core::Dialog::Difficulty)> NameValidatorEx;
 	void enableSaveAs(const QList<Core::Client>& clients, const Core::Client& selectedClient, NameValidatorEx nameValidator);
 
+	// Writes the changes to the journal until the dialog is saved, see DialogJournal
+	void enableAutosave(const QString& journalPath, const DialogJournal::Origin& origin);
+
+	// Allows inserting phases made from the templates of the library
+	void enablePhaseTemplates(const Core::PhaseTemplateLibrary* phaseTemplates);
+
+	// Selects the node or the phase and scrolls the view to it
+	void showNode(const Core::AbstractDialogNode::Id& id);
+
 signals:
 	void dialogModified(Core::Dialog dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo);
 	void dialogCreated(Core::Client client, Core::Dialog dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo);
@@ -37,6 +51,7 @@ public slots:
 	void onNodeSelectionChanged(NodeGraphicsItem* node, bool value);
 
 	void updateSaveControls();
+	void updateAnalysis();
 	void showError(QString text);
 	void hideError();
 
@@ -45,6 +60,9 @@ public slots:
 
 	QVector<NodeGraphicsItem*> disconnectedNodes() const;
 	void removeStandaloneNodes();
+
+	void showPhaseTemplates();
+	void insertPhaseTemplate(const QString& id);
 	void updateRemoveControls();
 
 	void nodeAdded(NodeGraphicsItem* node);
@@ -59,9 +77,15 @@ public slots:
 
 	void onPrimaryPhaseChanged(PhaseGraphicsItem* phase);
 
+	void scheduleHistoryRecord(NodeGraphicsItem* node);
+	void recordHistory();
+	void undo();
+	void redo();
+	void updateHistoryControls();
+
 private:
-	bool validateDialog() const;
-	bool validateDialog(QString& error) const;
+	bool validateDialog();
+	bool validateDialog(QStringList& errors);
 	QList<Core::PhaseNode> getPhases();
 	QList<PhaseGraphicsItem*> getOrderedPhases();
 
@@ -73,6 +97,9 @@ private:
 
 	QList<Core::AbstractDialogNode*> getPhaseNodes(PhaseGraphicsItem* phaseItem);
 
+	void restore(const DialogHistory::Snapshot& snapshot);
+	DialogJournal::State journalState();
+
 private:
 	Ui::DialogEditorWindow* m_ui;
 
@@ -81,6 +108,19 @@ private:
 	Core::Dialog m_dialog;
 	Core::Client m_selectedClient;
 	NameValidator m_nameValidator;
+	Core::DialogValidator m_validator;
+	Core::TopologicalOrder m_nodesOrder;
+	bool m_analysisScheduled { false };
+
+	DialogHistory m_history;
+	QSet<Core::AbstractDialogNode::Id> m_historyChanges;
+	bool m_historyScheduled { false };
+	bool m_restoring { false };
+
+	const Core::PhaseTemplateLibrary* m_phaseTemplates { nullptr };
+
+	std::unique_ptr<DialogJournal> m_journal;
+	bool m_saved { false };
 
 	QVector<NodeGraphicsItem*> m_selectedNodes;
 
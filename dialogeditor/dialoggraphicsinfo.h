@@ -20,3 +20,13 @@ struct PhaseGraphicsInfo
 	QSizeF size;
 	QList<NodeGraphicsInfo> nodes;
 };
+
+inline bool operator==(const NodeGraphicsInfo& left, const NodeGraphicsInfo& right)
+{
+	return left.id == right.id && left.position == right.position && left.size == right.size;
+}
+
+inline bool operator==(const PhaseGraphicsInfo& left, const PhaseGraphicsInfo& right)
+{
+	return left.name == right.name && left.position == right.position && left.size == right.size && left.nodes == right.nodes;
+}
@@ -137,6 +137,19 @@ void DialogGraphicsScene::setDialog(Core::Dialog* dialog, QList<PhaseGraphicsInf
 	refreshScene();
 }
 
+void DialogGraphicsScene::addPhase()
+{
+	Q_ASSERT(!m_dialog->phases.isEmpty());
+
+	const QRectF itemsRect = itemsBoundingRect();
+
+	PhaseGraphicsInfo phaseGraphicsInfo;
+	phaseGraphicsInfo.name = m_dialog->phases.last().name();
+	phaseGraphicsInfo.position = itemsRect.isNull() ? QPointF() : QPointF(itemsRect.right() + s_nodesInterval, itemsRect.top());
+
+	renderPhase(m_dialog->phases.last(), m_dialog->phases.size() - 1, phaseGraphicsInfo);
+}
+
 void DialogGraphicsScene::dropEvent(QGraphicsSceneDragDropEvent* event)
 {
 	if (const auto* mimeData = qobject_cast<const ArrowLineGraphicsItemMimeData*>(event->mimeData()))
@@ -322,11 +335,14 @@ std::pair<PhaseGraphicsItem*, DialogGraphicsScene::NodeItemById> DialogGraphicsS
 	LOG << "Place phase #" << phaseIndex << " at " << phasePos;
 	addNodeToScene(phaseItem, phasePos);
 
-	const auto phaseGraph = makeGraphData(phase.nodes());
+	// nodes are edited in place by the graphics items, so they must not be shared with other dialog copies
+	const QList<Core::AbstractDialogNode*>& nodes = phase.detachNodes();
+
+	const auto phaseGraph = makeGraphData(nodes);
 	GraphLayout layout(phaseGraph.totalLayers);
 	const GraphLayout::NodesByLayer graph = layout.render(phaseGraph);
 
-	const auto itemByNode = renderNodes(phaseItem, graph, phase.nodes());
+	const auto itemByNode = renderNodes(phaseItem, graph, nodes);
 	placeNodes(phaseItem, itemByNode, graph, phaseGraphicsInfo.nodes);
 
 	renderEdges(phaseItem, graph, itemByNode);
@@ -22,6 +22,9 @@ public:
 	~DialogGraphicsScene();
 
 	void setDialog(Core::Dialog* dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo);
+	// Shows the last phase of the dialog with its nodes to the right of the other phases,
+	// the phase must be appended to the dialog before
+	void addPhase();
 
 	void addNodeToScene(NodeGraphicsItem* node, const QPointF& position);
 	void removeNodeFromScene(NodeGraphicsItem* node);
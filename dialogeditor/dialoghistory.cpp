@@ -0,0 +1,144 @@
+#include "dialoghistory.h"
+
+#include "logger.h"
+
+#include <QHash>
+
+DialogHistory::DialogHistory(int limit)
+	: m_current(-1)
+	, m_limit(limit)
+{
+	Q_ASSERT(m_limit > 0);
+}
+
+bool DialogHistory::record(const QList<const Core::PhaseNode*>& phases, const QList<PhaseGraphicsInfo>& graphicsInfo,
+	const QSet<Core::AbstractDialogNode::Id>& changed)
+{
+	const Snapshot* previous = m_current >= 0 ? &m_snapshots[m_current] : nullptr;
+
+	QHash<Core::AbstractDialogNode::Id, const Core::PhaseNode*> previousPhases;
+	QHash<QString, const PhaseGraphicsInfo*> previousGraphicsInfo;
+	if (previous)
+	{
+		for (const Core::PhaseNode& phase : previous->phases)
+		{
+			previousPhases.insert(phase.id(), &phase);
+		}
+		for (const PhaseGraphicsInfo& info : previous->graphicsInfo)
+		{
+			previousGraphicsInfo.insert(info.name, &info);
+		}
+	}
+
+	Snapshot snapshot;
+	for (const Core::PhaseNode* phase : phases)
+	{
+		const Core::PhaseNode* previousPhase = previousPhases.value(phase->id());
+		if (previousPhase && !changed.contains(phase->id()))
+		{
+			snapshot.phases.append(*previousPhase);
+		}
+		else
+		{
+			snapshot.phases.append(copy(*phase, previousPhase, changed));
+		}
+	}
+
+	// node moves aren't signalled, so the layout is read whole, the unmoved phases keep the previous copy
+	for (const PhaseGraphicsInfo& info : graphicsInfo)
+	{
+		const PhaseGraphicsInfo* previousInfo = previousGraphicsInfo.value(info.name);
+		snapshot.graphicsInfo.append(previousInfo && *previousInfo == info ? *previousInfo : info);
+	}
+
+	if (previous && isSame(*previous, snapshot))
+	{
+		return false;
+	}
+
+	while (m_snapshots.size() > m_current + 1)
+	{
+		m_snapshots.removeLast();
+	}
+
+	m_snapshots.append(snapshot);
+	if (m_snapshots.size() > m_limit)
+	{
+		m_snapshots.removeFirst();
+	}
+	m_current = m_snapshots.size() - 1;
+
+	LOG << ARG2(m_snapshots.size(), "snapshots") << ARG2(changed.size(), "changed");
+	return true;
+}
+
+const DialogHistory::Snapshot& DialogHistory::current() const
+{
+	Q_ASSERT(m_current >= 0);
+	return m_snapshots[m_current];
+}
+
+bool DialogHistory::canUndo() const
+{
+	return m_current > 0;
+}
+
+bool DialogHistory::canRedo() const
+{
+	return m_current + 1 < m_snapshots.size();
+}
+
+const DialogHistory::Snapshot& DialogHistory::undo()
+{
+	Q_ASSERT(canUndo());
+	return m_snapshots[--m_current];
+}
+
+const DialogHistory::Snapshot& DialogHistory::redo()
+{
+	Q_ASSERT(canRedo());
+	return m_snapshots[++m_current];
+}
+
+// The live nodes are edited in place, so the changed ones are copied and the rest are taken from the previous state
+Core::PhaseNode DialogHistory::copy(const Core::PhaseNode& phase, const Core::PhaseNode* previous,
+	const QSet<Core::AbstractDialogNode::Id>& changed) const
+{
+	QHash<Core::AbstractDialogNode::Id, Core::AbstractDialogNode*> previousNodes;
+	if (previous)
+	{
+		for (Core::AbstractDialogNode* node : previous->nodes())
+		{
+			previousNodes.insert(node->id(), node);
+		}
+	}
+
+	QList<Core::AbstractDialogNode*> nodes;
+	for (Core::AbstractDialogNode* node : phase.nodes())
+	{
+		Core::AbstractDialogNode* previousNode = previousNodes.value(node->id());
+		nodes.append(previousNode && !changed.contains(node->id()) ? previousNode : node->clone(false));
+	}
+
+	Core::PhaseNode result = phase;
+	result.setNodes(nodes);
+	return result;
+}
+
+bool DialogHistory::isSame(const Snapshot& left, const Snapshot& right) const
+{
+	if (left.phases.size() != right.phases.size() || left.graphicsInfo != right.graphicsInfo)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < left.phases.size(); ++i)
+	{
+		if (!left.phases[i].isSharedWith(right.phases[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
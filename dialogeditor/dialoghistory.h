@@ -0,0 +1,46 @@
+#pragma once
+
+#include "dialoggraphicsinfo.h"
+#include "core/phasenode.h"
+
+#include <QList>
+#include <QSet>
+
+// Undo and redo states of the dialog graph. A state copies only the changed nodes and phases,
+// the rest are shared with the previous state, so a step costs as much as the change
+class DialogHistory
+{
+public:
+	struct Snapshot
+	{
+		QList<Core::PhaseNode> phases;
+		QList<PhaseGraphicsInfo> graphicsInfo;
+	};
+
+	explicit DialogHistory(int limit = 100);
+
+	// Adds the current state and drops the redo states, returns false if nothing changed.
+	// The changed ids are the edited nodes and the phases they belong to since the previous state
+	bool record(const QList<const Core::PhaseNode*>& phases, const QList<PhaseGraphicsInfo>& graphicsInfo,
+		const QSet<Core::AbstractDialogNode::Id>& changed);
+
+	// The state shown in the editor
+	const Snapshot& current() const;
+
+	bool canUndo() const;
+	bool canRedo() const;
+
+	// The state to show, its nodes are shared and must be detached before editing
+	const Snapshot& undo();
+	const Snapshot& redo();
+
+private:
+	Core::PhaseNode copy(const Core::PhaseNode& phase, const Core::PhaseNode* previous,
+		const QSet<Core::AbstractDialogNode::Id>& changed) const;
+	bool isSame(const Snapshot& left, const Snapshot& right) const;
+
+private:
+	QList<Snapshot> m_snapshots;
+	int m_current;
+	int m_limit;
+};
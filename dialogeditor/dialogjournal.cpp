@@ -0,0 +1,383 @@
+#include "dialogjournal.h"
+
+#include "core/dialogbinarywriter.h"
+#include "core/dialogbinaryreader.h"
+
+#include "logger.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QUuid>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace
+{
+
+const char Magic[] = "VCDJ";
+const int MagicSize = 4;
+const char Version = 1;
+
+const int BatchIntervalMs = 1000;
+// records appended before the file is compacted into a snapshot
+const int CompactionRecords = 50;
+
+enum RecordType : quint8
+{
+	SnapshotRecord = 1,
+	ChangeRecord = 2
+};
+
+// Written by the worker thread, the dialog holds either all phases or only the changed ones
+struct Batch
+{
+	bool compact;
+	DialogJournal::Origin origin;
+	Core::Dialog dialog;
+	QStringList order;
+	QList<PhaseGraphicsInfo> graphicsInfo;
+};
+
+void setupStream(QDataStream& stream)
+{
+	stream.setVersion(QDataStream::Qt_5_0);
+}
+
+void writeGraphicsInfo(QDataStream& stream, const QList<PhaseGraphicsInfo>& phases)
+{
+	stream << static_cast<qint32>(phases.size());
+	for (const PhaseGraphicsInfo& phase : phases)
+	{
+		stream << phase.name << phase.position << phase.size << static_cast<qint32>(phase.nodes.size());
+		for (const NodeGraphicsInfo& node : phase.nodes)
+		{
+			stream << node.id << node.position << node.size;
+		}
+	}
+}
+
+QList<PhaseGraphicsInfo> readGraphicsInfo(QDataStream& stream)
+{
+	QList<PhaseGraphicsInfo> phases;
+
+	qint32 phasesCount = 0;
+	stream >> phasesCount;
+	for (qint32 i = 0; i < phasesCount && stream.status() == QDataStream::Ok; ++i)
+	{
+		PhaseGraphicsInfo phase;
+		qint32 nodesCount = 0;
+		stream >> phase.name >> phase.position >> phase.size >> nodesCount;
+		for (qint32 j = 0; j < nodesCount && stream.status() == QDataStream::Ok; ++j)
+		{
+			NodeGraphicsInfo node;
+			stream >> node.id >> node.position >> node.size;
+			phase.nodes.append(node);
+		}
+		phases.append(phase);
+	}
+
+	return phases;
+}
+
+bool writeBatch(const QString& path, const Batch& batch)
+{
+	QByteArray payload;
+	{
+		QDataStream stream(&payload, QIODevice::WriteOnly);
+		setupStream(stream);
+
+		stream << static_cast<quint8>(batch.compact ? SnapshotRecord : ChangeRecord);
+		if (batch.compact)
+		{
+			stream << batch.origin.clientId << batch.origin.dialogName << static_cast<qint32>(batch.origin.difficulty) << batch.origin.isNew;
+		}
+		stream << Core::DialogBinaryWriter().write(batch.dialog) << batch.order;
+		writeGraphicsInfo(stream, batch.graphicsInfo);
+	}
+
+	QByteArray record;
+	{
+		QDataStream stream(&record, QIODevice::WriteOnly);
+		setupStream(stream);
+		stream << qChecksum(payload.constData(), payload.size()) << payload;
+	}
+
+	if (batch.compact)
+	{
+		// the snapshot replaces the journal at once, a crash leaves either the old or the new file
+		QSaveFile file(path);
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			LOG << "Failed to open " << path << ": " << file.errorString();
+			return false;
+		}
+
+		file.write(Magic, MagicSize);
+		file.write(&Version, 1);
+		file.write(record);
+		return file.commit();
+	}
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append) || file.write(record) != record.size())
+	{
+		LOG << "Failed to append to " << path << ": " << file.errorString();
+		return false;
+	}
+
+	return file.flush();
+}
+
+bool applyRecord(const QByteArray& payload, DialogJournal::Recovery& recovery, bool& hasSnapshot, QString& error)
+{
+	QDataStream stream(payload);
+	setupStream(stream);
+
+	quint8 type = 0;
+	stream >> type;
+
+	if (type == SnapshotRecord)
+	{
+		qint32 difficulty = 0;
+		stream >> recovery.origin.clientId >> recovery.origin.dialogName >> difficulty >> recovery.origin.isNew;
+		if (difficulty < 0 || difficulty > static_cast<qint32>(Core::Dialog::Difficulty::Hard))
+		{
+			error = "неверная сложность диалога";
+			return false;
+		}
+		recovery.origin.difficulty = static_cast<Core::Dialog::Difficulty>(difficulty);
+	}
+	else if (type != ChangeRecord || !hasSnapshot)
+	{
+		error = "неверная запись";
+		return false;
+	}
+
+	QByteArray dialogData;
+	QStringList order;
+	stream >> dialogData >> order;
+	const QList<PhaseGraphicsInfo> graphicsInfo = readGraphicsInfo(stream);
+	if (stream.status() != QDataStream::Ok)
+	{
+		error = "данные обрезаны";
+		return false;
+	}
+
+	Core::DialogBinaryReader reader;
+	bool ok = false;
+	Core::Dialog dialog = reader.read(dialogData, ok);
+	if (!ok)
+	{
+		error = reader.errorString();
+		return false;
+	}
+
+	// a change holds only the changed phases, the rest are taken from the previous state
+	QList<Core::PhaseNode> phases;
+	for (const QString& id : order)
+	{
+		auto findPhase = [&id](const QList<Core::PhaseNode>& candidates)
+		{
+			return std::find_if(candidates.constBegin(), candidates.constEnd(), [&id](const Core::PhaseNode& phase) { return phase.id() == id; });
+		};
+
+		auto phaseIt = findPhase(dialog.phases);
+		if (phaseIt == dialog.phases.constEnd())
+		{
+			phaseIt = findPhase(recovery.state.dialog.phases);
+			if (phaseIt == recovery.state.dialog.phases.constEnd())
+			{
+				error = "не найдена фаза " + id;
+				return false;
+			}
+		}
+		phases.append(*phaseIt);
+	}
+
+	dialog.phases = phases;
+	recovery.state.dialog = dialog;
+	recovery.state.graphicsInfo = graphicsInfo;
+	hasSnapshot = true;
+	return true;
+}
+
+}
+
+DialogJournal::DialogJournal(const QString& path, const Origin& origin, const StateProvider& state, QObject* parent)
+	: QObject(parent)
+	, m_path(path)
+	, m_origin(origin)
+	, m_state(state)
+{
+	m_timer.setSingleShot(true);
+	m_timer.setInterval(BatchIntervalMs);
+	connect(&m_timer, &QTimer::timeout, this, &DialogJournal::write);
+	connect(&m_writeWatcher, &QFutureWatcher<bool>::finished, this, &DialogJournal::onWriteFinished);
+}
+
+DialogJournal::~DialogJournal()
+{
+	m_timer.stop();
+	m_writeWatcher.waitForFinished();
+}
+
+const QString& DialogJournal::path() const
+{
+	return m_path;
+}
+
+void DialogJournal::touch()
+{
+	if (m_discarded)
+	{
+		return;
+	}
+
+	m_dirty = true;
+
+	// a running write restarts the timer when it is finished
+	if (!m_timer.isActive() && !m_writeWatcher.isRunning())
+	{
+		m_timer.start();
+	}
+}
+
+void DialogJournal::flush()
+{
+	m_timer.stop();
+	m_writeWatcher.waitForFinished();
+
+	if (m_dirty)
+	{
+		write();
+		m_writeWatcher.waitForFinished();
+	}
+}
+
+void DialogJournal::discard()
+{
+	m_discarded = true;
+	m_timer.stop();
+	m_writeWatcher.waitForFinished();
+
+	QFile::remove(m_path);
+}
+
+QString DialogJournal::directory()
+{
+	return QCoreApplication::applicationDirPath() + "/autosave";
+}
+
+QString DialogJournal::createPath()
+{
+	QDir().mkpath(directory());
+	return directory() + "/" + QUuid::createUuid().toString().mid(1, 36) + ".journal";
+}
+
+bool DialogJournal::read(const QString& path, Recovery& recovery, QString& error)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = file.errorString();
+		return false;
+	}
+
+	const QByteArray header = file.read(MagicSize + 1);
+	if (header.size() != MagicSize + 1 || !header.startsWith(Magic))
+	{
+		error = "это не файл автосохранения";
+		return false;
+	}
+
+	if (header[MagicSize] != Version)
+	{
+		error = QString("неподдерживаемая версия %1").arg(static_cast<int>(header[MagicSize]));
+		return false;
+	}
+
+	QDataStream stream(&file);
+	setupStream(stream);
+
+	bool hasSnapshot = false;
+	while (!stream.atEnd())
+	{
+		quint16 checksum = 0;
+		QByteArray payload;
+		stream >> checksum >> payload;
+
+		// the last record may be torn by a crash, the state before it is recovered
+		if (stream.status() != QDataStream::Ok || qChecksum(payload.constData(), payload.size()) != checksum)
+		{
+			LOG << "Skipped a torn record in " << path;
+			break;
+		}
+
+		if (!applyRecord(payload, recovery, hasSnapshot, error))
+		{
+			return false;
+		}
+	}
+
+	if (!hasSnapshot)
+	{
+		error = "нет сохраненного состояния";
+		return false;
+	}
+
+	return true;
+}
+
+void DialogJournal::write()
+{
+	if (m_discarded || m_writeWatcher.isRunning())
+	{
+		return;
+	}
+
+	m_dirty = false;
+	const State state = m_state();
+
+	Batch batch;
+	batch.compact = m_records == 0 || m_records >= CompactionRecords;
+	batch.origin = m_origin;
+	batch.dialog = state.dialog;
+	batch.dialog.phases.clear();
+	batch.graphicsInfo = state.graphicsInfo;
+
+	for (const Core::PhaseNode& phase : state.dialog.phases)
+	{
+		batch.order.append(phase.id());
+
+		const bool written = std::any_of(m_written.dialog.phases.begin(), m_written.dialog.phases.end(),
+			[&phase](const Core::PhaseNode& writtenPhase) { return writtenPhase.isSharedWith(phase); });
+		if (batch.compact || !written)
+		{
+			batch.dialog.phases.append(phase);
+		}
+	}
+
+	m_written = state;
+	m_records = batch.compact ? 1 : m_records + 1;
+
+	LOG << ARG2(batch.compact, "compact") << ARG2(batch.dialog.phases.size(), "phases") << ARG2(m_records, "records");
+	m_writeWatcher.setFuture(QtConcurrent::run(writeBatch, m_path, batch));
+}
+
+void DialogJournal::onWriteFinished()
+{
+	// the next write starts a new file, so a failed append doesn't leave a gap
+	if (!m_writeWatcher.result())
+	{
+		m_records = 0;
+	}
+
+	if (m_dirty && !m_discarded)
+	{
+		m_timer.start();
+	}
+}
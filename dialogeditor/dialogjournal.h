@@ -0,0 +1,79 @@
+#pragma once
+
+#include "dialoggraphicsinfo.h"
+#include "core/dialog.h"
+
+#include <QObject>
+#include <QTimer>
+#include <QFutureWatcher>
+
+#include <functional>
+
+// Autosave of an open dialog editor. The file starts with a snapshot of the dialog followed by records
+// of the changed phases. Changes are batched and written by a worker thread, every few records the file
+// is compacted into a new snapshot. A record torn by a crash is ignored on reading
+class DialogJournal
+	: public QObject
+{
+	Q_OBJECT
+
+public:
+	// The edited dialog, so the recovered one can replace it
+	struct Origin
+	{
+		QString clientId;
+		QString dialogName;
+		Core::Dialog::Difficulty difficulty;
+		bool isNew;
+	};
+
+	struct State
+	{
+		Core::Dialog dialog;
+		QList<PhaseGraphicsInfo> graphicsInfo;
+	};
+
+	struct Recovery
+	{
+		Origin origin;
+		State state;
+	};
+
+	// Called on the GUI thread when a batch is written, unchanged phases must be shared with the previous state
+	typedef std::function<State()> StateProvider;
+
+	DialogJournal(const QString& path, const Origin& origin, const StateProvider& state, QObject* parent = nullptr);
+	// Waits for the write in progress, the file is kept
+	~DialogJournal();
+
+	const QString& path() const;
+
+	// Schedules writing of the current state, changes made until then are written as one record
+	void touch();
+	// Writes the pending changes and waits for them
+	void flush();
+	// Stops writing and removes the file
+	void discard();
+
+	static QString directory();
+	static QString createPath();
+	static bool read(const QString& path, Recovery& recovery, QString& error);
+
+private:
+	void write();
+	void onWriteFinished();
+
+private:
+	QString m_path;
+	Origin m_origin;
+	StateProvider m_state;
+
+	QTimer m_timer;
+	QFutureWatcher<bool> m_writeWatcher;
+	bool m_dirty { false };
+	bool m_discarded { false };
+
+	// the last written state, changes are found against it
+	State m_written;
+	int m_records { 0 };
+};
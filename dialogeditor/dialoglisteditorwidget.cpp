@@ -1,11 +1,16 @@
 #include "dialoglisteditorwidget.h"
 #include "dialogeditorwindow.h"
 #include "core/dialogjsonwriter.h"
+#include "core/dialogdiff.h"
+#include "core/stringpool.h"
 #include "core/ibackendconnection.h"
 #include "applicationsettings.h"
 
 #include "logger.h"
 
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
 #include <QMessageBox>
 
 namespace
@@ -16,6 +21,11 @@ QString toLowerCase(const QString& str)
 	return str.left(1).toLower() + str.mid(1);
 }
 
+QString phaseTemplatesPath()
+{
+	return QCoreApplication::applicationDirPath() + "/phasetemplates.bin";
+}
+
 }
 
 DialogListEditorWidget::DialogListEditorWidget(IBackendConnectionSharedPtr backendConnection, DialogGraphicsInfoStoragePtr dialogGraphicsInfoStorage,
@@ -32,6 +42,12 @@ DialogListEditorWidget::DialogListEditorWidget(IBackendConnectionSharedPtr backe
 	connect(m_backendConnection.get(), &Core::IBackendConnection::dialogsLoadFailed, this, &DialogListEditorWidget::onDialogsLoadFailed);
 	connect(m_backendConnection.get(), &Core::IBackendConnection::dialogsUpdated, this, &DialogListEditorWidget::onDialogsUpdated);
 	connect(m_backendConnection.get(), &Core::IBackendConnection::dialogsUpdateFailed, this, &DialogListEditorWidget::onDialogsUpdateFailed);
+
+	QFile templatesFile(phaseTemplatesPath());
+	if (templatesFile.open(QIODevice::ReadOnly) && !m_phaseTemplates.load(templatesFile.readAll()))
+	{
+		LOG << "Failed to load phase templates from " << templatesFile.fileName();
+	}
 }
 
 void DialogListEditorWidget::loadData()
@@ -51,6 +67,7 @@ void DialogListEditorWidget::setCurrentClient(const Core::Client& client)
 	m_currentClient = client.databaseName;
 
 	updateData();
+	offerRecovery();
 }
 
 void DialogListEditorWidget::setSettings(ApplicationSettings* settings)
@@ -58,6 +75,67 @@ void DialogListEditorWidget::setSettings(ApplicationSettings* settings)
 	m_settings = settings;
 }
 
+QList<Core::Dialog> DialogListEditorWidget::currentDialogs() const
+{
+	return m_model.value(m_currentClient);
+}
+
+const QMap<QString, QList<Core::Dialog>>& DialogListEditorWidget::dialogs() const
+{
+	return m_model;
+}
+
+const Core::ExpectedWordsIndex& DialogListEditorWidget::expectedWordsIndex() const
+{
+	return m_expectedWordsIndex;
+}
+
+const Core::DialogSearchIndex& DialogListEditorWidget::searchIndex() const
+{
+	return m_searchIndex;
+}
+
+Core::PhaseTemplateLibrary& DialogListEditorWidget::phaseTemplates()
+{
+	return m_phaseTemplates;
+}
+
+void DialogListEditorWidget::savePhaseTemplates()
+{
+	QFile templatesFile(phaseTemplatesPath());
+	if (!templatesFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || templatesFile.write(m_phaseTemplates.save()) == -1)
+	{
+		QMessageBox::warning(this, "Шаблоны фаз", "Не удалось сохранить шаблоны фаз: " + toLowerCase(templatesFile.errorString()) + ".");
+	}
+}
+
+void DialogListEditorWidget::showNode(const QString& dialogName, const Core::AbstractDialogNode::Id& nodeId)
+{
+	DialogEditorWindow* editorWindow = openDialog(dialogName);
+	if (editorWindow && !nodeId.isEmpty())
+	{
+		editorWindow->showNode(nodeId);
+	}
+}
+
+void DialogListEditorWidget::updateDialogs(const QMap<QString, QMap<Core::Dialog, Core::Dialog>>& dialogs)
+{
+	if (dialogs.isEmpty())
+	{
+		return;
+	}
+
+	showProgressDialog("Изменение данных", "Идет изменение данных. Пожалуйста, подождите.");
+
+	m_updating = true;
+	m_pendingUpdates = dialogs.size();
+
+	for (auto it = dialogs.begin(); it != dialogs.end(); ++it)
+	{
+		m_backendConnection->updateDialogs(it.key(), { it.value(), {}, {} });
+	}
+}
+
 QStringList DialogListEditorWidget::items() const
 {
 	QStringList result;
@@ -117,11 +195,17 @@ void DialogListEditorWidget::updateDialog(int index, const Core::Dialog& dialog,
 		m_dialogGraphicsInfoStorage->update({ m_currentClient, dialog.name, dialog.difficulty }, phasesGraphicsInfo);
 	}
 
+	// the editor cloned the nodes shared with the model, so the source and the dialogs sharing its phases are unchanged
 	if (dialog == sourceDialog)
 	{
+		// nothing to store, so nothing to recover
+		removeSavedJournals();
 		return;
 	}
 
+	const Core::DialogDiff diff(sourceDialog, dialog);
+	LOG << dialog.printableName() << " changes: " << diff.summary().join("; ");
+
 	showProgressDialog("Изменение данных", "Идет изменение данных. Пожалуйста, подождите.");
 
 	const QMap<Core::Dialog, Core::Dialog> updated = {
@@ -143,13 +227,17 @@ void DialogListEditorWidget::addDialog(const QString& clientId, const Core::Dial
 	m_backendConnection->updateDialogs(clientId, { {}, {}, { dialog } });
 }
 
-void DialogListEditorWidget::onItemEditRequested(const QString& dialogName)
+DialogEditorWindow* DialogListEditorWidget::openDialog(const QString& dialogName, const DialogJournal::State* recovered)
 {
 	const auto& dialogs = m_model[m_currentClient];
 
 	const auto dialogIt = std::find_if(dialogs.begin(), dialogs.end(),
 		[&dialogName](const Core::Dialog& dialog){ return dialog.printableName() == dialogName; });
-	Q_ASSERT(dialogIt != dialogs.end());
+	if (dialogIt == dialogs.end())
+	{
+		return nullptr;
+	}
+
 	const int index = std::distance(dialogs.begin(), dialogIt);
 
 	const auto validator = [this, index, &dialogs](const QString& name, Core::Dialog::Difficulty difficulty)
@@ -175,8 +263,10 @@ void DialogListEditorWidget::onItemEditRequested(const QString& dialogName)
 		[this](const Core::Client& client) { return client.databaseName == m_currentClient; });
 	Q_ASSERT(currentClientIt != m_clients.end());
 
-	auto dialogGraphicsInfo = m_dialogGraphicsInfoStorage->read({ m_currentClient, dialogIt->name, dialogIt->difficulty });
-	DialogEditorWindow* editorWindow = new DialogEditorWindow(*currentClientIt, *dialogIt, dialogGraphicsInfo, validator);
+	DialogEditorWindow* editorWindow = recovered ?
+		new DialogEditorWindow(*currentClientIt, recovered->dialog, recovered->graphicsInfo, validator) :
+		new DialogEditorWindow(*currentClientIt, *dialogIt,
+			m_dialogGraphicsInfoStorage->read({ m_currentClient, dialogIt->name, dialogIt->difficulty }), validator);
 
 	DialogEditorWindow::NameValidatorEx nameValidator = [&](const Core::Client& client, const QString& name, Core::Dialog::Difficulty difficulty) -> bool
 	{
@@ -210,6 +300,8 @@ void DialogListEditorWidget::onItemEditRequested(const QString& dialogName)
 	Q_ASSERT(clientIt != m_clients.end());
 
 	editorWindow->enableSaveAs(m_clients, *clientIt, nameValidator);
+	enableAutosave(editorWindow, { m_currentClient, dialogIt->name, dialogIt->difficulty, false });
+	editorWindow->enablePhaseTemplates(&m_phaseTemplates);
 
 	connect(editorWindow, &DialogEditorWindow::dialogModified,
 		[this, index](Core::Dialog dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo) { updateDialog(index, dialog, phasesGraphicsInfo); });
@@ -217,17 +309,33 @@ void DialogListEditorWidget::onItemEditRequested(const QString& dialogName)
 		[this](Core::Client client, Core::Dialog dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo) { addDialog(client.databaseName, dialog, phasesGraphicsInfo); });
 
 	editorWindow->show();
+
+	return editorWindow;
+}
+
+void DialogListEditorWidget::onItemEditRequested(const QString& dialogName)
+{
+	DialogEditorWindow* editorWindow = openDialog(dialogName);
+	Q_ASSERT(editorWindow);
+	Q_UNUSED(editorWindow);
 }
 
 void DialogListEditorWidget::onItemCreateRequested()
 {
 	Core::Dialog dialog = { "", Core::Dialog::Difficulty::Easy, "", { }, {}, 0.0, {} };
-	dialog.phaseRepeatReplica = m_settings->phaseRepeatReplica();
+	dialog.phaseRepeatReplica = Core::StringPool::intern(m_settings->phaseRepeatReplica());
 	dialog.errorReplica.errorReplica = m_settings->phaseErrorReplica();
 	dialog.errorReplica.errorPenalty = m_settings->phaseErrorPenalty();
 	dialog.errorReplica.finishingExpectedWords = { m_settings->phaseFinishingExpectedWords() };
 	dialog.errorReplica.finishingReplica = m_settings->phaseFinishingReplica();
+	// the defaults are the same texts the loaded dialogs already share
+	Core::StringPool::intern(dialog.errorReplica);
 
+	createDialog(dialog, m_dialogGraphicsInfoStorage->read({ m_currentClient, dialog.name, dialog.difficulty }));
+}
+
+DialogEditorWindow* DialogListEditorWidget::createDialog(const Core::Dialog& dialog, const QList<PhaseGraphicsInfo>& phasesGraphicsInfo)
+{
 	const auto validator = [this](const QString& name, Core::Dialog::Difficulty difficulty)
 	{
 		const QString newName = Core::Dialog::printableName(name, difficulty);
@@ -249,14 +357,85 @@ void DialogListEditorWidget::onItemCreateRequested()
 		[this](const Core::Client& client) { return client.databaseName == m_currentClient; });
 	Q_ASSERT(currentClientIt != m_clients.end());
 
-	auto dialogGraphicsInfo = m_dialogGraphicsInfoStorage->read({ m_currentClient, dialog.name, dialog.difficulty });
-
-	DialogEditorWindow* editorWindow = new DialogEditorWindow(*currentClientIt, dialog, dialogGraphicsInfo, validator);
+	DialogEditorWindow* editorWindow = new DialogEditorWindow(*currentClientIt, dialog, phasesGraphicsInfo, validator);
+	enableAutosave(editorWindow, { m_currentClient, dialog.name, dialog.difficulty, true });
+	editorWindow->enablePhaseTemplates(&m_phaseTemplates);
 
 	connect(editorWindow, &DialogEditorWindow::dialogModified,
 		[this](Core::Dialog dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo) { addDialog(m_currentClient, dialog, phasesGraphicsInfo); });
 
 	editorWindow->show();
+
+	return editorWindow;
+}
+
+// Must be called before the save handlers are connected, so the journal is known to be saved when they run
+void DialogListEditorWidget::enableAutosave(DialogEditorWindow* editorWindow, const DialogJournal::Origin& origin)
+{
+	const QString path = DialogJournal::createPath();
+	m_activeJournals.insert(path);
+
+	editorWindow->enableAutosave(path, origin);
+
+	auto onSaved = [this, path]() { m_savedJournals.insert(path); };
+	connect(editorWindow, &DialogEditorWindow::dialogModified, this, onSaved);
+	connect(editorWindow, &DialogEditorWindow::dialogCreated, this, onSaved);
+	connect(editorWindow, &QObject::destroyed, this, [this, path]() { m_activeJournals.remove(path); });
+}
+
+void DialogListEditorWidget::offerRecovery()
+{
+	const QDir directory(DialogJournal::directory());
+	for (const QString& fileName : directory.entryList({ "*.journal" }, QDir::Files, QDir::Time))
+	{
+		const QString path = directory.filePath(fileName);
+		if (m_activeJournals.contains(path) || m_savedJournals.contains(path))
+		{
+			continue;
+		}
+
+		DialogJournal::Recovery recovery;
+		QString error;
+		if (!DialogJournal::read(path, recovery, error))
+		{
+			LOG << "Failed to read " << path << ": " << error;
+			QFile::remove(path);
+			continue;
+		}
+
+		if (recovery.origin.clientId != m_currentClient)
+		{
+			continue;
+		}
+
+		const QString dialogName = recovery.state.dialog.name.isEmpty() ? "без имени" : recovery.state.dialog.printableName();
+		const QMessageBox::StandardButton answer = QMessageBox::question(this, "Восстановление диалога",
+			"Найдены несохраненные изменения диалога \"" + dialogName + "\". Восстановить их?");
+
+		// the reopened editor starts its own journal
+		QFile::remove(path);
+		if (answer != QMessageBox::Yes)
+		{
+			continue;
+		}
+
+		DialogEditorWindow* editorWindow = recovery.origin.isNew ? nullptr :
+			openDialog(Core::Dialog::printableName(recovery.origin.dialogName, recovery.origin.difficulty), &recovery.state);
+		if (!editorWindow)
+		{
+			// the source dialog was removed meanwhile, the changes are saved as a new one
+			createDialog(recovery.state.dialog, recovery.state.graphicsInfo);
+		}
+	}
+}
+
+void DialogListEditorWidget::removeSavedJournals()
+{
+	for (const QString& path : m_savedJournals)
+	{
+		QFile::remove(path);
+	}
+	m_savedJournals.clear();
 }
 
 void DialogListEditorWidget::onClientsLoaded(Core::IBackendConnection::QueryId /*queryId*/, const QList<Core::Client>& clients)
@@ -267,9 +446,26 @@ void DialogListEditorWidget::onClientsLoaded(Core::IBackendConnection::QueryId /
 void DialogListEditorWidget::onDialogsLoaded(Core::IBackendConnection::QueryId /*queryId*/,
 	const QMap<QString, QList<Core::Dialog>>& dialogs)
 {
-	m_model = dialogs;
+	// phases using templates share their nodes, so a template is kept in memory once,
+	// equal phases and copies of dialogs in other clients share all their data
+	m_contentStore.clear();
+	m_model = m_contentStore.intern(m_phaseTemplates.link(dialogs));
 	m_currentClient = dialogs.isEmpty() ? "" : dialogs.keys().first();
 
+	// all dialogs are reloaded after every change, only the changed ones are reindexed
+	m_expectedWordsIndex.setDialogs(m_model);
+	m_searchIndex.setDialogs(m_model);
+
+	// texts of the replaced dialogs are released only now
+	const int purged = Core::StringPool::purge();
+	const Core::StringPool::Statistics pool = Core::StringPool::statistics();
+	LOG << "String pool" << ARG2(pool.strings, "strings") << ARG2(pool.bytes, "bytes") << ARG2(pool.savedBytes, "savedBytes")
+		<< ARG2(pool.requests, "requests") << ARG(purged);
+
+	const Core::DialogContentStore::Statistics& store = m_contentStore.statistics();
+	LOG << "Content store" << ARG2(store.phases, "phases") << ARG2(store.sharedPhases, "sharedPhases")
+		<< ARG2(store.dialogs, "dialogs") << ARG2(store.sharedDialogs, "sharedDialogs");
+
 	updateData();
 
 	hideProgressDialog();
@@ -279,6 +475,8 @@ void DialogListEditorWidget::onDialogsLoaded(Core::IBackendConnection::QueryId /
 		QMessageBox::information(this, "Сохранение данных", "Сохранение данных завершилось успешно.");
 		m_updating = false;
 	}
+
+	offerRecovery();
 }
 
 void DialogListEditorWidget::onDialogsLoadFailed(Core::IBackendConnection::QueryId /*queryId*/, const QString& error)
@@ -290,14 +488,29 @@ void DialogListEditorWidget::onDialogsLoadFailed(Core::IBackendConnection::Query
 
 void DialogListEditorWidget::onDialogsUpdated(Core::IBackendConnection::QueryId /*queryId*/)
 {
+	if (m_pendingUpdates > 1)
+	{
+		--m_pendingUpdates;
+		return;
+	}
+
+	m_pendingUpdates = 0;
 	hideProgressDialog();
 
+	// the saved dialogs are on the server now
+	removeSavedJournals();
+
 	loadData();
 }
 
 void DialogListEditorWidget::onDialogsUpdateFailed(Core::IBackendConnection::QueryId /*queryId*/, const QString& error)
 {
+	m_pendingUpdates = 0;
 	hideProgressDialog();
 
 	QMessageBox::warning(this, "Сохранение данных", "Сохранение данных завершилось ошибкой: " + toLowerCase(error) + ".");
+
+	// the unsaved changes can be reopened from the journals
+	m_savedJournals.clear();
+	offerRecovery();
 }
@@ -2,10 +2,18 @@
 
 #include "core/ibackendconnection.h"
 #include "core/dialog.h"
+#include "core/expectedwordsindex.h"
+#include "core/dialogsearchindex.h"
+#include "core/phasetemplatelibrary.h"
+#include "core/dialogcontentstore.h"
 #include "listeditorwidget.h"
 #include "dialoggraphicsinfostorage.h"
+#include "dialogjournal.h"
+
+#include <QSet>
 
 class ApplicationSettings;
+class DialogEditorWindow;
 
 class DialogListEditorWidget
 	: public ListEditorWidget
@@ -20,6 +28,20 @@ public:
 	void setCurrentClient(const Core::Client& client);
 	void setSettings(ApplicationSettings* settings);
 
+	QList<Core::Dialog> currentDialogs() const;
+	const QMap<QString, QList<Core::Dialog>>& dialogs() const;
+	const Core::ExpectedWordsIndex& expectedWordsIndex() const;
+	const Core::DialogSearchIndex& searchIndex() const;
+
+	Core::PhaseTemplateLibrary& phaseTemplates();
+	void savePhaseTemplates();
+
+	// Opens the dialog of the current client in the editor, shows the node if the id isn't empty
+	void showNode(const QString& dialogName, const Core::AbstractDialogNode::Id& nodeId);
+
+	// Saves source dialogs replaced with the updated ones, one update per client
+	void updateDialogs(const QMap<QString, QMap<Core::Dialog, Core::Dialog>>& dialogs);
+
 private:
 	virtual QStringList items() const override;
 	virtual void removeItems(const QStringList& items) override;
@@ -37,6 +59,14 @@ private slots:
 private:
 	void updateDialog(int index, const Core::Dialog& dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo);
 	void addDialog(const QString& clientId, const Core::Dialog& dialog, QList<PhaseGraphicsInfo> phasesGraphicsInfo);
+	// The recovered state replaces the stored dialog if it is given
+	DialogEditorWindow* openDialog(const QString& dialogName, const DialogJournal::State* recovered = nullptr);
+	DialogEditorWindow* createDialog(const Core::Dialog& dialog, const QList<PhaseGraphicsInfo>& phasesGraphicsInfo);
+
+	void enableAutosave(DialogEditorWindow* editorWindow, const DialogJournal::Origin& origin);
+	// Offers to reopen the editors of the current client that weren't saved before the application stopped
+	void offerRecovery();
+	void removeSavedJournals();
 
 private:
 	ApplicationSettings* m_settings { nullptr };
@@ -45,8 +75,18 @@ private:
 
 	typedef QMap<QString, QList<Core::Dialog>> DialogListDataModel;
 	DialogListDataModel m_model;
+	Core::ExpectedWordsIndex m_expectedWordsIndex;
+	Core::DialogSearchIndex m_searchIndex;
+	Core::PhaseTemplateLibrary m_phaseTemplates;
+	Core::DialogContentStore m_contentStore;
 	QString m_currentClient;
 	QList<Core::Client> m_clients;
 
 	bool m_updating { false };
+	// dialogs are reloaded once all updates are done
+	int m_pendingUpdates { 0 };
+
+	// journals of the open editors and of the saved dialogs waiting for the server
+	QSet<QString> m_activeJournals;
+	QSet<QString> m_savedJournals;
 };
@@ -1,4 +1,10 @@
 #include "dialogstabwidget.h"
+#include "replacetextswindow.h"
+#include "memoryreportwindow.h"
+#include "phasetemplateswindow.h"
+#include "core/dialoganalysis.h"
+
+#include <QMessageBox>
 
 using namespace Core;
 
@@ -8,10 +14,21 @@ DialogsTabWidget::DialogsTabWidget(IBackendConnectionSharedPtr backendConnection
 {
 	m_ui.setupUi(this);
 	m_ui.verticalLayout->addWidget(&m_listEditorWidget);
+	m_ui.searchResultsListWidget->hide();
 
 	connect(m_ui.clientsComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DialogsTabWidget::updateDialogsList);
+	connect(m_ui.analyzeButton, &QPushButton::clicked, this, &DialogsTabWidget::analyzeDialogs);
+	connect(m_ui.replaceButton, &QPushButton::clicked, this, &DialogsTabWidget::replaceTexts);
+	connect(m_ui.memoryButton, &QPushButton::clicked, this, &DialogsTabWidget::showMemoryReport);
+	connect(m_ui.templatesButton, &QPushButton::clicked, this, &DialogsTabWidget::editPhaseTemplates);
+	connect(m_ui.searchLineEdit, &QLineEdit::textChanged, this, &DialogsTabWidget::updateSearchResults);
+	connect(m_ui.searchResultsListWidget, &QListWidget::itemActivated, this, &DialogsTabWidget::showSearchResult);
 	connect(backendConnection.get(), &IBackendConnection::clientsLoaded, this, &DialogsTabWidget::updateClientsList);
-	connect(backendConnection.get(), &IBackendConnection::dialogsLoaded, [this]() { m_listEditorWidget.setCurrentClient(m_currentClient); });
+	connect(backendConnection.get(), &IBackendConnection::dialogsLoaded, [this]()
+	{
+		m_listEditorWidget.setCurrentClient(m_currentClient);
+		updateSearchResults();
+	});
 }
 
 void DialogsTabWidget::loadData()
@@ -56,4 +73,134 @@ void DialogsTabWidget::updateDialogsList(int clientIndex)
 
 	m_currentClient = m_clients[clientIndex];
 	m_listEditorWidget.setCurrentClient(m_currentClient);
+	updateSearchResults();
+}
+
+void DialogsTabWidget::analyzeDialogs()
+{
+	const QList<Dialog> dialogs = m_listEditorWidget.currentDialogs();
+
+	QStringList report;
+	int problemDialogs = 0;
+
+	for (const Dialog& dialog : dialogs)
+	{
+		const DialogAnalysis analysis(dialog);
+
+		const bool hasProblems = !analysis.successRatioAchievable() || !analysis.unreachableNodes().isEmpty() ||
+			!analysis.deadEnds().isEmpty() || !analysis.cyclicNodes().isEmpty();
+		if (hasProblems)
+		{
+			++problemDialogs;
+		}
+
+		report.append(dialog.printableName() + (hasProblems ? " (есть проблемы)" : ""));
+		for (const QString& line : analysis.summary())
+		{
+			report.append("    " + line);
+		}
+		report.append("");
+	}
+
+	const QList<ExpectedWordsIndex::Conflict> conflicts = m_listEditorWidget.expectedWordsIndex().conflicts(m_currentClient.databaseName);
+	if (!conflicts.isEmpty())
+	{
+		report.append("Конфликты опорных слов:");
+	}
+
+	for (const ExpectedWordsIndex::Conflict& conflict : conflicts)
+	{
+		switch (conflict.type)
+		{
+		case ExpectedWordsIndex::Conflict::Type::ForbiddenSibling:
+			report.append("    \"" + conflict.entries.first().words + "\" содержит запрещенные слова \"" + conflict.entries.last().words +
+				"\" (" + conflict.entries.first().dialog + ", фаза \"" + conflict.entries.first().phaseName + "\")");
+			break;
+
+		case ExpectedWordsIndex::Conflict::Type::DuplicateInPhases:
+		{
+			QStringList phases;
+			for (const ExpectedWordsIndex::Entry& entry : conflict.entries)
+			{
+				phases.append("\"" + entry.phaseName + "\"");
+			}
+			phases.removeDuplicates();
+
+			report.append("    \"" + conflict.entries.first().words + "\" повторяется в фазах " + phases.join(", ") +
+				" (" + conflict.entries.first().dialog + ")");
+			break;
+		}
+
+		case ExpectedWordsIndex::Conflict::Type::DifferentScores:
+		{
+			QStringList scores;
+			for (const ExpectedWordsIndex::Entry& entry : conflict.entries)
+			{
+				scores.append(entry.dialog + ": " + QString::number(entry.score));
+			}
+			scores.removeDuplicates();
+
+			report.append("    \"" + conflict.entries.first().words + "\" оценивается по-разному (" + scores.join(", ") + ")");
+			break;
+		}
+		}
+	}
+
+	QMessageBox messageBox(QMessageBox::Information, "Анализ диалогов",
+		QString("Диалогов: %1, с проблемами: %2, конфликтов опорных слов: %3").arg(dialogs.size()).arg(problemDialogs).arg(conflicts.size()),
+		QMessageBox::Ok, this);
+	messageBox.setDetailedText(report.join("\n"));
+	messageBox.exec();
+}
+
+void DialogsTabWidget::replaceTexts()
+{
+	ReplaceTextsWindow* window = new ReplaceTextsWindow(m_listEditorWidget.dialogs(), m_currentClient.databaseName, this);
+	connect(window, &ReplaceTextsWindow::textsReplaced, [this](ReplaceTextsWindow::UpdatedDialogs dialogs)
+	{
+		m_listEditorWidget.updateDialogs(dialogs);
+	});
+	window->show();
+}
+
+void DialogsTabWidget::showMemoryReport()
+{
+	MemoryReportWindow* window = new MemoryReportWindow(m_listEditorWidget.dialogs(), this);
+	window->show();
+}
+
+void DialogsTabWidget::editPhaseTemplates()
+{
+	PhaseTemplatesWindow* window = new PhaseTemplatesWindow(&m_listEditorWidget.phaseTemplates(), m_listEditorWidget.dialogs(),
+		m_currentClient.databaseName, this);
+	connect(window, &PhaseTemplatesWindow::templatesChanged, [this]()
+	{
+		m_listEditorWidget.savePhaseTemplates();
+	});
+	connect(window, &PhaseTemplatesWindow::dialogsUpdated, [this](PhaseTemplateLibrary::UpdatedDialogs dialogs)
+	{
+		m_listEditorWidget.updateDialogs(dialogs);
+	});
+	window->show();
+}
+
+void DialogsTabWidget::updateSearchResults()
+{
+	m_ui.searchResultsListWidget->clear();
+
+	const QVector<DialogSearchIndex::Hit> hits = m_listEditorWidget.searchIndex().search(m_ui.searchLineEdit->text(), m_currentClient.databaseName);
+	for (const DialogSearchIndex::Hit& hit : hits)
+	{
+		QListWidgetItem* item = new QListWidgetItem(hit.dialog + ": " + DialogSearchIndex::fieldName(hit.field) + ": " + hit.text,
+			m_ui.searchResultsListWidget);
+		item->setData(Qt::UserRole, hit.dialog);
+		item->setData(Qt::UserRole + 1, hit.node);
+	}
+
+	m_ui.searchResultsListWidget->setVisible(!hits.isEmpty());
+}
+
+void DialogsTabWidget::showSearchResult(QListWidgetItem* item)
+{
+	m_listEditorWidget.showNode(item->data(Qt::UserRole).toString(), item->data(Qt::UserRole + 1).toString());
 }
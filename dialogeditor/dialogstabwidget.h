@@ -19,6 +19,12 @@ public:
 private slots:
 	void updateClientsList(Core::IBackendConnection::QueryId queryId, const QList<Core::Client>& clients);
 	void updateDialogsList(int clientIndex);
+	void analyzeDialogs();
+	void replaceTexts();
+	void showMemoryReport();
+	void editPhaseTemplates();
+	void updateSearchResults();
+	void showSearchResult(QListWidgetItem* item);
 
 private:
 	Ui::DialogsTabWidget m_ui;
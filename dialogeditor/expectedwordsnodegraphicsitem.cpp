@@ -16,12 +16,12 @@ int ExpectedWordsNodeGraphicsItem::type() const
 
 Core::AbstractDialogNode* ExpectedWordsNodeGraphicsItem::data()
 {
-	return m_expectedWords;
+	return m_expectedWords.data();
 }
 
 const Core::AbstractDialogNode* ExpectedWordsNodeGraphicsItem::data() const
 {
-	return m_expectedWords;
+	return m_expectedWords.data();
 }
 
 QString ExpectedWordsNodeGraphicsItem::getHeaderText() const
@@ -39,7 +39,8 @@ private:
 	void closeEditor();
 
 private:
-	Core::ExpectedWordsNode* m_expectedWords;
+	// Keeps the node alive while it is moved between phases
+	QExplicitlySharedDataPointer<Core::ExpectedWordsNode> m_expectedWords;
 	ExpectedWordsEditorWindow* m_editor;
 };
 
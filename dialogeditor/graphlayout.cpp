@@ -3,17 +3,6 @@
 
 #include <iostream>
 
-namespace
-{
-
-int generateId()
-{
-	static int s_id = 0;
-	return ++s_id;
-}
-
-}
-
 GraphLayout::GraphLayout(int numLayer)
 	: numLayer(numLayer)
 {
@@ -227,7 +216,8 @@ GraphLayout::GraphNode GraphLayout::createVirtualNode(const GraphNode& srcNode,
 		Point{ srcNode.x, srcNode.y } :
 		Point{ numPerLayers[curLayer - 1], curLayer - 1 };
 
-	const QString label = QString("v%1").arg(generateId());
+	// labels are unique within the layout, so layouts can run in parallel
+	const QString label = QString("v%1").arg(++lastVirtualId);
 	return createNode(numPerLayers[curLayer], curLayer, target, source, true, label);
 }
 
@@ -89,6 +89,7 @@ private:
 	double incVirt = 1;
 	int inc = 1.0;
 	int numRepeat = 20;
+	int lastVirtualId = 0;
 };
 
 std::ostream& operator<<(std::ostream& os, const GraphLayout& layout);
@@ -0,0 +1,67 @@
+#include "histogramwidget.h"
+
+#include <QPainter>
+
+#include <algorithm>
+
+HistogramWidget::HistogramWidget(QWidget* parent)
+	: QWidget(parent)
+	, m_marker(-1)
+{
+	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void HistogramWidget::setValues(const QVector<int>& values)
+{
+	m_values = values;
+	update();
+}
+
+void HistogramWidget::setMarker(int bucket)
+{
+	m_marker = bucket;
+	update();
+}
+
+QSize HistogramWidget::sizeHint() const
+{
+	return QSize(400, 200);
+}
+
+void HistogramWidget::paintEvent(QPaintEvent* /*event*/)
+{
+	QPainter painter(this);
+	painter.fillRect(rect(), palette().base());
+
+	if (m_values.isEmpty())
+	{
+		return;
+	}
+
+	const int labelsHeight = fontMetrics().height();
+	const QRectF chart = QRectF(rect()).adjusted(4.0, 4.0, -4.0, -4.0 - labelsHeight);
+	const int maxValue = std::max(1, *std::max_element(m_values.begin(), m_values.end()));
+	const qreal barWidth = chart.width() / m_values.size();
+
+	for (int bucket = 0; bucket < m_values.size(); ++bucket)
+	{
+		const qreal height = chart.height() * m_values[bucket] / maxValue;
+		const QRectF bar(chart.left() + bucket * barWidth, chart.bottom() - height, barWidth, height);
+		painter.fillRect(bar, bucket >= m_marker && m_marker >= 0 ? palette().highlight() : palette().mid());
+	}
+
+	painter.setPen(palette().text().color());
+	painter.drawLine(chart.bottomLeft(), chart.bottomRight());
+
+	const QRectF labels(chart.left(), chart.bottom(), chart.width(), labelsHeight);
+	painter.drawText(labels, Qt::AlignLeft | Qt::AlignVCenter, "0");
+	painter.drawText(labels, Qt::AlignHCenter | Qt::AlignVCenter, QString::number(m_values.size() / 2));
+	painter.drawText(labels, Qt::AlignRight | Qt::AlignVCenter, QString::number(m_values.size() - 1));
+
+	if (m_marker >= 0 && m_marker < m_values.size())
+	{
+		const qreal x = chart.left() + m_marker * barWidth;
+		painter.setPen(QPen(Qt::red, 1.0, Qt::DashLine));
+		painter.drawLine(QPointF(x, chart.top()), QPointF(x, chart.bottom()));
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QWidget>
+#include <QVector>
+
+// Bar chart of the number of values in equal buckets, with an optional marker at one of the buckets
+class HistogramWidget
+	: public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit HistogramWidget(QWidget* parent = nullptr);
+
+	void setValues(const QVector<int>& values);
+	// -1 hides the marker
+	void setMarker(int bucket);
+
+	virtual QSize sizeHint() const override;
+
+protected:
+	virtual void paintEvent(QPaintEvent* event) override;
+
+private:
+	QVector<int> m_values;
+	int m_marker;
+};
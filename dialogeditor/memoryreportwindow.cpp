@@ -0,0 +1,75 @@
+#include "memoryreportwindow.h"
+
+namespace
+{
+
+enum Column
+{
+	NameColumn,
+	TotalColumn,
+	StringsColumn,
+	ContainersColumn,
+	ObjectsColumn,
+	SharedColumn
+};
+
+double kilobytes(qint64 bytes)
+{
+	return qRound(bytes / 102.4) / 10.0;
+}
+
+QString formatKilobytes(qint64 bytes)
+{
+	return QString::number(kilobytes(bytes), 'f', 1) + " КБ";
+}
+
+// numbers are set as values, so the columns are sorted numerically
+void setUsage(QTreeWidgetItem* item, const Core::MemoryUsage& usage)
+{
+	item->setData(TotalColumn, Qt::DisplayRole, kilobytes(usage.total()));
+	item->setData(StringsColumn, Qt::DisplayRole, kilobytes(usage.strings));
+	item->setData(ContainersColumn, Qt::DisplayRole, kilobytes(usage.containers));
+	item->setData(ObjectsColumn, Qt::DisplayRole, kilobytes(usage.objects));
+	item->setData(SharedColumn, Qt::DisplayRole, kilobytes(usage.shared));
+}
+
+}
+
+MemoryReportWindow::MemoryReportWindow(const QMap<QString, QList<Core::Dialog>>& dialogs, QWidget* parent)
+	: QDialog(parent)
+{
+	m_ui.setupUi(this);
+	setAttribute(Qt::WA_DeleteOnClose, true);
+
+	connect(m_ui.closeButton, &QPushButton::clicked, this, &MemoryReportWindow::close);
+
+	const Core::ModelMemoryReport report(dialogs);
+
+	QMap<QString, QTreeWidgetItem*> clientItems;
+	for (auto it = report.clients().begin(); it != report.clients().end(); ++it)
+	{
+		QTreeWidgetItem* item = new QTreeWidgetItem(m_ui.usageTreeWidget, { it.key() });
+		setUsage(item, it.value());
+		clientItems.insert(it.key(), item);
+	}
+
+	for (const Core::ModelMemoryReport::DialogUsage& dialog : report.dialogs())
+	{
+		QTreeWidgetItem* item = new QTreeWidgetItem(clientItems[dialog.client], { dialog.dialog });
+		setUsage(item, dialog.usage);
+	}
+
+	m_ui.usageTreeWidget->sortByColumn(TotalColumn, Qt::DescendingOrder);
+	m_ui.usageTreeWidget->resizeColumnToContents(NameColumn);
+
+	const Core::MemoryUsage& total = report.total();
+	m_ui.totalLabel->setText(QString("Диалогов: %1, всего: %2 (строки: %3, контейнеры: %4, объекты: %5). "
+		"Общие строки, узлы и фазы сэкономили %6, коэффициент дедупликации %7.")
+		.arg(report.dialogs().size())
+		.arg(formatKilobytes(total.total()))
+		.arg(formatKilobytes(total.strings))
+		.arg(formatKilobytes(total.containers))
+		.arg(formatKilobytes(total.objects))
+		.arg(formatKilobytes(total.shared))
+		.arg(report.deduplicationRatio(), 0, 'f', 2));
+}
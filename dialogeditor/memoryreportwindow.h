@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ui_memoryreportwindow.h"
+
+#include "core/modelmemoryreport.h"
+
+// Memory taken by the loaded dialogs by client, dialog and component, see Core::ModelMemoryReport
+class MemoryReportWindow
+	: public QDialog
+{
+	Q_OBJECT
+
+public:
+	MemoryReportWindow(const QMap<QString, QList<Core::Dialog>>& dialogs, QWidget* parent = nullptr);
+
+private:
+	Ui::MemoryReportWindow m_ui;
+};
@@ -0,0 +1,78 @@
+#include "passratewindow.h"
+
+#include <QtConcurrent>
+
+#include <cmath>
+
+namespace
+{
+
+QString formatPercent(double rate)
+{
+	return QString::number(rate * 100.0, 'f', 1) + "%";
+}
+
+}
+
+PassRateWindow::PassRateWindow(const Core::DialogSnapshot& snapshot, QWidget* parent)
+	: QDialog(parent)
+	, m_simulator(std::make_shared<Core::DialogSimulator>(snapshot.dialog()))
+	, m_successRatio(snapshot.dialog().successRatio)
+{
+	m_ui.setupUi(this);
+	setAttribute(Qt::WA_DeleteOnClose, true);
+
+	m_ui.histogramWidget->setMarker(static_cast<int>(std::ceil(m_successRatio)));
+
+	connect(m_ui.runButton, &QPushButton::clicked, this, &PassRateWindow::onRunClicked);
+	connect(m_ui.closeButton, &QPushButton::clicked, this, &PassRateWindow::close);
+	connect(&m_estimateWatcher, &QFutureWatcher<Core::DialogSimulator::Estimate>::finished, this, &PassRateWindow::onEstimateFinished);
+}
+
+void PassRateWindow::onRunClicked()
+{
+	Core::DialogSimulator::Behaviour behaviour;
+	behaviour.wordProbability = m_ui.wordProbabilitySpinBox->value();
+	behaviour.forbiddenProbability = m_ui.forbiddenProbabilitySpinBox->value();
+	behaviour.repeatProbability = m_ui.repeatProbabilitySpinBox->value();
+	behaviour.maxAnswers = m_ui.maxAnswersSpinBox->value();
+	behaviour.maxPhaseRepeats = m_ui.maxPhaseRepeatsSpinBox->value();
+
+	const int sessions = m_ui.sessionsSpinBox->value();
+	const quint64 seed = static_cast<quint64>(m_ui.seedSpinBox->value());
+
+	m_ui.runButton->setEnabled(false);
+	m_ui.resultLabel->setText("Идет расчет...");
+	m_timer.start();
+
+	const std::shared_ptr<const Core::DialogSimulator> simulator = m_simulator;
+	m_estimateWatcher.setFuture(QtConcurrent::run([simulator, behaviour, sessions, seed]()
+	{
+		return simulator->estimate(behaviour, sessions, seed);
+	}));
+}
+
+void PassRateWindow::onEstimateFinished()
+{
+	m_ui.runButton->setEnabled(true);
+
+	const Core::DialogSimulator::Estimate estimate = m_estimateWatcher.result();
+	m_ui.histogramWidget->setValues(estimate.histogram);
+
+	QStringList otherRatios;
+	for (int successRatio = 50; successRatio <= 90; successRatio += 10)
+	{
+		otherRatios.append(QString::number(successRatio) + "% - " + formatPercent(estimate.passRate(successRatio)));
+	}
+
+	QStringList lines;
+	lines.append(QString("Сессий: %1, дошли до конца: %2, прошли: %3")
+		.arg(estimate.sessions)
+		.arg(formatPercent(estimate.sessions > 0 ? static_cast<double>(estimate.finished) / estimate.sessions : 0.0))
+		.arg(formatPercent(estimate.passRate())));
+	lines.append("Средний результат дошедших до конца: " + QString::number(estimate.meanScore, 'f', 1) + "%");
+	lines.append("Прошли бы при проходном проценте " + otherRatios.join(", "));
+	lines.append("Время расчета: " + QString::number(m_timer.elapsed()) + " мс");
+
+	m_ui.resultLabel->setText(lines.join("\n"));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ui_passratewindow.h"
+
+#include "core/dialogsimulator.h"
+#include "core/dialogsnapshot.h"
+
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <memory>
+
+// Estimates the share of random learners passing the dialog, see Core::DialogSimulator::estimate
+class PassRateWindow
+	: public QDialog
+{
+	Q_OBJECT
+
+public:
+	// The estimation runs in the thread pool, so it gets a snapshot the editor can't modify
+	PassRateWindow(const Core::DialogSnapshot& snapshot, QWidget* parent = nullptr);
+
+private slots:
+	void onRunClicked();
+	void onEstimateFinished();
+
+private:
+	Ui::PassRateWindow m_ui;
+
+	// shared with the running estimation, which may outlive the window
+	std::shared_ptr<const Core::DialogSimulator> m_simulator;
+	double m_successRatio;
+
+	QFutureWatcher<Core::DialogSimulator::Estimate> m_estimateWatcher;
+	QElapsedTimer m_timer;
+};
@@ -0,0 +1,170 @@
+#include "phasetemplateswindow.h"
+
+#include <QMessageBox>
+
+using namespace Core;
+
+PhaseTemplatesWindow::PhaseTemplatesWindow(PhaseTemplateLibrary* library, const Dialogs& dialogs, const QString& currentClient, QWidget* parent)
+	: QDialog(parent)
+	, m_library(library)
+	, m_dialogs(dialogs)
+	, m_currentClient(currentClient)
+{
+	m_ui.setupUi(this);
+	setAttribute(Qt::WA_DeleteOnClose, true);
+
+	for (const Dialog& dialog : currentDialogs())
+	{
+		m_ui.dialogComboBox->addItem(dialog.printableName());
+	}
+
+	connect(m_ui.dialogComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &PhaseTemplatesWindow::updatePhases);
+	connect(m_ui.templatesListWidget, &QListWidget::currentRowChanged, this, &PhaseTemplatesWindow::updateButtons);
+	connect(m_ui.phaseComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &PhaseTemplatesWindow::updateButtons);
+	connect(m_ui.nameLineEdit, &QLineEdit::textChanged, this, &PhaseTemplatesWindow::updateButtons);
+	connect(m_ui.createButton, &QPushButton::clicked, this, &PhaseTemplatesWindow::onCreateClicked);
+	connect(m_ui.updateButton, &QPushButton::clicked, this, &PhaseTemplatesWindow::onUpdateClicked);
+	connect(m_ui.renameButton, &QPushButton::clicked, this, &PhaseTemplatesWindow::onRenameClicked);
+	connect(m_ui.removeButton, &QPushButton::clicked, this, &PhaseTemplatesWindow::onRemoveClicked);
+	connect(m_ui.closeButton, &QPushButton::clicked, this, &PhaseTemplatesWindow::close);
+
+	updateTemplates();
+}
+
+void PhaseTemplatesWindow::onCreateClicked()
+{
+	const PhaseNode* phase = selectedPhase();
+	Q_ASSERT(phase);
+
+	const QString matching = m_library->match(*phase);
+	if (!matching.isEmpty())
+	{
+		QMessageBox::warning(this, windowTitle(), "Фаза уже используется как шаблон \"" + m_library->find(matching)->name + "\".");
+		return;
+	}
+
+	m_library->add(m_ui.nameLineEdit->text().trimmed(), *phase);
+	emit templatesChanged();
+	updateTemplates();
+}
+
+void PhaseTemplatesWindow::onUpdateClicked()
+{
+	const PhaseNode* phase = selectedPhase();
+	const QString id = selectedTemplate();
+	Q_ASSERT(phase && !id.isEmpty());
+
+	if (!m_library->canUpdate(id, *phase))
+	{
+		QMessageBox::warning(this, windowTitle(), "Фаза не использует шаблон \"" + m_library->find(id)->name + "\", его узлы нельзя ею заменить.");
+		return;
+	}
+
+	const int usages = m_library->usages(id, m_dialogs);
+	const QString question = QString("Узлы шаблона \"%1\" будут заменены узлами выбранной фазы во всех диалогах, которые его используют (фаз: %2). Продолжить?")
+		.arg(m_library->find(id)->name).arg(usages);
+	if (QMessageBox::question(this, windowTitle(), question) != QMessageBox::Yes)
+	{
+		return;
+	}
+
+	const PhaseTemplateLibrary::UpdatedDialogs updated = m_library->update(id, *phase, m_dialogs);
+	emit templatesChanged();
+	if (!updated.isEmpty())
+	{
+		emit dialogsUpdated(updated);
+	}
+
+	// the dialogs are reloaded after saving, the window would show stale phases
+	close();
+}
+
+void PhaseTemplatesWindow::onRenameClicked()
+{
+	m_library->rename(selectedTemplate(), m_ui.nameLineEdit->text().trimmed());
+	emit templatesChanged();
+	updateTemplates();
+}
+
+void PhaseTemplatesWindow::onRemoveClicked()
+{
+	// phases using the template keep their nodes, only the link is lost
+	m_library->remove(selectedTemplate());
+	emit templatesChanged();
+	updateTemplates();
+}
+
+void PhaseTemplatesWindow::updatePhases()
+{
+	m_ui.phaseComboBox->clear();
+
+	const int index = m_ui.dialogComboBox->currentIndex();
+	if (index != -1)
+	{
+		for (const PhaseNode& phase : currentDialogs().at(index).phases)
+		{
+			const QString matching = m_library->match(phase);
+			m_ui.phaseComboBox->addItem(matching.isEmpty() ? phase.name() : phase.name() + " (шаблон \"" + m_library->find(matching)->name + "\")");
+		}
+	}
+
+	updateButtons();
+}
+
+void PhaseTemplatesWindow::updateButtons()
+{
+	const PhaseNode* phase = selectedPhase();
+	const bool hasPhase = phase != nullptr;
+	const bool hasTemplate = !selectedTemplate().isEmpty();
+	const bool hasName = !m_ui.nameLineEdit->text().trimmed().isEmpty();
+
+	m_ui.createButton->setEnabled(hasPhase && hasName);
+	// only a phase using the template, possibly edited since, can replace its nodes
+	m_ui.updateButton->setEnabled(hasPhase && hasTemplate && m_library->canUpdate(selectedTemplate(), *phase));
+	m_ui.renameButton->setEnabled(hasTemplate && hasName);
+	m_ui.removeButton->setEnabled(hasTemplate);
+}
+
+void PhaseTemplatesWindow::updateTemplates()
+{
+	m_ui.templatesListWidget->clear();
+
+	int totalUsages = 0;
+	for (const PhaseTemplateLibrary::Template& item : m_library->templates())
+	{
+		const int usages = m_library->usages(item.id, m_dialogs);
+		totalUsages += usages;
+
+		QListWidgetItem* listItem = new QListWidgetItem(QString("%1 (используется в фазах: %2)").arg(item.name).arg(usages), m_ui.templatesListWidget);
+		listItem->setData(Qt::UserRole, item.id);
+	}
+
+	m_ui.resultLabel->setText(QString("Шаблонов: %1, фаз с общими узлами: %2").arg(m_library->templates().size()).arg(totalUsages));
+	updatePhases();
+}
+
+const PhaseNode* PhaseTemplatesWindow::selectedPhase() const
+{
+	const int dialogIndex = m_ui.dialogComboBox->currentIndex();
+	const int phaseIndex = m_ui.phaseComboBox->currentIndex();
+	if (dialogIndex == -1 || phaseIndex == -1)
+	{
+		return nullptr;
+	}
+
+	const QList<PhaseNode>& phases = currentDialogs().at(dialogIndex).phases;
+	return phaseIndex < phases.size() ? &phases[phaseIndex] : nullptr;
+}
+
+const QList<Dialog>& PhaseTemplatesWindow::currentDialogs() const
+{
+	static const QList<Dialog> s_noDialogs;
+	const auto it = m_dialogs.constFind(m_currentClient);
+	return it == m_dialogs.constEnd() ? s_noDialogs : it.value();
+}
+
+QString PhaseTemplatesWindow::selectedTemplate() const
+{
+	const QListWidgetItem* item = m_ui.templatesListWidget->currentItem();
+	return item ? item->data(Qt::UserRole).toString() : QString();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ui_phasetemplateswindow.h"
+
+#include "core/phasetemplatelibrary.h"
+
+// Creates phase templates from phases of the current client dialogs and propagates template changes,
+// see Core::PhaseTemplateLibrary
+class PhaseTemplatesWindow
+	: public QDialog
+{
+	Q_OBJECT
+
+public:
+	typedef QMap<QString, QList<Core::Dialog>> Dialogs;
+
+	PhaseTemplatesWindow(Core::PhaseTemplateLibrary* library, const Dialogs& dialogs, const QString& currentClient, QWidget* parent = nullptr);
+
+signals:
+	void templatesChanged();
+	void dialogsUpdated(Core::PhaseTemplateLibrary::UpdatedDialogs dialogs);
+
+private slots:
+	void onCreateClicked();
+	void onUpdateClicked();
+	void onRenameClicked();
+	void onRemoveClicked();
+	void updatePhases();
+	void updateButtons();
+
+private:
+	void updateTemplates();
+	const QList<Core::Dialog>& currentDialogs() const;
+	const Core::PhaseNode* selectedPhase() const;
+	QString selectedTemplate() const;
+
+private:
+	Ui::PhaseTemplatesWindow m_ui;
+
+	Core::PhaseTemplateLibrary* m_library;
+	Dialogs m_dialogs;
+	QString m_currentClient;
+};
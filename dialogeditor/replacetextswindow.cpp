@@ -0,0 +1,87 @@
+#include "replacetextswindow.h"
+
+#include <QElapsedTimer>
+
+using namespace Core;
+
+ReplaceTextsWindow::ReplaceTextsWindow(const Dialogs& dialogs, const QString& currentClient, QWidget* parent)
+	: QDialog(parent)
+	, m_dialogs(dialogs)
+	, m_currentClient(currentClient)
+{
+	m_ui.setupUi(this);
+	setAttribute(Qt::WA_DeleteOnClose, true);
+
+	m_ui.replaceButton->setEnabled(false);
+
+	connect(m_ui.previewButton, &QPushButton::clicked, this, &ReplaceTextsWindow::onPreviewClicked);
+	connect(m_ui.replaceButton, &QPushButton::clicked, this, &ReplaceTextsWindow::onReplaceClicked);
+	connect(m_ui.closeButton, &QPushButton::clicked, this, &ReplaceTextsWindow::close);
+
+	// the preview becomes stale as soon as any of the parameters changes
+	connect(m_ui.findLineEdit, &QLineEdit::textChanged, this, &ReplaceTextsWindow::resetPreview);
+	connect(m_ui.replaceLineEdit, &QLineEdit::textChanged, this, &ReplaceTextsWindow::resetPreview);
+	connect(m_ui.regularExpressionCheckBox, &QCheckBox::toggled, this, &ReplaceTextsWindow::resetPreview);
+	connect(m_ui.caseSensitiveCheckBox, &QCheckBox::toggled, this, &ReplaceTextsWindow::resetPreview);
+	connect(m_ui.allClientsCheckBox, &QCheckBox::toggled, this, &ReplaceTextsWindow::resetPreview);
+}
+
+void ReplaceTextsWindow::onPreviewClicked()
+{
+	resetPreview();
+
+	const DialogRewriter rewriter(m_ui.findLineEdit->text(), m_ui.replaceLineEdit->text(),
+		m_ui.regularExpressionCheckBox->isChecked(), m_ui.caseSensitiveCheckBox->isChecked());
+	if (!rewriter.isValid())
+	{
+		m_ui.resultLabel->setText(rewriter.errorString());
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	int matches = 0;
+	int dialogs = 0;
+	for (auto it = m_dialogs.begin(); it != m_dialogs.end(); ++it)
+	{
+		if (!m_ui.allClientsCheckBox->isChecked() && it.key() != m_currentClient)
+		{
+			continue;
+		}
+
+		const DialogRewriter::Result result = rewriter.rewrite(it.value());
+		if (result.updated.isEmpty())
+		{
+			continue;
+		}
+
+		m_updated.insert(it.key(), result.updated);
+		matches += result.matches.size();
+		dialogs += result.updated.size();
+
+		for (const DialogRewriter::Match& match : result.matches)
+		{
+			const QString client = m_ui.allClientsCheckBox->isChecked() ? it.key() + ": " : QString();
+			m_ui.matchesListWidget->addItem(client + match.dialog + ": " + DialogSearchIndex::fieldName(match.field) + ": " +
+				match.before + " → " + match.after);
+		}
+	}
+
+	m_ui.resultLabel->setText(QString("Замен: %1, диалогов: %2, время поиска: %3 мс").arg(matches).arg(dialogs).arg(timer.elapsed()));
+	m_ui.replaceButton->setEnabled(!m_updated.isEmpty());
+}
+
+void ReplaceTextsWindow::onReplaceClicked()
+{
+	emit textsReplaced(m_updated);
+	close();
+}
+
+void ReplaceTextsWindow::resetPreview()
+{
+	m_updated.clear();
+	m_ui.matchesListWidget->clear();
+	m_ui.resultLabel->clear();
+	m_ui.replaceButton->setEnabled(false);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ui_replacetextswindow.h"
+
+#include "core/dialogrewriter.h"
+
+#include <QMap>
+
+// Replaces a text in all dialogs of a client or of all clients, see Core::DialogRewriter
+class ReplaceTextsWindow
+	: public QDialog
+{
+	Q_OBJECT
+
+public:
+	typedef QMap<QString, QList<Core::Dialog>> Dialogs;
+	// source dialogs to the rewritten ones by client
+	typedef QMap<QString, QMap<Core::Dialog, Core::Dialog>> UpdatedDialogs;
+
+	ReplaceTextsWindow(const Dialogs& dialogs, const QString& currentClient, QWidget* parent = nullptr);
+
+signals:
+	void textsReplaced(UpdatedDialogs dialogs);
+
+private slots:
+	void onPreviewClicked();
+	void onReplaceClicked();
+	void resetPreview();
+
+private:
+	Ui::ReplaceTextsWindow m_ui;
+
+	Dialogs m_dialogs;
+	QString m_currentClient;
+	// the previewed changes are applied as is
+	UpdatedDialogs m_updated;
+};
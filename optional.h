@@ -7,6 +7,8 @@ class Optional
 {
 public:
 	Optional() = default;
+	Optional(const Optional<T>& other) = default;
+	Optional(Optional<T>&& other) = default;
 
 	Optional<T>& operator=(const Optional<T>& other)
 	{
@@ -17,6 +19,15 @@ public:
 		return *this;
 	}
 
+	Optional<T>& operator=(Optional<T>&& other)
+	{
+		if (this != &other)
+		{
+			m_value = std::move(other.m_value);
+		}
+		return *this;
+	}
+
 	Optional<T>& operator=(const T& value)
 	{
 		m_value.setValue(value);
@@ -53,3 +64,10 @@ inline bool operator!=(const Optional<T>& left, const Optional<T>& right)
 {
 	return !(left == right);
 }
+
+// Consistent with operator==, an empty value hashes as the default one
+template <typename T>
+inline uint qHash(const Optional<T>& value, uint seed = 0)
+{
+	return qHash(*value, seed);
+}
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Command line validator for dialog JSON files
+#
+#-------------------------------------------------
+
+QT += core concurrent
+QT -= gui
+
+TARGET = DialogBatchValidator
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../core/core.pri)
+
+SOURCES += \
+	main.cpp
@@ -0,0 +1,308 @@
+#include "core/dialogjsonreader.h"
+#include "core/dialogvalidator.h"
+#include "core/dialoganalysis.h"
+#include "core/stringpool.h"
+#include "core/memoryusage.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <iostream>
+
+namespace
+{
+
+struct Input
+{
+	QString source;
+	// line number for JSON Lines files, 0 for JSON files
+	int line;
+	QByteArray json;
+};
+
+bool readInputs(const QString& path, QList<Input>& inputs, QString& error)
+{
+	const QFileInfo info(path);
+
+	if (info.isDir())
+	{
+		const QDir directory(path);
+		for (const QString& fileName : directory.entryList({ "*.json" }, QDir::Files, QDir::Name))
+		{
+			QFile file(directory.filePath(fileName));
+			if (!file.open(QIODevice::ReadOnly))
+			{
+				error = "Can't open " + file.fileName();
+				return false;
+			}
+
+			inputs.append({ file.fileName(), 0, file.readAll() });
+		}
+
+		return true;
+	}
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		error = "Can't open " + path;
+		return false;
+	}
+
+	int line = 0;
+	while (!file.atEnd())
+	{
+		const QByteArray json = file.readLine().trimmed();
+		++line;
+
+		if (!json.isEmpty())
+		{
+			inputs.append({ path, line, json });
+		}
+	}
+
+	return true;
+}
+
+double elapsedMs(const QElapsedTimer& timer)
+{
+	return timer.nsecsElapsed() / 1000000.0;
+}
+
+bool s_analyze = false;
+
+QJsonObject toJson(const Core::DialogAnalysis::ScoreRange& range)
+{
+	return { { "min", range.min }, { "max", range.max } };
+}
+
+QJsonArray toJson(const QList<Core::AbstractDialogNode::Id>& ids)
+{
+	return QJsonArray::fromStringList(ids);
+}
+
+QJsonObject analyze(const Core::Dialog& dialog)
+{
+	const Core::DialogAnalysis analysis(dialog);
+
+	QJsonArray phases;
+	for (const Core::DialogAnalysis::Phase& phase : analysis.phases())
+	{
+		phases.append(QJsonObject {
+			{ "name", phase.name },
+			{ "paths", phase.paths },
+			{ "score", toJson(phase.score) },
+			{ "requiredScore", phase.requiredScore }
+		});
+	}
+
+	return {
+		{ "paths", analysis.paths() },
+		{ "score", toJson(analysis.score()) },
+		{ "maxPossibleScore", analysis.maxPossibleScore() },
+		{ "successRatioAchievable", analysis.successRatioAchievable() },
+		{ "phases", phases },
+		{ "unreachableNodes", toJson(analysis.unreachableNodes()) },
+		{ "deadEnds", toJson(analysis.deadEnds()) },
+		{ "cyclicNodes", toJson(analysis.cyclicNodes()) }
+	};
+}
+
+bool s_memory = false;
+
+QJsonObject toJson(const Core::MemoryUsage& usage)
+{
+	return {
+		{ "total", usage.total() },
+		{ "strings", usage.strings },
+		{ "containers", usage.containers },
+		{ "objects", usage.objects },
+		{ "shared", usage.shared }
+	};
+}
+
+QJsonObject validate(const Input& input)
+{
+	QJsonObject report;
+	report["source"] = input.source;
+	if (input.line > 0)
+	{
+		report["line"] = input.line;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	bool ok = false;
+	Core::DialogJsonReader reader;
+	const Core::Dialog dialog = reader.read(input.json, ok);
+	report["parseMs"] = elapsedMs(timer);
+
+	if (!ok)
+	{
+		report["valid"] = false;
+		report["errors"] = QJsonArray { "Не удалось прочитать диалог: " + reader.errorString() };
+		return report;
+	}
+
+	timer.restart();
+	const QList<Core::DialogValidator::Violation> violations = Core::DialogValidator::validate(dialog);
+	report["validateMs"] = elapsedMs(timer);
+
+	QJsonArray errors;
+	for (const Core::DialogValidator::Violation& violation : violations)
+	{
+		errors.append(violation.message);
+	}
+
+	report["name"] = dialog.name;
+	report["difficulty"] = static_cast<int>(dialog.difficulty);
+	report["valid"] = violations.isEmpty();
+	report["errors"] = errors;
+
+	if (s_analyze)
+	{
+		timer.restart();
+		report["analysis"] = analyze(dialog);
+		report["analyzeMs"] = elapsedMs(timer);
+	}
+
+	if (s_memory)
+	{
+		Core::MemoryCounter counter;
+		dialog.accountMemory(counter);
+		report["memory"] = toJson(counter.usage());
+	}
+
+	return report;
+}
+
+bool s_verbose = false;
+
+void messageHandler(QtMsgType type, const QMessageLogContext& /*context*/, const QString& message)
+{
+	// the model logs every step of the score calculation, that's too much for thousands of dialogs
+	if (type == QtDebugMsg && !s_verbose)
+	{
+		return;
+	}
+
+	std::cerr << message.toStdString() << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication application(argc, argv);
+	QCoreApplication::setApplicationName("DialogBatchValidator");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Validates dialogs from a directory of JSON files or from a JSON Lines file. "
+		"Prints a JSON Lines report, one object per dialog.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("input", "Directory with *.json files or a JSON Lines file");
+
+	const QCommandLineOption threadsOption({ "j", "threads" }, "Number of worker threads (all cores by default)", "count");
+	const QCommandLineOption outputOption({ "o", "output" }, "Report file (standard output by default)", "file");
+	const QCommandLineOption verboseOption({ "v", "verbose" }, "Print debug output of the model");
+	const QCommandLineOption analyzeOption({ "a", "analyze" }, "Add paths and score ranges of every dialog to the report");
+	const QCommandLineOption memoryOption({ "m", "memory" }, "Add approximate memory taken by every dialog in the editor to the report");
+	parser.addOptions({ threadsOption, outputOption, verboseOption, analyzeOption, memoryOption });
+
+	parser.process(application);
+
+	const QStringList arguments = parser.positionalArguments();
+	if (arguments.size() != 1)
+	{
+		parser.showHelp(2);
+	}
+
+	s_verbose = parser.isSet(verboseOption);
+	s_analyze = parser.isSet(analyzeOption);
+	s_memory = parser.isSet(memoryOption);
+	qInstallMessageHandler(messageHandler);
+
+	if (parser.isSet(threadsOption))
+	{
+		const int threads = parser.value(threadsOption).toInt();
+		if (threads <= 0)
+		{
+			std::cerr << "Invalid number of threads" << std::endl;
+			return 2;
+		}
+
+		QThreadPool::globalInstance()->setMaxThreadCount(threads);
+	}
+
+	QList<Input> inputs;
+	QString error;
+	if (!readInputs(arguments.first(), inputs, error))
+	{
+		std::cerr << error.toStdString() << std::endl;
+		return 2;
+	}
+
+	QFile output;
+	bool opened = false;
+	if (parser.isSet(outputOption))
+	{
+		output.setFileName(parser.value(outputOption));
+		opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	}
+	else
+	{
+		opened = output.open(stdout, QIODevice::WriteOnly);
+	}
+
+	if (!opened)
+	{
+		std::cerr << "Can't open the report file" << std::endl;
+		return 2;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const QList<QJsonObject> reports = QtConcurrent::blockingMapped(inputs, validate);
+
+	int invalid = 0;
+	qint64 memory = 0;
+	for (const QJsonObject& report : reports)
+	{
+		if (!report["valid"].toBool())
+		{
+			++invalid;
+		}
+
+		memory += static_cast<qint64>(report["memory"].toObject()["total"].toDouble());
+
+		output.write(QJsonDocument(report).toJson(QJsonDocument::Compact));
+		output.write("\n");
+	}
+	output.flush();
+
+	std::cerr << reports.size() << " dialogs, " << invalid << " invalid, "
+		<< elapsedMs(timer) << " ms, " << QThreadPool::globalInstance()->maxThreadCount() << " threads" << std::endl;
+
+	// shared default texts, what the editor saves on the same dialogs
+	const Core::StringPool::Statistics pool = Core::StringPool::statistics();
+	std::cerr << pool.strings << " pooled texts, " << pool.bytes << " bytes, "
+		<< pool.savedBytes << " bytes of duplicates saved" << std::endl;
+
+	if (s_memory)
+	{
+		// every dialog is counted on its own, texts shared between dialogs are counted in each of them
+		std::cerr << memory << " bytes taken by the dialogs" << std::endl;
+	}
+
+	return invalid == 0 ? 0 : 1;
+}
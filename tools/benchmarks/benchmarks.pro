@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Command line benchmarks of the dialog model on real dialogs
+#
+#-------------------------------------------------
+
+QT += core concurrent
+QT -= gui
+
+TARGET = DialogBenchmarks
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../core/core.pri)
+
+SOURCES += \
+	main.cpp
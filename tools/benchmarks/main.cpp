@@ -0,0 +1,598 @@
+#include "core/dialogbinaryreader.h"
+#include "core/dialogbinarywriter.h"
+#include "core/dialogjsonreader.h"
+#include "core/dialogjsonwriter.h"
+#include "core/dialogsearchindex.h"
+#include "core/expectedwordsmatcher.h"
+#include "core/textnormalizer.h"
+#include "core/fuzzymatcher.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <iostream>
+
+namespace
+{
+
+bool readDialogs(const QString& path, QList<Core::Dialog>& dialogs, QString& error)
+{
+	QList<QByteArray> inputs;
+
+	const QFileInfo info(path);
+	if (info.isDir())
+	{
+		const QDir directory(path);
+		for (const QString& fileName : directory.entryList({ "*.json" }, QDir::Files, QDir::Name))
+		{
+			QFile file(directory.filePath(fileName));
+			if (!file.open(QIODevice::ReadOnly))
+			{
+				error = "Can't open " + file.fileName();
+				return false;
+			}
+
+			inputs.append(file.readAll());
+		}
+	}
+	else
+	{
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			error = "Can't open " + path;
+			return false;
+		}
+
+		while (!file.atEnd())
+		{
+			const QByteArray json = file.readLine().trimmed();
+			if (!json.isEmpty())
+			{
+				inputs.append(json);
+			}
+		}
+	}
+
+	for (const QByteArray& json : inputs)
+	{
+		bool ok = false;
+		Core::DialogJsonReader reader;
+		const Core::Dialog dialog = reader.read(json, ok);
+
+		// the validator reports broken dialogs, here they are just skipped
+		if (ok)
+		{
+			dialogs.append(dialog);
+		}
+	}
+
+	return true;
+}
+
+int s_iterations = 10;
+
+// Milliseconds per iteration, the first run warms the caches and isn't counted
+template <typename Function>
+double measure(Function function)
+{
+	function();
+
+	QElapsedTimer timer;
+	timer.start();
+	for (int i = 0; i < s_iterations; ++i)
+	{
+		function();
+	}
+
+	return timer.nsecsElapsed() / 1000000.0 / s_iterations;
+}
+
+void report(const char* name, double ms, const QString& details = QString())
+{
+	std::cout << name << ": " << ms << " ms";
+	if (!details.isEmpty())
+	{
+		std::cout << ", " << details.toStdString();
+	}
+	std::cout << std::endl;
+}
+
+// Swaps two characters in the middle of the phrase, one typo for the fuzzy search
+QString withTypo(const QString& phrase)
+{
+	QString result = phrase;
+	const int middle = result.size() / 2;
+	if (middle > 0 && middle < result.size())
+	{
+		const QChar c = result[middle - 1];
+		result[middle - 1] = result[middle];
+		result[middle] = c;
+	}
+	return result;
+}
+
+// Client replicas of a phase followed by its expected words, so every answer matches one phrase at least
+QStringList answers(const Core::Dialog& dialog, bool typos = false)
+{
+	QStringList result;
+
+	for (const Core::PhaseNode& phase : dialog.phases)
+	{
+		QStringList replicas;
+		QStringList phrases;
+		for (const Core::AbstractDialogNode* node : phase.nodes())
+		{
+			if (const Core::ClientReplicaNode* replicaNode = node->as<Core::ClientReplicaNode>())
+			{
+				replicas.append(replicaNode->replica());
+			}
+			else if (const Core::ExpectedWordsNode* expectedWordsNode = node->as<Core::ExpectedWordsNode>())
+			{
+				for (const Core::ExpectedWords& words : expectedWordsNode->expectedWords())
+				{
+					phrases.append(typos ? withTypo(words.words) : words.words);
+				}
+			}
+		}
+
+		for (int i = 0; i < phrases.size(); ++i)
+		{
+			result.append(replicas.isEmpty() ? phrases[i] : replicas[i % replicas.size()] + " " + phrases[i]);
+		}
+	}
+
+	return result;
+}
+
+// Lower case and single spaces only, what the simulator did before stemming
+QString simpleNormalize(const QString& text)
+{
+	QString result = text.toLower().simplified();
+	result.replace(QChar(0x0451), QChar(0x0435));
+	return result;
+}
+
+// Runs before the other benchmarks, which fill the stem cache
+void benchmarkNormalizer(const QList<Core::Dialog>& dialogs)
+{
+	QStringList texts;
+	for (const Core::Dialog& dialog : dialogs)
+	{
+		texts.append(answers(dialog));
+	}
+
+	int words = 0;
+	for (const QString& text : texts)
+	{
+		words += Core::TextNormalizer::words(text).size();
+	}
+
+	const auto normalizeAll = [&texts](QString (*normalize)(const QString&))
+	{
+		int size = 0;
+		for (const QString& text : texts)
+		{
+			size += normalize(text).size();
+		}
+		return size;
+	};
+
+	// the stems are cached for the whole process, so the cold pass is measured once
+	QElapsedTimer timer;
+	timer.start();
+	normalizeAll(Core::TextNormalizer::normalize);
+	const double coldMs = timer.nsecsElapsed() / 1000000.0;
+
+	const double cachedMs = measure([&normalizeAll] { normalizeAll(Core::TextNormalizer::normalize); });
+	const double simpleMs = measure([&normalizeAll] { normalizeAll(simpleNormalize); });
+
+	const auto throughput = [words](double ms)
+	{
+		return QString("%1 words/s").arg(ms > 0.0 ? qRound64(words * 1000.0 / ms) : 0);
+	};
+
+	report("lower case only", simpleMs, throughput(simpleMs));
+	report("stemming, cold", coldMs, throughput(coldMs));
+	report("stemming, cached stems", cachedMs, throughput(cachedMs));
+}
+
+// Every phrase of the dialog is searched in every answer, like the simulator did before the automaton
+int naiveMatch(const Core::ExpectedWordsMatcher& matcher, const QStringList& normalizedAnswers)
+{
+	int hits = 0;
+	for (const QString& answer : normalizedAnswers)
+	{
+		for (const Core::ExpectedWordsMatcher::Pattern& pattern : matcher.patterns())
+		{
+			if (answer.contains(pattern.words))
+			{
+				++hits;
+			}
+		}
+	}
+	return hits;
+}
+
+int automatonMatch(const Core::ExpectedWordsMatcher& matcher, const QStringList& normalizedAnswers)
+{
+	int hits = 0;
+	for (const QString& answer : normalizedAnswers)
+	{
+		hits += matcher.match(answer).size();
+	}
+	return hits;
+}
+
+void benchmarkMatcher(const QList<Core::Dialog>& dialogs)
+{
+	QList<std::shared_ptr<const Core::ExpectedWordsMatcher>> matchers;
+	const double compileMs = measure([&dialogs, &matchers]
+	{
+		matchers.clear();
+		for (const Core::Dialog& dialog : dialogs)
+		{
+			matchers.append(std::make_shared<Core::ExpectedWordsMatcher>(dialog));
+		}
+	});
+
+	QList<QStringList> normalizedAnswers;
+	int patterns = 0;
+	int answersCount = 0;
+	for (int i = 0; i < dialogs.size(); ++i)
+	{
+		QStringList normalized;
+		for (const QString& answer : answers(dialogs[i]))
+		{
+			normalized.append(Core::ExpectedWordsMatcher::normalize(answer));
+		}
+		normalizedAnswers.append(normalized);
+
+		patterns += matchers[i]->patterns().size();
+		answersCount += normalized.size();
+	}
+
+	int naiveHits = 0;
+	const double naiveMs = measure([&]
+	{
+		naiveHits = 0;
+		for (int i = 0; i < dialogs.size(); ++i)
+		{
+			naiveHits += naiveMatch(*matchers[i], normalizedAnswers[i]);
+		}
+	});
+
+	int automatonHits = 0;
+	const double automatonMs = measure([&]
+	{
+		automatonHits = 0;
+		for (int i = 0; i < dialogs.size(); ++i)
+		{
+			automatonHits += automatonMatch(*matchers[i], normalizedAnswers[i]);
+		}
+	});
+
+	report("matcher compile", compileMs, QString("%1 patterns").arg(patterns));
+	report("naive scan", naiveMs, QString("%1 answers, %2 hits").arg(answersCount).arg(naiveHits));
+	// the automaton also reports repeated phrases, so the hit counts may differ
+	report("automaton", automatonMs, QString("%1 answers, %2 hits").arg(answersCount).arg(automatonHits));
+}
+
+}
+
+void benchmarkFuzzyMatcher(const QList<Core::Dialog>& dialogs)
+{
+	const int maxTypos = 2;
+
+	QList<std::shared_ptr<const Core::ExpectedWordsMatcher>> matchers;
+	QList<QVector<Core::FuzzyMatcher>> fuzzyMatchers;
+	QList<QStringList> normalizedAnswers;
+	qint64 characters = 0;
+	for (const Core::Dialog& dialog : dialogs)
+	{
+		matchers.append(std::make_shared<Core::ExpectedWordsMatcher>(dialog));
+
+		QVector<Core::FuzzyMatcher> phrases;
+		for (const Core::ExpectedWordsMatcher::Pattern& pattern : matchers.last()->patterns())
+		{
+			phrases.append(Core::FuzzyMatcher(pattern.words));
+		}
+		fuzzyMatchers.append(phrases);
+
+		QStringList normalized;
+		for (const QString& answer : answers(dialog, true))
+		{
+			normalized.append(Core::ExpectedWordsMatcher::normalize(answer));
+			characters += normalized.last().size() * phrases.size();
+		}
+		normalizedAnswers.append(normalized);
+	}
+
+	// every phrase against every answer, the work the matcher saves by searching only phrases not found exactly
+	int kernelHits = 0;
+	const double kernelMs = measure([&]
+	{
+		kernelHits = 0;
+		for (int i = 0; i < dialogs.size(); ++i)
+		{
+			for (const QString& answer : normalizedAnswers[i])
+			{
+				for (const Core::FuzzyMatcher& phrase : fuzzyMatchers[i])
+				{
+					if (phrase.distance(answer, maxTypos) >= 0)
+					{
+						++kernelHits;
+					}
+				}
+			}
+		}
+	});
+
+	int exactHits = 0;
+	const double exactMs = measure([&]
+	{
+		exactHits = 0;
+		for (int i = 0; i < dialogs.size(); ++i)
+		{
+			for (const QString& answer : normalizedAnswers[i])
+			{
+				exactHits += matchers[i]->match(answer).size();
+			}
+		}
+	});
+
+	int fuzzyHits = 0;
+	const double fuzzyMs = measure([&]
+	{
+		fuzzyHits = 0;
+		for (int i = 0; i < dialogs.size(); ++i)
+		{
+			for (const QString& answer : normalizedAnswers[i])
+			{
+				fuzzyHits += matchers[i]->match(answer, maxTypos).size();
+			}
+		}
+	});
+
+	const qint64 charactersPerSecond = kernelMs > 0.0 ? qRound64(characters * 1000.0 / kernelMs) : 0;
+	report("fuzzy kernel", kernelMs, QString("%1 characters/s, %2 hits").arg(charactersPerSecond).arg(kernelHits));
+	report("answers with typos, exact", exactMs, QString("%1 hits").arg(exactHits));
+	report("answers with typos, fuzzy", fuzzyMs, QString("%1 hits").arg(fuzzyHits));
+}
+
+}
+
+void benchmarkJsonWriter(const QList<Core::Dialog>& dialogs)
+{
+	Core::DialogJsonWriter writer;
+
+	qint64 domSize = 0;
+	const double domMs = measure([&]
+	{
+		domSize = 0;
+		for (const Core::Dialog& dialog : dialogs)
+		{
+			domSize += QJsonDocument(writer.writeToObject(dialog)).toJson(QJsonDocument::Compact).size();
+		}
+	});
+
+	// one buffer for all dialogs, like the backend connection reuses it for the messages
+	QByteArray buffer;
+	qint64 streamSize = 0;
+	const double streamMs = measure([&]
+	{
+		streamSize = 0;
+		for (const Core::Dialog& dialog : dialogs)
+		{
+			buffer.resize(0);
+			writer.write(dialog, buffer);
+			streamSize += buffer.size();
+		}
+	});
+
+	report("JSON, QJsonObject tree", domMs, QString("%1 bytes").arg(domSize));
+	report("JSON, stream writer", streamMs, QString("%1 bytes").arg(streamSize));
+}
+
+}
+
+void benchmarkBinaryFormat(const QList<Core::Dialog>& dialogs)
+{
+	Core::DialogJsonWriter jsonWriter;
+	Core::DialogBinaryWriter binaryWriter;
+
+	QList<QByteArray> jsonData;
+	QList<QByteArray> binaryData;
+	qint64 jsonSize = 0;
+	qint64 binarySize = 0;
+	for (const Core::Dialog& dialog : dialogs)
+	{
+		QByteArray json;
+		jsonWriter.write(dialog, json);
+		jsonData.append(json);
+		jsonSize += json.size();
+
+		binaryData.append(binaryWriter.write(dialog));
+		binarySize += binaryData.last().size();
+	}
+
+	QByteArray buffer;
+	const double jsonEncodeMs = measure([&]
+	{
+		for (const Core::Dialog& dialog : dialogs)
+		{
+			buffer.resize(0);
+			jsonWriter.write(dialog, buffer);
+		}
+	});
+
+	const double binaryEncodeMs = measure([&]
+	{
+		for (const Core::Dialog& dialog : dialogs)
+		{
+			buffer.resize(0);
+			binaryWriter.write(dialog, buffer);
+		}
+	});
+
+	// every dialog is decoded once before measuring, so the failures are counted once
+	int failed = 0;
+	const auto decode = [&jsonData, &binaryData, &failed](bool json)
+	{
+		failed = 0;
+		for (int i = 0; i < jsonData.size(); ++i)
+		{
+			bool ok = false;
+			if (json)
+			{
+				Core::DialogJsonReader().read(jsonData[i], ok);
+			}
+			else
+			{
+				Core::DialogBinaryReader().read(binaryData[i], ok);
+			}
+			failed += ok ? 0 : 1;
+		}
+	};
+
+	decode(true);
+	const int jsonFailed = failed;
+	decode(false);
+	const int binaryFailed = failed;
+
+	const double jsonDecodeMs = measure([&decode] { decode(true); });
+	const double binaryDecodeMs = measure([&decode] { decode(false); });
+	failed = jsonFailed + binaryFailed;
+
+	report("JSON encode", jsonEncodeMs, QString("%1 bytes").arg(jsonSize));
+	report("binary encode", binaryEncodeMs, QString("%1 bytes").arg(binarySize));
+	report("JSON decode", jsonDecodeMs);
+	report("binary decode", binaryDecodeMs);
+
+	if (failed > 0)
+	{
+		std::cerr << failed << " dialogs failed to decode" << std::endl;
+	}
+}
+
+}
+
+// The dialogs are repeated for more clients until the corpus has 100k nodes, the size the search must stay interactive on
+void benchmarkSearch(const QList<Core::Dialog>& dialogs)
+{
+	const int corpusNodes = 100000;
+
+	int dialogNodes = 0;
+	QString word;
+	for (const Core::Dialog& dialog : dialogs)
+	{
+		for (const Core::PhaseNode& phase : dialog.phases)
+		{
+			dialogNodes += phase.nodes().size();
+		}
+
+		for (const QString& answer : answers(dialog))
+		{
+			for (const QString& answerWord : Core::TextNormalizer::words(answer))
+			{
+				if (answerWord.size() > word.size())
+				{
+					word = answerWord;
+				}
+			}
+		}
+	}
+
+	if (dialogNodes == 0 || word.size() < 2)
+	{
+		std::cout << "search: no texts to search" << std::endl;
+		return;
+	}
+
+	Core::DialogSearchIndex::Dialogs corpus;
+	int nodes = 0;
+	for (int client = 1; nodes < corpusNodes; ++client)
+	{
+		corpus.insert(QString("client %1").arg(client), dialogs);
+		nodes += dialogNodes;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	Core::DialogSearchIndex index;
+	index.setDialogs(corpus);
+	report("search index build", timer.nsecsElapsed() / 1000000.0, QString("%1 nodes, %2 clients").arg(nodes).arg(corpus.size()));
+
+	const QString client = corpus.firstKey();
+	const QStringList queries = { word.left(1), word.left(2), word, word.left(2) + " " + word.left(1) };
+	for (const QString& query : queries)
+	{
+		int hits = 0;
+		const double allMs = measure([&index, &query, &hits] { hits = index.search(query).size(); });
+		report(("search \"" + query + "\", all clients").toUtf8().constData(), allMs, QString("%1 hits").arg(hits));
+
+		const double clientMs = measure([&index, &query, &client, &hits] { hits = index.search(query, client).size(); });
+		report(("search \"" + query + "\", one client").toUtf8().constData(), clientMs, QString("%1 hits").arg(hits));
+	}
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication application(argc, argv);
+	QCoreApplication::setApplicationName("DialogBenchmarks");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Measures the dialog model on dialogs from a directory of JSON files or from a JSON Lines file. "
+		"Prints the time of one pass over all dialogs for every benchmark.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("input", "Directory with *.json files or a JSON Lines file");
+
+	const QCommandLineOption iterationsOption({ "n", "iterations" }, "Number of measured passes (10 by default)", "count");
+	parser.addOptions({ iterationsOption });
+
+	parser.process(application);
+
+	const QStringList arguments = parser.positionalArguments();
+	if (arguments.size() != 1)
+	{
+		parser.showHelp(2);
+	}
+
+	if (parser.isSet(iterationsOption))
+	{
+		s_iterations = parser.value(iterationsOption).toInt();
+		if (s_iterations <= 0)
+		{
+			std::cerr << "Invalid number of iterations" << std::endl;
+			return 2;
+		}
+	}
+
+	// the model logs every step of the score calculation, it would be measured too
+	qInstallMessageHandler([](QtMsgType, const QMessageLogContext&, const QString&) {});
+
+	QList<Core::Dialog> dialogs;
+	QString error;
+	if (!readDialogs(arguments.first(), dialogs, error))
+	{
+		std::cerr << error.toStdString() << std::endl;
+		return 2;
+	}
+
+	std::cout << dialogs.size() << " dialogs, " << s_iterations << " iterations" << std::endl;
+
+	benchmarkNormalizer(dialogs);
+	benchmarkMatcher(dialogs);
+	benchmarkFuzzyMatcher(dialogs);
+	benchmarkJsonWriter(dialogs);
+	benchmarkBinaryFormat(dialogs);
+	benchmarkSearch(dialogs);
+
+	return 0;
+}